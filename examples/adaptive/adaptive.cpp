@@ -52,6 +52,9 @@ int main(int argc, char** argv)
     string input          = "sinc";                   // input dataset
     int    max_rounds     = 0;                        // max. number of rounds (0 = no maximum)
     int    weighted       = 1;                        // solve for and use weights (bool 0 or 1)
+    int    refit_iters    = 0;                        // max. iterations of warm-started refit per round (0 = direct solve)
+    int    ckpt_rounds    = 0;                        // rounds between checkpoints (0 = no checkpoints)
+    int    resume         = 0;                        // resume from the last checkpoint (bool 0 or 1)
     real_t rot            = 0.0;                      // rotation angle in degrees
     real_t twist          = 0.0;                      // twist (waviness) of domain (0.0-1.0)
     real_t noise          = 0.0;                      // fraction of noise
@@ -73,6 +76,9 @@ int main(int argc, char** argv)
     ops >> opts::Option('i', "input",       input,          " input dataset");
     ops >> opts::Option('u', "rounds",      max_rounds,     " maximum number of iterations");
     ops >> opts::Option('w', "weights",     weighted,       " solve for and use weights");
+    ops >> opts::Option('z', "refit",       refit_iters,    " max. iterations of warm-started refit per round (0 = direct solve)");
+    ops >> opts::Option('k', "ckpt",        ckpt_rounds,    " rounds between checkpoints written to adaptive_gid_<gid>.ckpt (0 = no checkpoints)");
+    ops >> opts::Option('o', "resume",      resume,         " resume from the last checkpoint");
     ops >> opts::Option('r', "rotate",      rot,            " rotation angle of domain in degrees");
     ops >> opts::Option('t', "twist",       twist,          " twist (waviness) of domain (0.0-1.0)");
     ops >> opts::Option('s', "noise",       noise,          " fraction of noise (0.0 - 1.0)");
@@ -155,6 +161,8 @@ int main(int argc, char** argv)
     // set default args for diy foreach callback functions
     DomainArgs d_args(dom_dim, pt_dim);
     d_args.weighted     = weighted;
+    d_args.refit_iters  = refit_iters;
+    d_args.checkpoint_interval = ckpt_rounds;
     d_args.n            = noise;
     d_args.multiblock   = false;
     d_args.verbose      = 1;
@@ -394,7 +402,7 @@ int main(int argc, char** argv)
     fprintf(stderr, "\nStarting adaptive encoding...\n\n");
     double encode_time = MPI_Wtime();
     master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
-            { b->adaptive_encode_block(cp, norm_err_limit, max_rounds, d_args); });
+            { b->adaptive_encode_block(cp, norm_err_limit, max_rounds, d_args, resume); });
     encode_time = MPI_Wtime() - encode_time;
     fprintf(stderr, "\nAdaptive encoding done.\n");
 
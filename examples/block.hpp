@@ -8,6 +8,7 @@
 
 #include    <mfa/mfa.hpp>
 #include    <mfa/block_base.hpp>
+#include    <mfa/mapped_grid.hpp>
 
 #include    <diy/master.hpp>
 #include    <diy/reduce-operations.hpp>
@@ -51,6 +52,7 @@ struct DomainArgs : public ModelInfo
         starts.resize(dom_dim);
         ndom_pts.resize(dom_dim);
         full_dom_pts.resize(dom_dim);
+        strides.resize(dom_dim, 1);
         min.resize(dom_dim);
         max.resize(dom_dim);
         s.resize(pt_dim);
@@ -71,6 +73,7 @@ struct DomainArgs : public ModelInfo
     vector<int>         starts;                     // starting offsets of ndom_pts (optional, usually assumed 0)
     vector<int>         ndom_pts;                   // number of points in domain (possibly a subset of full domain)
     vector<int>         full_dom_pts;               // number of points in full domain in case a subset is taken
+    vector<int>         strides;                    // distance between points taken from the full domain (optional, usually 1)
     vector<real_t>      min;                        // minimum corner of domain
     vector<real_t>      max;                        // maximum corner of domain
     vector<real_t>      s;                          // scaling factor for each variable or any other usage
@@ -734,6 +737,136 @@ struct Block : public BlockBase<T>
 //         cerr << "domain:\n" << this->domain << endl;
     }
 
+    // read a raw grid file, mapped into memory rather than read into a buffer
+    // ncomps = 1: f = (x, y, ..., value)
+    // ncomps > 1: f = (x, y, ..., vector magnitude * s[0])
+    // the file holds a grid of full_dom_pts points, first dimension fastest, each point ncomps values of type P
+    // the points taken are ndom_pts points from starts, every strides points in each dimension,
+    // or, if full_dom_pts is not set, all such points in a grid of ndom_pts points
+    // if multiblock, the block takes only those of them inside its bounds, in the index space of the grid
+    // domain coordinates are the grid indices of the points taken
+    template <typename P>                   // input file precision (e.g., float or double)
+    void read_mapped_data(
+            const       diy::Master::ProxyWithLink& cp,
+            DomainArgs& args,
+            int         ncomps)             // number of values per grid point
+    {
+        DomainArgs* a = &args;
+        this->geometry.min_dim = 0;
+        this->geometry.max_dim = dom_dim - 1;
+        int nvars = 1;
+        this->vars.resize(nvars);
+        this->max_errs.resize(nvars);
+        this->sum_sq_errs.resize(nvars);
+        this->vars[0].min_dim = dom_dim;
+        this->vars[0].max_dim = this->vars[0].min_dim;
+
+        // points taken in each dimension
+        VectorXi full_dom_pts(dom_dim);
+        VectorXi starts(dom_dim);
+        VectorXi strides(dom_dim);
+        VectorXi ndom_pts(dom_dim);
+        for (int i = 0; i < dom_dim; i++)
+        {
+            starts(i)   = a->starts[i];
+            strides(i)  = a->strides[i];
+            if (a->full_dom_pts[i])
+            {
+                full_dom_pts(i) = a->full_dom_pts[i];
+                ndom_pts(i)     = a->ndom_pts[i];
+            }
+            else
+            {
+                full_dom_pts(i) = a->ndom_pts[i];
+                ndom_pts(i)     = (full_dom_pts(i) - 1 - starts(i)) / strides(i) + 1;
+            }
+
+            // restrict to the bounds of the block
+            if (a->multiblock)
+            {
+                int first   = max(0, (int)ceil((bounds_mins(i) - starts(i)) / strides(i)));
+                int last    = min(ndom_pts(i) - 1, (int)floor((bounds_maxs(i) - starts(i)) / strides(i)));
+                starts(i)   += first * strides(i);
+                ndom_pts(i) = last - first + 1;
+            }
+
+            if (ndom_pts(i) < 1 || starts(i) < 0 || starts(i) + (ndom_pts(i) - 1) * strides(i) >= full_dom_pts(i))
+            {
+                fprintf(stderr, "Error: read_mapped_data: selection in dimension %d is outside the %d points of %s\n",
+                        i, full_dom_pts(i), a->infile.c_str());
+                exit(1);
+            }
+        }
+
+        // Construct point set to contain input
+        if (args.structured)
+            input = new mfa::PointSet<T>(dom_dim, pt_dim, ndom_pts.prod(), ndom_pts);
+        else
+            input = new mfa::PointSet<T>(dom_dim, pt_dim, ndom_pts.prod());
+
+        mfa::MappedGrid<P> grid(a->infile, full_dom_pts, ncomps);
+
+        // copy the values of one line of points in the first dimension at a time, straight from the mapped file,
+        // and generate their domain coordinates
+        VectorXi nlines = ndom_pts;
+        nlines(0) = 1;
+        mfa::VolIterator line_it(nlines);
+        VectorXi ijk(dom_dim);
+        size_t n = 0;
+        while (!line_it.done())
+        {
+            for (int i = 0; i < dom_dim; i++)
+                ijk(i) = starts(i) + line_it.idx_dim(i) * strides(i);
+            typename mfa::MappedGrid<P>::LineMap vals = grid.Line(ijk, ndom_pts(0), strides(0));
+            if (ncomps == 1)
+                input->domain.col(dom_dim).segment(n, ndom_pts(0)) = vals.col(0).template cast<T>();
+            else
+                input->domain.col(dom_dim).segment(n, ndom_pts(0)) = vals.rowwise().norm().template cast<T>() * a->s[0];
+            for (int j = 0; j < ndom_pts(0); j++, n++)
+            {
+                input->domain(n, 0) = ijk(0) + j * strides(0);
+                for (int i = 1; i < dom_dim; i++)
+                    input->domain(n, i) = ijk(i);
+            }
+            line_it.incr_iter();
+        }
+
+        // find extent of range
+        bounds_mins(dom_dim) = input->domain.col(dom_dim).minCoeff();
+        bounds_maxs(dom_dim) = input->domain.col(dom_dim).maxCoeff();
+
+        // if single block, extent of domain is the first and the last point
+        // if multiblock, the block bounds were decomposed by diy
+        if (!a->multiblock)
+        {
+            core_mins.resize(dom_dim);
+            core_maxs.resize(dom_dim);
+            for (int i = 0; i < dom_dim; i++)
+            {
+                bounds_mins(i)  = input->domain(0, i);
+                bounds_maxs(i)  = input->domain(n - 1, i);
+                core_mins(i)    = bounds_mins(i);
+                core_maxs(i)    = bounds_maxs(i);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < dom_dim; i++)
+            {
+                overlaps(i) = fabs(core_mins(i) - bounds_mins(i));
+                T m2 = fabs(bounds_maxs(i) - core_maxs(i));
+                if (m2 > overlaps(i))
+                    overlaps(i) = m2;
+            }
+        }
+
+        input->init_params();
+        this->mfa = new mfa::MFA<T>(dom_dim);
+
+        // debug
+        cerr << "domain extent:\n min\n" << bounds_mins << "\nmax\n" << bounds_maxs << endl;
+    }
+
     // read a floating point 3d vector dataset and take one 1-d curve out of the middle of it
     // f = (x, velocity magnitude)
     void read_1d_slice_3d_vector_data(
@@ -1042,96 +1175,7 @@ struct Block : public BlockBase<T>
             const       diy::Master::ProxyWithLink& cp,
             DomainArgs& args)
     {
-        DomainArgs* a = &args;
-        int tot_ndom_pts = 1;
-        this->geometry.min_dim = 0;
-        this->geometry.max_dim = dom_dim - 1;
-        int nvars = 1;
-        this->vars.resize(nvars);
-        this->max_errs.resize(nvars);
-        this->sum_sq_errs.resize(nvars);
-        this->vars[0].min_dim = dom_dim;
-        this->vars[0].max_dim = this->vars[0].min_dim;
-        VectorXi ndom_pts(dom_dim);
-        this->bounds_mins.resize(pt_dim);
-        this->bounds_maxs.resize(pt_dim);
-        for (int i = 0; i < dom_dim; i++)
-        {
-            ndom_pts(i)                     =  a->ndom_pts[i];
-            tot_ndom_pts                    *= ndom_pts(i);
-        }
-
-        // Construct point set to contain input
-        if (args.structured)
-            input = new mfa::PointSet<T>(dom_dim, pt_dim, tot_ndom_pts, ndom_pts);
-        else
-            input = new mfa::PointSet<T>(dom_dim, pt_dim, tot_ndom_pts);
-
-        vector<float> vel(3 * tot_ndom_pts);
-
-        FILE *fd = fopen(a->infile.c_str(), "r");
-        assert(fd);
-
-        // read all three components of velocity and compute magnitude
-        if (!fread(&vel[0], sizeof(float), tot_ndom_pts * 3, fd))
-        {
-            fprintf(stderr, "Error: unable to read file\n");
-            exit(0);
-        }
-        for (size_t i = 0; i < vel.size() / 3; i++)
-        {
-            input->domain(i, 3) = sqrt(vel[3 * i    ] * vel[3 * i    ] +
-                    vel[3 * i + 1] * vel[3 * i + 1] +
-                    vel[3 * i + 2] * vel[3 * i + 2]);
-            input->domain(i, 3) *= a->s[0];
-//             if (i < 1000)
-//              fprintf(stderr, "vel [%.3f %.3f %.3f]\n",
-//                      vel[3 * i], vel[3 * i + 1], vel[3 * i + 2]);
-        }
-
-        // rest is hard-coded for 3d
-
-        // find extent of range
-        for (size_t i = 0; i < (size_t)input->domain.rows(); i++)
-        {
-            if (i == 0 || input->domain(i, 3) < bounds_mins(3))
-                bounds_mins(3) = input->domain(i, 3);
-            if (i == 0 || input->domain(i, 3) > bounds_maxs(3))
-                bounds_maxs(3) = input->domain(i, 3);
-        }
-
-        // set domain values (just equal to i, j; ie, dx, dy = 1, 1)
-        int n = 0;
-        for (size_t k = 0; k < (size_t)(ndom_pts(2)); k++)
-            for (size_t j = 0; j < (size_t)(ndom_pts(1)); j++)
-                for (size_t i = 0; i < (size_t)(ndom_pts(0)); i++)
-                {
-                    input->domain(n, 0) = i;
-                    input->domain(n, 1) = j;
-                    input->domain(n, 2) = k;
-                    n++;
-                }
-
-        // extents
-        bounds_mins(0) = 0.0;
-        bounds_mins(1) = 0.0;
-        bounds_mins(2) = 0.0;
-        bounds_maxs(0) = input->domain(tot_ndom_pts - 1, 0);
-        bounds_maxs(1) = input->domain(tot_ndom_pts - 1, 1);
-        bounds_maxs(2) = input->domain(tot_ndom_pts - 1, 2);
-        core_mins.resize(dom_dim);
-        core_maxs.resize(dom_dim);
-        for (int i = 0; i < dom_dim; i++)
-        {
-            core_mins(i) = bounds_mins(i);
-            core_maxs(i) = bounds_maxs(i);
-        }
-
-        input->init_params();
-        this->mfa = new mfa::MFA<T>(dom_dim);
-
-        // debug
-        cerr << "domain extent:\n min\n" << bounds_mins << "\nmax\n" << bounds_maxs << endl;
+        read_mapped_data<float>(cp, args, 3);
     }
 
     // read a floating point 3d vector time-varying dataset, ie, 4d
@@ -1274,119 +1318,7 @@ struct Block : public BlockBase<T>
             const       diy::Master::ProxyWithLink& cp,
             DomainArgs& args)
     {
-        DomainArgs* a = &args;
-        int tot_ndom_pts = 1;
-        this->geometry.min_dim = 0;
-        this->geometry.max_dim = dom_dim - 1;
-        int nvars = 1;
-        this->vars.resize(nvars);
-        this->max_errs.resize(nvars);
-        this->sum_sq_errs.resize(nvars);
-        this->vars[0].min_dim = dom_dim;
-        this->vars[0].max_dim = this->vars[0].min_dim;
-        VectorXi ndom_pts(dom_dim);
-        bounds_mins.resize(pt_dim);
-        bounds_maxs.resize(pt_dim);
-        for (int i = 0; i < dom_dim; i++)
-        {
-            ndom_pts(i)     =  a->ndom_pts[i];
-            tot_ndom_pts    *= ndom_pts(i);
-        }
-
-        // Construct point set to contain input
-        if (args.structured)
-            input = new mfa::PointSet<T>(dom_dim, pt_dim, tot_ndom_pts, ndom_pts);
-        else
-            input = new mfa::PointSet<T>(dom_dim, pt_dim, tot_ndom_pts);
-
-        vector<float> vel(a->full_dom_pts[0] * a->full_dom_pts[1] * a->full_dom_pts[2] * 3);
-
-        FILE *fd = fopen(a->infile.c_str(), "r");
-        assert(fd);
-
-        // rest is hard-coded for 3d
-
-        // read all three components of velocity (not just the subset)
-        if (!fread(&vel[0], sizeof(float), a->full_dom_pts[0] * a->full_dom_pts[1] * a->full_dom_pts[2] * 3, fd))
-        {
-            fprintf(stderr, "Error: unable to read file\n");
-            exit(0);
-        }
-
-        // compute velocity magnitude only for the points in the subset, dropping the rest
-        size_t ijk[3] = {0, 0, 0};                          // i,j,k indices of current point
-        size_t n = 0;
-        for (size_t i = 0; i < vel.size() / 3; i++)
-        {
-            // is the point in the subset?
-            bool keep = true;
-            if (ijk[0] < a->starts[0] || ijk[0] >= a->starts[0] + a->ndom_pts[0] ||
-                    ijk[1] < a->starts[1] || ijk[1] >= a->starts[1] + a->ndom_pts[1] ||
-                    ijk[2] < a->starts[2] || ijk[2] >= a->starts[2] + a->ndom_pts[2])
-                keep = false;
-
-            // debug
-            //                 fprintf(stderr, "i=%ld ijk=[%ld %ld %ld] keep=%d\n", i, ijk[0], ijk[1], ijk[2], keep);
-
-            if (keep)
-            {
-                input->domain(n, 0) = ijk[0];                  // domain is just i,j
-                input->domain(n, 1) = ijk[1];
-                input->domain(n, 2) = ijk[2];
-                input->domain(n, 3) = sqrt(vel[3 * i    ] * vel[3 * i    ] +
-                        vel[3 * i + 1] * vel[3 * i + 1] +
-                        vel[3 * i + 2] * vel[3 * i + 2]);
-                n++;
-                // fprintf(stderr, "vel [%.3f %.3f %.3f] mag %.3f\n",
-                //         vel[3 * i], vel[3 * i + 1], vel[3 * i + 2], range[i]);
-            }
-
-            // increment ijk
-            if (ijk[0] == a->full_dom_pts[0] - 1)
-            {
-                ijk[0] = 0;
-                if (ijk[1] == a->full_dom_pts[1] - 1)
-                {
-                    ijk[1] = 0;
-                    ijk[2]++;
-                }
-                else
-                    ijk[1]++;
-            }
-            else
-                ijk[0]++;
-        }
-
-        // find extent of range
-        for (size_t i = 0; i < (size_t)input->domain.rows(); i++)
-        {
-            if (i == 0 || input->domain(i, 3) < bounds_mins(3))
-                bounds_mins(3) = input->domain(i, 3);
-            if (i == 0 || input->domain(i, 3) > bounds_maxs(3))
-                bounds_maxs(3) = input->domain(i, 3);
-        }
-
-        // extent of domain is just lower left and upper right corner, which in row-major order
-        // is the first point and the last point
-        bounds_mins(0) = input->domain(0, 0);
-        bounds_mins(1) = input->domain(0, 1);
-        bounds_mins(2) = input->domain(0, 2);
-        bounds_maxs(0) = input->domain(tot_ndom_pts - 1, 0);
-        bounds_maxs(1) = input->domain(tot_ndom_pts - 1, 1);
-        bounds_maxs(2) = input->domain(tot_ndom_pts - 1, 2);
-        core_mins.resize(dom_dim);
-        core_maxs.resize(dom_dim);
-        for (int i = 0; i < dom_dim; i++)
-        {
-            core_mins(i) = bounds_mins(i);
-            core_maxs(i) = bounds_maxs(i);
-        }
-
-        input->init_params();
-        this->mfa = new mfa::MFA<T>(dom_dim);
-
-        // debug
-        cerr << "domain extent:\n min\n" << bounds_mins << "\nmax\n" << bounds_maxs << endl;
+        read_mapped_data<float>(cp, args, 3);
     }
 
     // read a floating point 2d scalar dataset
@@ -1395,84 +1327,7 @@ struct Block : public BlockBase<T>
             const       diy::Master::ProxyWithLink& cp,
             DomainArgs& args)
     {
-        DomainArgs* a = &args;
-        int tot_ndom_pts = 1;
-        this->geometry.min_dim = 0;
-        this->geometry.max_dim = dom_dim - 1;
-        int nvars = 1;
-        this->vars.resize(nvars);
-        this->max_errs.resize(nvars);
-        this->sum_sq_errs.resize(nvars);
-        this->vars[0].min_dim = dom_dim;
-        this->vars[0].max_dim = this->vars[0].min_dim;
-        VectorXi ndom_pts(dom_dim);
-        bounds_mins.resize(pt_dim);
-        bounds_maxs.resize(pt_dim);
-        for (int i = 0; i < dom_dim; i++)
-        {
-            ndom_pts(i)     =  a->ndom_pts[i];
-            tot_ndom_pts    *= ndom_pts(i);
-        }
-
-        // Construct point set to contain input
-        if (args.structured)
-            input = new mfa::PointSet<T>(dom_dim, pt_dim, tot_ndom_pts, ndom_pts);
-        else
-            input = new mfa::PointSet<T>(dom_dim, pt_dim, tot_ndom_pts);
-
-        vector<float> val(tot_ndom_pts);
-
-        FILE *fd = fopen(a->infile.c_str(), "r");
-        assert(fd);
-
-        // read data values
-        if (!fread(&val[0], sizeof(float), tot_ndom_pts, fd))
-        {
-            fprintf(stderr, "Error: unable to read file\n");
-            exit(0);
-        }
-        for (size_t i = 0; i < val.size(); i++)
-            input->domain(i, 2) = val[i];
-
-        // rest is hard-coded for 3d
-
-        // find extent of range
-        for (size_t i = 0; i < (size_t)input->domain.rows(); i++)
-        {
-            if (i == 0 || input->domain(i, 2) < bounds_mins(2))
-                bounds_mins(2) = input->domain(i, 2);
-            if (i == 0 || input->domain(i, 2) > bounds_maxs(2))
-                bounds_maxs(2) = input->domain(i, 2);
-        }
-
-        // set domain values (just equal to i, j; ie, dx, dy = 1, 1)
-        int n = 0;
-        for (size_t j = 0; j < (size_t)(ndom_pts(1)); j++)
-            for (size_t i = 0; i < (size_t)(ndom_pts(0)); i++)
-            {
-                input->domain(n, 0) = i;
-                input->domain(n, 1) = j;
-                n++;
-            }
-
-        // extents
-        bounds_mins(0) = 0.0;
-        bounds_mins(1) = 0.0;
-        bounds_maxs(0) = input->domain(tot_ndom_pts - 1, 0);
-        bounds_maxs(1) = input->domain(tot_ndom_pts - 1, 1);
-        core_mins.resize(dom_dim);
-        core_maxs.resize(dom_dim);
-        for (int i = 0; i < dom_dim; i++)
-        {
-            core_mins(i) = bounds_mins(i);
-            core_maxs(i) = bounds_maxs(i);
-        }
-
-        input->init_params();
-        this->mfa = new mfa::MFA<T>(dom_dim);
-
-        // debug
-        cerr << "domain extent:\n min\n" << bounds_mins << "\nmax\n" << bounds_maxs << endl;
+        read_mapped_data<float>(cp, args, 1);
     }
 
     // read a floating point 3d scalar dataset
@@ -1482,88 +1337,7 @@ struct Block : public BlockBase<T>
             const       diy::Master::ProxyWithLink& cp,
             DomainArgs& args)
     {
-        DomainArgs* a = &args;
-        int tot_ndom_pts = 1;
-        this->geometry.min_dim = 0;
-        this->geometry.max_dim = dom_dim - 1;
-        int nvars = 1;
-        this->vars.resize(nvars);
-        this->max_errs.resize(nvars);
-        this->sum_sq_errs.resize(nvars);
-        this->vars[0].min_dim = dom_dim;
-        this->vars[0].max_dim = this->vars[0].min_dim;
-        VectorXi ndom_pts(dom_dim);
-        bounds_mins.resize(pt_dim);
-        bounds_maxs.resize(pt_dim);
-        for (int i = 0; i < dom_dim; i++)
-        {
-            ndom_pts(i)     =  a->ndom_pts[i];
-            tot_ndom_pts    *= ndom_pts(i);
-        }
-
-        // Construct point set to contain input
-        if (args.structured)
-            input = new mfa::PointSet<T>(dom_dim, pt_dim, tot_ndom_pts, ndom_pts);
-        else
-            input = new mfa::PointSet<T>(dom_dim, pt_dim, tot_ndom_pts);
-
-        vector<P> val(tot_ndom_pts);
-
-        FILE *fd = fopen(a->infile.c_str(), "r");
-        assert(fd);
-
-        // read data values
-        if (!fread(&val[0], sizeof(P), tot_ndom_pts, fd))
-        {
-            fprintf(stderr, "Error: unable to read file\n");
-            exit(0);
-        }
-        for (size_t i = 0; i < val.size(); i++)
-            input->domain(i, 3) = val[i];
-
-        // rest is hard-coded for 3d
-
-        // find extent of range
-        for (size_t i = 0; i < (size_t)input->domain.rows(); i++)
-        {
-            if (i == 0 || input->domain(i, 3) < bounds_mins(3))
-                bounds_mins(3) = input->domain(i, 3);
-            if (i == 0 || input->domain(i, 3) > bounds_maxs(3))
-                bounds_maxs(3) = input->domain(i, 3);
-        }
-
-        // set domain values (just equal to i, j; ie, dx, dy = 1, 1)
-        int n = 0;
-        for (size_t k = 0; k < (size_t)(ndom_pts(2)); k++)
-            for (size_t j = 0; j < (size_t)(ndom_pts(1)); j++)
-                for (size_t i = 0; i < (size_t)(ndom_pts(0)); i++)
-                {
-                    input->domain(n, 0) = i;
-                    input->domain(n, 1) = j;
-                    input->domain(n, 2) = k;
-                    n++;
-                }
-
-        // extents
-        bounds_mins(0) = 0.0;
-        bounds_mins(1) = 0.0;
-        bounds_mins(2) = 0.0;
-        bounds_maxs(0) = input->domain(tot_ndom_pts - 1, 0);
-        bounds_maxs(1) = input->domain(tot_ndom_pts - 1, 1);
-        bounds_maxs(2) = input->domain(tot_ndom_pts - 1, 2);
-        core_mins.resize(dom_dim);
-        core_maxs.resize(dom_dim);
-        for (int i = 0; i < dom_dim; i++)
-        {
-            core_mins(i) = bounds_mins(i);
-            core_maxs(i) = bounds_maxs(i);
-        }
-
-        input->init_params();
-        this->mfa = new mfa::MFA<T>(dom_dim);
-
-        // debug
-        cerr << "domain extent:\n min\n" << bounds_mins << "\nmax\n" << bounds_maxs << endl;
+        read_mapped_data<P>(cp, args, 1);
     }
 
     void analytical_error_field(
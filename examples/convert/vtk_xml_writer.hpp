@@ -0,0 +1,619 @@
+//--------------------------------------------------------------
+// VTK XML writers (.vti, .vtr, .vtu pieces and .pvti, .pvtr, .pvtu indices)
+//
+// each piece is written with one write call: an XML header followed by the
+// arrays in raw appended binary, in native byte order, optionally compressed
+// in the LZ4 block format (read by VTK as vtkLZ4DataCompressor)
+//
+// image data too large for memory can instead be streamed to the file in
+// pieces of any size with VtkXmlImageStream
+//
+// pieces are independent files, so every block can write its own in parallel;
+// one process writes the index that ties the pieces together
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _VTK_XML_WRITER_HPP
+#define _VTK_XML_WRITER_HPP
+
+#include    <vector>
+#include    <string>
+#include    <sstream>
+#include    <cstdio>
+#include    <cstdint>
+#include    <cstring>
+#include    <cstdlib>
+
+using namespace std;
+
+// one named array of float tuples
+struct VtkXmlArray
+{
+    string          name;
+    int             ncomp;                  // number of components per tuple
+    const float*    data;                   // ntuples * ncomp values
+    size_t          ntuples;
+
+    VtkXmlArray(const string& name_, int ncomp_, const float* data_, size_t ntuples_) :
+        name(name_), ncomp(ncomp_), data(data_), ntuples(ntuples_)  {}
+};
+
+// compresses one block in the LZ4 block format (greedy matching over a hash of 4-byte sequences)
+// returns the compressed size
+inline size_t lz4_compress_block(
+        const unsigned char*    in,
+        size_t                  n,
+        vector<unsigned char>&  out)                // compressed block is appended
+{
+    const int       hash_log        = 16;
+    const size_t    min_match       = 4;
+    const size_t    last_literals   = 5;            // block must end with at least 5 literals
+    const size_t    mf_limit        = 12;           // last match must start at least 12 bytes before the end
+    const size_t    max_offset      = 65535;
+
+    size_t start = out.size();
+    vector<int64_t> table(size_t(1) << hash_log, -1);
+
+    // length of a token field beyond 15, as a run of bytes
+    struct Len
+    {
+        static void put(vector<unsigned char>& out, size_t len)
+        {
+            for (len -= 15; len >= 255; len -= 255)
+                out.push_back(255);
+            out.push_back((unsigned char)len);
+        }
+    };
+
+    size_t ip = 0, anchor = 0;
+    while (n > mf_limit && ip + mf_limit < n)
+    {
+        uint32_t seq;
+        memcpy(&seq, in + ip, 4);
+        uint32_t h      = (seq * 2654435761u) >> (32 - hash_log);
+        int64_t  ref    = table[h];
+        table[h]        = ip;
+
+        uint32_t rseq;
+        if (ref < 0 || ip - ref > max_offset || (memcpy(&rseq, in + ref, 4), rseq != seq))
+        {
+            ip += 1 + ((ip - anchor) >> 6);         // skip faster through incompressible data
+            continue;
+        }
+
+        size_t len = min_match;
+        while (ip + len + last_literals < n && in[ref + len] == in[ip + len])
+            len++;
+
+        // token, literals, offset, and match length
+        size_t nlit = ip - anchor;
+        size_t mlen = len - min_match;
+        out.push_back((unsigned char)(((nlit < 15 ? nlit : 15) << 4) | (mlen < 15 ? mlen : 15)));
+        if (nlit >= 15)
+            Len::put(out, nlit);
+        out.insert(out.end(), in + anchor, in + ip);
+        size_t offset = ip - ref;
+        out.push_back((unsigned char)(offset & 0xff));
+        out.push_back((unsigned char)(offset >> 8));
+        if (mlen >= 15)
+            Len::put(out, mlen);
+
+        ip      += len;
+        anchor  = ip;
+    }
+
+    // last literals
+    size_t nlit = n - anchor;
+    out.push_back((unsigned char)((nlit < 15 ? nlit : 15) << 4));
+    if (nlit >= 15)
+        Len::put(out, nlit);
+    out.insert(out.end(), in + anchor, in + n);
+
+    return out.size() - start;
+}
+
+// appends one array to the appended data section and returns its offset in the section
+// the array is preceded by a UInt64 header: its size, or for compressed arrays the
+// number of blocks, the block size, the size of the last partial block, and the compressed size of each block
+inline size_t vtk_xml_append(
+        vector<unsigned char>&  appended,
+        const void*             data,
+        size_t                  nbytes,
+        bool                    compress)
+{
+    size_t offset = appended.size();
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    if (!compress)
+    {
+        uint64_t header = nbytes;
+        appended.insert(appended.end(), (unsigned char*)&header, (unsigned char*)&header + sizeof(header));
+        appended.insert(appended.end(), bytes, bytes + nbytes);
+        return offset;
+    }
+
+    const uint64_t  block_size  = 1 << 16;
+    uint64_t        nblocks     = (nbytes + block_size - 1) / block_size;
+    vector<uint64_t> header(3 + nblocks);
+    header[0] = nblocks;
+    header[1] = block_size;
+    header[2] = nbytes % block_size;
+
+    vector<unsigned char> blocks;
+    for (uint64_t i = 0; i < nblocks; i++)
+    {
+        size_t size = (i + 1) * block_size <= nbytes ? block_size : nbytes - i * block_size;
+        header[3 + i] = lz4_compress_block(bytes + i * block_size, size, blocks);
+    }
+    appended.insert(appended.end(), (unsigned char*)&header[0], (unsigned char*)&header[0] + header.size() * sizeof(uint64_t));
+    appended.insert(appended.end(), blocks.begin(), blocks.end());
+    return offset;
+}
+
+inline const char* vtk_xml_byte_order()
+{
+    uint16_t one = 1;
+    return *(unsigned char*)&one ? "LittleEndian" : "BigEndian";
+}
+
+inline void vtk_xml_open(ostringstream& xml, const char* type, bool compress)
+{
+    xml.precision(9);
+    xml << "<?xml version=\"1.0\"?>\n";
+    xml << "<VTKFile type=\"" << type << "\" version=\"1.0\" byte_order=\"" << vtk_xml_byte_order() << "\" header_type=\"UInt64\"";
+    if (compress)
+        xml << " compressor=\"vtkLZ4DataCompressor\"";
+    xml << ">\n";
+}
+
+inline void vtk_xml_data_array(
+        ostringstream&          xml,
+        const char*             type,
+        const string&           name,
+        int                     ncomp,
+        size_t                  offset)
+{
+    xml << "      <DataArray type=\"" << type << "\" Name=\"" << name << "\" NumberOfComponents=\"" << ncomp
+        << "\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+}
+
+inline void vtk_xml_point_data(
+        ostringstream&              xml,
+        vector<unsigned char>&      appended,
+        const vector<VtkXmlArray>&  arrays,
+        bool                        compress)
+{
+    xml << "    <PointData>\n";
+    for (auto i = 0; i < arrays.size(); i++)
+    {
+        size_t offset = vtk_xml_append(appended, arrays[i].data, arrays[i].ntuples * arrays[i].ncomp * sizeof(float), compress);
+        vtk_xml_data_array(xml, "Float32", arrays[i].name, arrays[i].ncomp, offset);
+    }
+    xml << "    </PointData>\n";
+}
+
+// writes the XML header and the appended data with one fwrite each
+inline void vtk_xml_close(
+        const char*                     filename,
+        ostringstream&                  xml,
+        const vector<unsigned char>&    appended)
+{
+    xml << "  <AppendedData encoding=\"raw\">\n_";
+    string head = xml.str();
+    const char* tail = "\n  </AppendedData>\n</VTKFile>\n";
+
+    FILE* fp = fopen(filename, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: unable to open %s for writing\n", filename);
+        exit(1);
+    }
+    if (fwrite(head.data(), 1, head.size(), fp) != head.size() ||
+            (appended.size() && fwrite(&appended[0], 1, appended.size(), fp) != appended.size()) ||
+            fwrite(tail, 1, strlen(tail), fp) != strlen(tail))
+    {
+        fprintf(stderr, "Error: failed writing %s\n", filename);
+        exit(1);
+    }
+    fclose(fp);
+}
+
+inline void vtk_xml_extent(ostringstream& xml, const int* extent)
+{
+    for (auto i = 0; i < 6; i++)
+        xml << (i ? " " : "") << extent[i];
+}
+
+// image data piece: point arrays on a regular grid, dim. 0 fastest
+inline void write_vti_piece(
+        const char*                 filename,
+        const int*                  whole_extent,   // [x0 x1 y0 y1 z0 z1] of the global grid
+        const int*                  extent,         // [x0 x1 y0 y1 z0 z1] of this piece
+        const float*                origin,         // 3 coordinates of global grid point (0, 0, 0)
+        const float*                spacing,        // 3 grid spacings
+        const vector<VtkXmlArray>&  arrays,
+        bool                        compress)
+{
+    ostringstream           xml;
+    vector<unsigned char>   appended;
+    vtk_xml_open(xml, "ImageData", compress);
+    xml << "<ImageData WholeExtent=\"";
+    vtk_xml_extent(xml, whole_extent);
+    xml << "\" Origin=\"" << origin[0] << " " << origin[1] << " " << origin[2]
+        << "\" Spacing=\"" << spacing[0] << " " << spacing[1] << " " << spacing[2] << "\">\n";
+    xml << "  <Piece Extent=\"";
+    vtk_xml_extent(xml, extent);
+    xml << "\">\n";
+    vtk_xml_point_data(xml, appended, arrays, compress);
+    xml << "  </Piece>\n</ImageData>\n";
+    vtk_xml_close(filename, xml, appended);
+}
+
+// image data piece written array by array in pieces of any size, so that the arrays never need to be in memory at once
+// the offsets of the arrays are fixed-width placeholders in the header, filled in as each array begins,
+// and the compressed block sizes are filled in as each array ends
+class VtkXmlImageStream
+{
+    static const size_t     block_size = 1 << 16;   // uncompressed size of one compressed block
+
+    FILE*                   fp;
+    string                  filename;
+    bool                    compress;
+    vector<size_t>          nbytes;                 // size of each array
+    vector<off_t>           offset_pos;             // file position of the offset of each array in the header
+    off_t                   data_start;             // file position of the appended data
+    off_t                   sizes_pos;              // file position of the block sizes of the current array
+    int                     cur;                    // current array (-1 = none)
+    size_t                  written;                // bytes of the current array written so far
+    vector<uint64_t>        csizes;                 // compressed sizes of the blocks of the current array
+    vector<unsigned char>   block;                  // uncompressed current block
+    vector<unsigned char>   cblock;                 // compressed current block
+
+    VtkXmlImageStream(const VtkXmlImageStream&);    // not copyable, owns fp
+    VtkXmlImageStream& operator=(const VtkXmlImageStream&);
+
+    void Check(bool ok)
+    {
+        if (!ok)
+        {
+            fprintf(stderr, "Error: failed writing %s\n", filename.c_str());
+            exit(1);
+        }
+    }
+
+    void Put(const void* data, size_t n)
+    {
+        Check(n == 0 || fwrite(data, 1, n, fp) == n);
+    }
+
+    void FlushBlock()
+    {
+        cblock.clear();
+        csizes.push_back(lz4_compress_block(&block[0], block.size(), cblock));
+        Put(&cblock[0], cblock.size());
+        block.clear();
+    }
+
+public:
+
+    VtkXmlImageStream(
+            const char*                 filename_,
+            const int*                  whole_extent,   // [x0 x1 y0 y1 z0 z1] of the global grid
+            const int*                  extent,         // [x0 x1 y0 y1 z0 z1] of this piece
+            const float*                origin,         // 3 coordinates of global grid point (0, 0, 0)
+            const float*                spacing,        // 3 grid spacings
+            const vector<VtkXmlArray>&  arrays,         // names, components, and tuples of the point arrays (data unused)
+            bool                        compress_) :
+        filename(filename_),
+        compress(compress_),
+        cur(-1)
+    {
+        fp = fopen(filename_, "wb");
+        if (!fp)
+        {
+            fprintf(stderr, "Error: unable to open %s for writing\n", filename_);
+            exit(1);
+        }
+
+        ostringstream xml;
+        vtk_xml_open(xml, "ImageData", compress);
+        xml << "<ImageData WholeExtent=\"";
+        vtk_xml_extent(xml, whole_extent);
+        xml << "\" Origin=\"" << origin[0] << " " << origin[1] << " " << origin[2]
+            << "\" Spacing=\"" << spacing[0] << " " << spacing[1] << " " << spacing[2] << "\">\n";
+        xml << "  <Piece Extent=\"";
+        vtk_xml_extent(xml, extent);
+        xml << "\">\n    <PointData>\n";
+        for (auto i = 0; i < arrays.size(); i++)
+        {
+            xml << "      <DataArray type=\"Float32\" Name=\"" << arrays[i].name << "\" NumberOfComponents=\"" << arrays[i].ncomp
+                << "\" format=\"appended\" offset=\"";
+            offset_pos.push_back(xml.tellp());
+            xml << "00000000000000000000\"/>\n";
+            nbytes.push_back(arrays[i].ntuples * arrays[i].ncomp * sizeof(float));
+        }
+        xml << "    </PointData>\n  </Piece>\n</ImageData>\n  <AppendedData encoding=\"raw\">\n_";
+        string head = xml.str();
+        Put(head.data(), head.size());
+        data_start = ftello(fp);
+    }
+
+    // starts writing array i; arrays may be written in any order, but each exactly once
+    void Begin(int i)
+    {
+        if (cur >= 0)
+            End();
+        cur     = i;
+        written = 0;
+
+        off_t pos = ftello(fp);
+        char  offset[32];
+        sprintf(offset, "%020llu", (unsigned long long)(pos - data_start));
+        Check(fseeko(fp, offset_pos[i], SEEK_SET) == 0);
+        Put(offset, 20);
+        Check(fseeko(fp, pos, SEEK_SET) == 0);
+
+        if (!compress)
+        {
+            uint64_t header = nbytes[i];
+            Put(&header, sizeof(header));
+            return;
+        }
+        uint64_t header[3] = {(nbytes[i] + block_size - 1) / block_size, block_size, nbytes[i] % block_size};
+        Put(header, sizeof(header));
+        sizes_pos = ftello(fp);
+        csizes.assign(header[0], 0);
+        if (csizes.size())
+            Put(&csizes[0], csizes.size() * sizeof(uint64_t));  // placeholders
+        csizes.clear();
+    }
+
+    // appends n floats to the current array
+    void Write(const float* data, size_t n)
+    {
+        written += n * sizeof(float);
+        if (!compress)
+        {
+            Put(data, n * sizeof(float));
+            return;
+        }
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t left = n * sizeof(float); left; )
+        {
+            size_t m = min(left, block_size - block.size());
+            block.insert(block.end(), bytes, bytes + m);
+            bytes   += m;
+            left    -= m;
+            if (block.size() == block_size)
+                FlushBlock();
+        }
+    }
+
+    // finishes the current array
+    void End()
+    {
+        if (written != nbytes[cur])
+        {
+            fprintf(stderr, "Error: VtkXmlImageStream: array %d of %s has %lu bytes instead of %lu\n",
+                    cur, filename.c_str(), written, nbytes[cur]);
+            exit(1);
+        }
+        if (compress)
+        {
+            if (block.size())
+                FlushBlock();
+            off_t pos = ftello(fp);
+            Check(fseeko(fp, sizes_pos, SEEK_SET) == 0);
+            Put(csizes.empty() ? NULL : &csizes[0], csizes.size() * sizeof(uint64_t));
+            Check(fseeko(fp, pos, SEEK_SET) == 0);
+        }
+        cur = -1;
+    }
+
+    void Close()
+    {
+        if (cur >= 0)
+            End();
+        const char* tail = "\n  </AppendedData>\n</VTKFile>\n";
+        Put(tail, strlen(tail));
+        fclose(fp);
+        fp = NULL;
+    }
+
+    ~VtkXmlImageStream()
+    {
+        if (fp)
+            Close();
+    }
+};
+
+// rectilinear grid piece: point arrays on a grid with one coordinate array per dimension
+inline void write_vtr_piece(
+        const char*                 filename,
+        const int*                  whole_extent,   // [x0 x1 y0 y1 z0 z1] of the global grid
+        const int*                  extent,         // [x0 x1 y0 y1 z0 z1] of this piece
+        const float*                x,              // extent[1] - extent[0] + 1 coordinates
+        const float*                y,
+        const float*                z,
+        const vector<VtkXmlArray>&  arrays,
+        bool                        compress)
+{
+    ostringstream           xml;
+    vector<unsigned char>   appended;
+    vtk_xml_open(xml, "RectilinearGrid", compress);
+    xml << "<RectilinearGrid WholeExtent=\"";
+    vtk_xml_extent(xml, whole_extent);
+    xml << "\">\n  <Piece Extent=\"";
+    vtk_xml_extent(xml, extent);
+    xml << "\">\n";
+    vtk_xml_point_data(xml, appended, arrays, compress);
+    xml << "    <Coordinates>\n";
+    const float*    coords[3]   = {x, y, z};
+    const char*     names[3]    = {"x", "y", "z"};
+    for (auto i = 0; i < 3; i++)
+    {
+        size_t offset = vtk_xml_append(appended, coords[i], (extent[2 * i + 1] - extent[2 * i] + 1) * sizeof(float), compress);
+        vtk_xml_data_array(xml, "Float32", names[i], 1, offset);
+    }
+    xml << "    </Coordinates>\n  </Piece>\n</RectilinearGrid>\n";
+    vtk_xml_close(filename, xml, appended);
+}
+
+// number of vertices of a VTK linear cell type (same types as VISIT_* in writer.hpp)
+inline int vtk_xml_cell_npts(int celltype)
+{
+    switch (celltype)
+    {
+        case 1:  return 1;                          // vertex
+        case 3:  return 2;                          // line
+        case 5:  return 3;                          // triangle
+        case 9:  return 4;                          // quad
+        case 10: return 4;                          // tetra
+        case 12: return 8;                          // hexahedron
+        case 13: return 6;                          // wedge
+        case 14: return 5;                          // pyramid
+    }
+    fprintf(stderr, "Error: unsupported cell type %d\n", celltype);
+    exit(1);
+}
+
+// unstructured grid piece: points, cells, and point arrays
+inline void write_vtu_piece(
+        const char*                 filename,
+        size_t                      npts,
+        const float*                pts,            // 3 * npts coordinates
+        size_t                      ncells,
+        const int*                  celltypes,      // VISIT_* or VTK cell type of each cell
+        const int*                  conn,           // vertices of all cells, concatenated
+        const vector<VtkXmlArray>&  arrays,
+        bool                        compress)
+{
+    ostringstream           xml;
+    vector<unsigned char>   appended;
+    vtk_xml_open(xml, "UnstructuredGrid", compress);
+    xml << "<UnstructuredGrid>\n  <Piece NumberOfPoints=\"" << npts << "\" NumberOfCells=\"" << ncells << "\">\n";
+    vtk_xml_point_data(xml, appended, arrays, compress);
+
+    xml << "    <Points>\n";
+    vtk_xml_data_array(xml, "Float32", "Points", 3, vtk_xml_append(appended, pts, 3 * npts * sizeof(float), compress));
+    xml << "    </Points>\n";
+
+    vector<int64_t>         connectivity;
+    vector<int64_t>         offsets(ncells);
+    vector<unsigned char>   types(ncells);
+    for (size_t i = 0, k = 0; i < ncells; i++)
+    {
+        int nv = vtk_xml_cell_npts(celltypes[i]);
+        for (auto j = 0; j < nv; j++)
+            connectivity.push_back(conn[k++]);
+        offsets[i]  = connectivity.size();
+        types[i]    = celltypes[i];
+    }
+    xml << "    <Cells>\n";
+    vtk_xml_data_array(xml, "Int64", "connectivity", 1,
+            vtk_xml_append(appended, connectivity.empty() ? NULL : &connectivity[0], connectivity.size() * sizeof(int64_t), compress));
+    vtk_xml_data_array(xml, "Int64", "offsets", 1,
+            vtk_xml_append(appended, offsets.empty() ? NULL : &offsets[0], offsets.size() * sizeof(int64_t), compress));
+    vtk_xml_data_array(xml, "UInt8", "types", 1,
+            vtk_xml_append(appended, types.empty() ? NULL : &types[0], types.size(), compress));
+    xml << "    </Cells>\n  </Piece>\n</UnstructuredGrid>\n";
+    vtk_xml_close(filename, xml, appended);
+}
+
+// parallel index of structured pieces (.pvti or .pvtr)
+inline void vtk_xml_write_pstructured(
+        const char*                 filename,
+        const char*                 type,           // "PImageData" or "PRectilinearGrid"
+        const string&               grid_attrs,     // attributes of the grid element after WholeExtent
+        const int*                  whole_extent,
+        const vector<VtkXmlArray>&  arrays,         // names and components of the point arrays (data unused)
+        const vector<int>&          extents,        // 6 ints per piece
+        const vector<string>&       sources,        // file name of each piece
+        bool                        rectilinear)
+{
+    ostringstream xml;
+    xml << "<?xml version=\"1.0\"?>\n";
+    xml << "<VTKFile type=\"" << type << "\" version=\"1.0\" byte_order=\"" << vtk_xml_byte_order() << "\" header_type=\"UInt64\">\n";
+    xml << "<" << type << " WholeExtent=\"";
+    vtk_xml_extent(xml, whole_extent);
+    xml << "\"" << grid_attrs << " GhostLevel=\"0\">\n";
+    xml << "  <PPointData>\n";
+    for (auto i = 0; i < arrays.size(); i++)
+        xml << "    <PDataArray type=\"Float32\" Name=\"" << arrays[i].name << "\" NumberOfComponents=\"" << arrays[i].ncomp << "\"/>\n";
+    xml << "  </PPointData>\n";
+    if (rectilinear)
+        xml << "  <PCoordinates>\n"
+            << "    <PDataArray type=\"Float32\" Name=\"x\"/>\n"
+            << "    <PDataArray type=\"Float32\" Name=\"y\"/>\n"
+            << "    <PDataArray type=\"Float32\" Name=\"z\"/>\n"
+            << "  </PCoordinates>\n";
+    for (auto i = 0; i < sources.size(); i++)
+    {
+        xml << "  <Piece Extent=\"";
+        vtk_xml_extent(xml, &extents[6 * i]);
+        xml << "\" Source=\"" << sources[i] << "\"/>\n";
+    }
+    xml << "</" << type << ">\n</VTKFile>\n";
+
+    FILE* fp = fopen(filename, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: unable to open %s for writing\n", filename);
+        exit(1);
+    }
+    fputs(xml.str().c_str(), fp);
+    fclose(fp);
+}
+
+inline void write_pvti(
+        const char*                 filename,
+        const int*                  whole_extent,
+        const float*                origin,
+        const float*                spacing,
+        const vector<VtkXmlArray>&  arrays,
+        const vector<int>&          extents,
+        const vector<string>&       sources)
+{
+    ostringstream attrs;
+    attrs.precision(9);
+    attrs << " Origin=\"" << origin[0] << " " << origin[1] << " " << origin[2]
+        << "\" Spacing=\"" << spacing[0] << " " << spacing[1] << " " << spacing[2] << "\"";
+    vtk_xml_write_pstructured(filename, "PImageData", attrs.str(), whole_extent, arrays, extents, sources, false);
+}
+
+inline void write_pvtr(
+        const char*                 filename,
+        const int*                  whole_extent,
+        const vector<VtkXmlArray>&  arrays,
+        const vector<int>&          extents,
+        const vector<string>&       sources)
+{
+    vtk_xml_write_pstructured(filename, "PRectilinearGrid", "", whole_extent, arrays, extents, sources, true);
+}
+
+inline void write_pvtu(
+        const char*                 filename,
+        const vector<VtkXmlArray>&  arrays,
+        const vector<string>&       sources)
+{
+    FILE* fp = fopen(filename, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: unable to open %s for writing\n", filename);
+        exit(1);
+    }
+    fprintf(fp, "<?xml version=\"1.0\"?>\n");
+    fprintf(fp, "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\">\n", vtk_xml_byte_order());
+    fprintf(fp, "<PUnstructuredGrid GhostLevel=\"0\">\n  <PPointData>\n");
+    for (auto i = 0; i < arrays.size(); i++)
+        fprintf(fp, "    <PDataArray type=\"Float32\" Name=\"%s\" NumberOfComponents=\"%d\"/>\n", arrays[i].name.c_str(), arrays[i].ncomp);
+    fprintf(fp, "  </PPointData>\n  <PPoints>\n    <PDataArray type=\"Float32\" Name=\"Points\" NumberOfComponents=\"3\"/>\n  </PPoints>\n");
+    for (auto i = 0; i < sources.size(); i++)
+        fprintf(fp, "  <Piece Source=\"%s\"/>\n", sources[i].c_str());
+    fprintf(fp, "</PUnstructuredGrid>\n</VTKFile>\n");
+    fclose(fp);
+}
+
+#endif
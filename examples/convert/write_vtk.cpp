@@ -20,6 +20,7 @@
 #include    "opts.h"
 
 #include    "writer.hpp"
+#include    "vtk_xml_writer.hpp"
 #include    "block.hpp"
 
 template<typename T>
@@ -263,7 +264,7 @@ void PrepRenderingData(
     // number of geometry dimensions and science variables
     int ndom_dims   = block->geometry.mfa_data->tmesh.tensor_prods[0].ctrl_pts.cols();          // number of geometry dims
     nvars           = block->vars.size();                       // number of science variables
-    pt_dim          = block->input->pt_dim;                     // dimensionality of point
+    pt_dim          = block->pt_dim;                            // dimensionality of point
 
     // number of output points for blend
     for (size_t j = 0; j < (size_t)(block->ndom_outpts.size()); j++)
@@ -661,6 +662,145 @@ void write_vtk_files(
     delete[] blend_data;
 }
 
+// extract an isosurface of a science variable directly from the mfa and write it as a triangle mesh
+void write_isosurface(
+        Block<real_t>* b,
+        const          diy::Master::ProxyWithLink& cp,
+        int            sci_var,                     // science variable to contour
+        real_t         iso,                         // isovalue
+        int            iso_res,                     // number of grid points in each dim. for extraction
+        int            xml)                         // 0 = legacy vtk, 1 = xml .vtu, 2 = xml .vtu with lz4 compression
+{
+    if (b->dom_dim != 3)
+    {
+        fprintf(stderr, "Isosurfaces are only available for 3d domains, skipping\n");
+        return;
+    }
+    vector<int> grid_size(b->dom_dim, iso_res);
+    b->isosurface_block(cp, 1, sci_var, iso, grid_size);
+
+    vector<vec3d> iso_pts(b->iso_mesh.verts.rows());
+    for (auto i = 0; i < iso_pts.size(); i++)
+    {
+        iso_pts[i].x = b->iso_mesh.verts(i, 0);
+        iso_pts[i].y = b->iso_mesh.verts(i, 1);
+        iso_pts[i].z = b->iso_mesh.verts(i, 2);
+    }
+    vector<int> cell_types(b->iso_mesh.ntris(), VISIT_TRIANGLE);
+
+    char filename[256];
+    if (xml)
+    {
+        // every block writes a piece, even an empty one, so that the .pvtu index is complete
+        sprintf(filename, "isosurface_var%d_gid_%d.vtu", sci_var, cp.gid());
+        write_vtu_piece(filename, iso_pts.size(), iso_pts.size() ? &(iso_pts[0].x) : NULL,
+                cell_types.size(), cell_types.size() ? &cell_types[0] : NULL,
+                b->iso_mesh.tris.size() ? &b->iso_mesh.tris[0] : NULL, vector<VtkXmlArray>(), xml > 1);
+        return;
+    }
+    sprintf(filename, "isosurface_var%d_gid_%d.vtk", sci_var, cp.gid());
+    if (iso_pts.size())
+        write_unstructured_mesh(
+            /* const char *filename */                      filename,
+            /* int useBinary */                             0,
+            /* int npts */                                  iso_pts.size(),
+            /* float *pts */                                &(iso_pts[0].x),
+            /* int ncells */                                cell_types.size(),
+            /* int *celltypes */                            &cell_types[0],
+            /* int *conn */                                 &b->iso_mesh.tris[0],
+            /* int nvars */                                 0,
+            /* int *vardim */                               NULL,
+            /* int *centering */                            NULL,
+            /* const char * const *varnames */              NULL,
+            /* float **vars */                              NULL);
+}
+
+// decode a block on its part of a global regular grid and write it as a .vti piece
+// the grid is decoded and streamed to the file in tiles, with at most max_bytes of values in memory
+// neighboring pieces share the grid points on their common boundary
+// the piece's gid and extent (7 ints) are appended to pieces for the .pvti index
+void write_grid_vti(
+        Block<real_t>*                      b,
+        const diy::Master::ProxyWithLink&   cp,
+        const VectorX<real_t>&              dom_mins,       // minimum corner of the global domain
+        const VectorX<real_t>&              dom_maxs,       // maximum corner of the global domain
+        int                                 grid_res,       // number of points in each dim. of the global grid
+        bool                                compress,       // lz4 compression of the point arrays
+        size_t                              max_bytes,      // memory budget for the values of one tile
+        vector<int>&                        pieces)         // (output) gid and extent of the piece
+{
+    int dom_dim = b->dom_dim;
+    if (dom_dim > 3)
+    {
+        fprintf(stderr, "Image data is only available for domains up to 3d, skipping\n");
+        return;
+    }
+
+    // params are linear in the domain between the geometry at params 0 and 1
+    VectorX<real_t> p0(dom_dim), p1(dom_dim);
+    b->mfa->DecodePt(*b->geometry.mfa_data, VectorX<real_t>::Zero(dom_dim), p0);
+    b->mfa->DecodePt(*b->geometry.mfa_data, VectorX<real_t>::Ones(dom_dim), p1);
+
+    int             whole_extent[6], extent[6];
+    float           origin[3], spacing[3];
+    VectorXi        npts(dom_dim);
+    VectorX<real_t> param_mins(dom_dim), param_maxs(dom_dim);
+    for (auto k = 0; k < 3; k++)
+    {
+        whole_extent[2 * k] = whole_extent[2 * k + 1] = extent[2 * k] = extent[2 * k + 1] = 0;
+        origin[k]   = 0.0;
+        spacing[k]  = 1.0;
+        if (k >= dom_dim)
+            continue;
+
+        // grid points owned by the core, including the ones on its maximum side
+        real_t h        = (dom_maxs(k) - dom_mins(k)) / (grid_res - 1);
+        int    i0       = ceil((b->core_mins(k) - dom_mins(k)) / h - 1e-6);
+        int    i1       = ceil((b->core_maxs(k) - dom_mins(k)) / h - 1e-6);
+        i1              = max(i0, min(grid_res - 1, i1));
+        whole_extent[2 * k + 1] = grid_res - 1;
+        extent[2 * k]           = i0;
+        extent[2 * k + 1]       = i1;
+        origin[k]               = dom_mins(k);
+        spacing[k]              = h;
+
+        npts(k)         = i1 - i0 + 1;
+        real_t range    = p1(k) - p0(k);
+        param_mins(k)   = min(max((dom_mins(k) + i0 * h - p0(k)) / range, real_t(0.0)), real_t(1.0));
+        param_maxs(k)   = min(max((dom_mins(k) + i1 * h - p0(k)) / range, real_t(0.0)), real_t(1.0));
+        if (npts(k) == 1)
+            param_maxs(k) = param_mins(k);
+    }
+
+    // one float array per science variable, dim. 0 fastest like the grid
+    vector<VtkXmlArray> arrays;
+    for (auto i = 0; i < b->vars.size(); i++)
+        arrays.push_back(VtkXmlArray("var" + to_string(i), 1, NULL, npts.prod()));
+
+    char filename[256];
+    sprintf(filename, "grid_gid_%d.vti", cp.gid());
+    VtkXmlImageStream vti(filename, whole_extent, extent, origin, spacing, arrays, compress);
+
+    // assumes each variable is scalar
+    vector<float> tile;
+    auto sink = [&](size_t first, const MatrixX<real_t>& values)
+    {
+        tile.resize(values.rows());
+        for (auto j = 0; j < tile.size(); j++)
+            tile[j] = values(j, 0);
+        vti.Write(&tile[0], tile.size());
+    };
+    for (auto i = 0; i < b->vars.size(); i++)
+    {
+        vti.Begin(i);
+        b->mfa->DecodeAtGridTiled(*(b->vars[i].mfa_data), param_mins, param_maxs, npts, max_bytes, sink);
+    }
+    vti.Close();
+
+    pieces.push_back(cp.gid());
+    pieces.insert(pieces.end(), extent, extent + 6);
+}
+
 // generate analytical test data and write to vtk
 void test_and_write(Block<real_t>*                      b,
                     const diy::Master::ProxyWithLink&   cp,
@@ -801,6 +941,11 @@ int main(int argc, char ** argv)
     bool                        help;                   // show help
     int                         dom_dim, pt_dim;        // domain and point dimensionality, respectively
     int                         sci_var = 0;            // science variable to render geometrically for 1d and 2d domains
+    real_t                      iso     = 0.0;          // isovalue for isosurface of sci_var (3d domains)
+    int                         iso_res = 0;            // grid points in each dim. for isosurface extraction (0 = no isosurface)
+    int                         grid_res = 0;           // grid points in each dim. of the global domain for image data (0 = none)
+    int                         xml     = 0;            // 0 = legacy vtk, 1 = parallel xml vtk, 2 = parallel xml vtk with lz4 compression
+    int                         tile_mb = 64;           // memory budget in MB for decoding image data in tiles
 
     // get command line arguments
     opts::Options ops;
@@ -808,6 +953,11 @@ int main(int argc, char ** argv)
     ops >> opts::Option('a', "ntest",       ntest,      " number of test points in each dimension of domain (for analytical error calculation)");
     ops >> opts::Option('i', "input",       input,      " input dataset");
     ops >> opts::Option('v', "var",         sci_var,    " science variable to render geometrically for 1d and 2d domains");
+    ops >> opts::Option('s', "iso",         iso,        " isovalue of science variable to extract (3d domains)");
+    ops >> opts::Option('r', "iso_res",     iso_res,    " number of grid points in each dimension for isosurface extraction (0 = none)");
+    ops >> opts::Option('g', "grid_res",    grid_res,   " number of grid points in each dimension of the global domain for image data output (0 = none, raw values of each block's own grid with -x 0)");
+    ops >> opts::Option('x', "xml",         xml,        " isosurface and image data format: 0 = legacy vtk, 1 = parallel xml vtk, 2 = xml with lz4 compression");
+    ops >> opts::Option('t', "tile_mb",     tile_mb,    " memory budget in MB for the values of one tile when decoding image data");
     ops >> opts::Option('h', "help",        help,       " show help");
 
     if (!ops.parse(argc, argv) || help)
@@ -852,6 +1002,95 @@ int main(int argc, char ** argv)
     master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
             { write_vtk_files(b, cp, sci_var, dom_dim, pt_dim); });
 
+    // isosurface extracted directly from the mfa
+    if (iso_res > 1)
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                { write_isosurface(b, cp, sci_var, iso, iso_res, xml); });
+
+    // index of the isosurface pieces, one per block
+    if (iso_res > 1 && xml && world.rank() == 0 && dom_dim == 3)
+    {
+        vector<string> sources(assigner.nblocks());
+        char filename[256];
+        for (auto i = 0; i < sources.size(); i++)
+        {
+            sprintf(filename, "isosurface_var%d_gid_%d.vtu", sci_var, i);
+            sources[i] = filename;
+        }
+        sprintf(filename, "isosurface_var%d.pvtu", sci_var);
+        write_pvtu(filename, vector<VtkXmlArray>(), sources);
+    }
+
+    // raw values decoded on the grid of each block, streamed to disk
+    if (grid_res > 1 && !xml)
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+        {
+            vector<int> grid_size(b->dom_dim, grid_res);
+            char filename[256];
+            sprintf(filename, "grid_gid_%d.raw", cp.gid());
+            b->decode_block_grid_raw(cp, grid_size, size_t(tile_mb) << 20, filename);
+        });
+
+    // image data decoded on a global grid, one .vti piece per block and a .pvti index
+    if (grid_res > 1 && xml)
+    {
+        // global domain from the block cores
+        VectorX<real_t> dom_mins, dom_maxs;
+        for (auto i = 0; i < master.size(); i++)
+        {
+            Block<real_t>* b = master.block<Block<real_t>>(i);
+            if (i == 0)
+            {
+                dom_mins = b->core_mins;
+                dom_maxs = b->core_maxs;
+            }
+            dom_mins = dom_mins.cwiseMin(b->core_mins);
+            dom_maxs = dom_maxs.cwiseMax(b->core_maxs);
+        }
+        vector<real_t> mins(dom_mins.data(), dom_mins.data() + dom_mins.size());
+        vector<real_t> maxs(dom_maxs.data(), dom_maxs.data() + dom_maxs.size());
+        for (auto k = 0; k < mins.size(); k++)
+        {
+            diy::mpi::all_reduce(world, mins[k], dom_mins(k), diy::mpi::minimum<real_t>());
+            diy::mpi::all_reduce(world, maxs[k], dom_maxs(k), diy::mpi::maximum<real_t>());
+        }
+
+        vector<int> pieces;
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                { write_grid_vti(b, cp, dom_mins, dom_maxs, grid_res, xml > 1, size_t(tile_mb) << 20, pieces); });
+
+        vector<vector<int>> all_pieces;
+        diy::mpi::gather(world, pieces, all_pieces, 0);
+        if (world.rank() == 0 && dom_mins.size() <= 3)
+        {
+            vector<int>     extents;
+            vector<string>  sources;
+            char            filename[256];
+            for (auto r = 0; r < all_pieces.size(); r++)
+                for (auto j = 0; j < all_pieces[r].size(); j += 7)
+                {
+                    sprintf(filename, "grid_gid_%d.vti", all_pieces[r][j]);
+                    sources.push_back(filename);
+                    extents.insert(extents.end(), &all_pieces[r][j + 1], &all_pieces[r][j + 7]);
+                }
+
+            int     whole_extent[6] = {0, 0, 0, 0, 0, 0};
+            float   origin[3]       = {0.0, 0.0, 0.0};
+            float   spacing[3]      = {1.0, 1.0, 1.0};
+            for (auto k = 0; k < dom_mins.size(); k++)
+            {
+                whole_extent[2 * k + 1] = grid_res - 1;
+                origin[k]               = dom_mins(k);
+                spacing[k]              = (dom_maxs(k) - dom_mins(k)) / (grid_res - 1);
+            }
+
+            vector<VtkXmlArray> arrays;
+            for (auto i = 0; i < master.block<Block<real_t>>(0)->vars.size(); i++)
+                arrays.push_back(VtkXmlArray("var" + to_string(i), 1, NULL, 0));
+            write_pvti("grid.pvti", whole_extent, origin, spacing, arrays, extents, sources);
+        }
+    }
+
     // rest of the code tests analytical functions and writes those files
 
     if (ntest <= 0)
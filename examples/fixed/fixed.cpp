@@ -55,6 +55,14 @@ int main(int argc, char** argv)
     string infile;                              // input file name
     int    structured   = 1;                    // input data format (bool 0/1)
     int    rand_seed    = -1;                   // seed to use for random data generation (-1 == no randomization)
+    int    sample_max   = 0;                    // max. number of points to decode for a sampled error estimate (0 = decode all)
+    real_t sample_tol   = 0.01;                 // target relative half-width of confidence interval on sampled RMS error
+    int    integrate    = 0;                    // integrate science variables over the domain, print mean and variance (bool 0/1)
+    real_t save_err     = 0.0;                  // absolute error bound for compressing saved control points (0 = exact)
+    int    mem_budget   = 0;                    // memory budget per block in MB (0 = none)
+    int    model_only   = 0;                    // save only the model, without input, approx, and errors (bool 0/1)
+    int    stride       = 1;                    // distance between points taken from an input file (same for all dims)
+    int    pyramid      = 0;                    // write a multiresolution pyramid of the science variables (bool 0/1)
     bool   help         = false;                // show help
 
 
@@ -78,6 +86,14 @@ int main(int argc, char** argv)
     ops >> opts::Option('h', "help",        help,       " show help");
     ops >> opts::Option('x', "structured",  structured, " input data format (default=structured=true)");
     ops >> opts::Option('y', "rand_seed",   rand_seed,  " seed for random point generation (-1 = no randomization, default)");
+    ops >> opts::Option('b', "sample_max",  sample_max, " max. points to decode for a sampled error estimate (0 = decode all, default)");
+    ops >> opts::Option('l', "sample_tol",  sample_tol, " target relative half-width of confidence interval on sampled RMS error");
+    ops >> opts::Option('k', "integrate",   integrate,  " integrate science variables over the domain and print mean and variance");
+    ops >> opts::Option('e', "save_err",    save_err,   " absolute error bound for compressing control points of the saved model (0 = exact, default)");
+    ops >> opts::Option('u', "mem_budget",  mem_budget, " memory budget per block in MB: streaming errors, input released after encoding, model-only save (0 = none, default)");
+    ops >> opts::Option('o', "model_only",  model_only, " save only the model, without input, approx, and errors");
+    ops >> opts::Option('j', "stride",      stride,     " distance between points taken from an input file (1 = all points, default)");
+    ops >> opts::Option('z', "pyramid",     pyramid,    " write a multiresolution pyramid of the science variables to pyramid_gid_<gid>.mfp");
 
     if (!ops.parse(argc, argv) || help)
     {
@@ -170,6 +186,7 @@ int main(int argc, char** argv)
         d_args.ndom_pts[i]          = ndomp;
         d_args.geom_nctrl_pts[i]    = geom_nctrl;
         d_args.vars_nctrl_pts[0][i] = vars_nctrl;       // assuming one science variable, vars_nctrl_pts[0]
+        d_args.strides[i]           = stride;
     }
 
     // initialize input data
@@ -463,6 +480,11 @@ int main(int argc, char** argv)
     // compute the MFA
 
     fprintf(stderr, "\nStarting fixed encoding...\n\n");
+    master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+            {
+                b->mem_budget       = size_t(mem_budget) << 20;
+                b->save_model_only  = model_only;
+            });
     double encode_time = MPI_Wtime();
     master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
             { b->fixed_encode_block(cp, d_args); });
@@ -479,12 +501,36 @@ int main(int argc, char** argv)
                 { b->error(cp, 1, true); });
 #else                   // range coordinate difference
         bool saved_basis = structured; // TODO: basis functions are currently only saved during encoding of structured data
-        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
-                { b->range_error(cp, 1, true, saved_basis); });
+        if (sample_max > 0)
+            master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                    { b->sampled_range_error(cp, 1, sample_max, sample_tol); });
+        else
+            master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                    { b->range_error(cp, 1, true, saved_basis); });
 #endif
         decode_time = MPI_Wtime() - decode_time;
     }
 
+    // levels of detail of the science variables, coarse to fine, for progressive transmission
+    if (pyramid)
+    {
+        fprintf(stderr, "\nBuilding model pyramids...\n");
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                { b->pyramid_block(cp, "pyramid", VectorXi(), 0); });
+    }
+
+    // exact integral, mean, and variance of science variables over the whole domain, without decoding
+    if (integrate)
+    {
+        VectorX<real_t> box_mins = VectorX<real_t>::Constant(dom_dim, -numeric_limits<real_t>::max());
+        VectorX<real_t> box_maxs = VectorX<real_t>::Constant(dom_dim, numeric_limits<real_t>::max());
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                { b->integrate_block(cp, box_mins, box_maxs, 0); });
+        master.exchange();
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                { b->box_stats(cp, 1); });
+    }
+
     // debug: write original and approximated data for reading into z-checker
     // only for one block (one file name used, ie, last block will overwrite earlier ones)
 //     master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
@@ -524,5 +570,7 @@ int main(int argc, char** argv)
     fprintf(stderr, "-------------------------------------\n\n");
 
     // save the results in diy format
+    master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+            { b->save_err_bound = save_err; });
     diy::io::write_blocks("approx.mfa", world, master);
 }
@@ -24,6 +24,9 @@
 
 #include "block.hpp"
 
+#include <mfa/model_file.hpp>
+#include <mfa/async_writer.hpp>
+
 using namespace std;
 
 int main(int argc, char** argv)
@@ -52,6 +55,11 @@ int main(int argc, char** argv)
     real_t noise        = 0.0;                  // fraction of noise
     int    error        = 1;                    // decode all input points and check error (bool 0 or 1)
     string infile;                              // input file name
+    string render;                              // volume render the first science variable to this PPM file (3-d only)
+    int    img_size     = 256;                  // rendered image size in pixels (same for both dims)
+    int    indexed      = 0;                    // also write an indexed model file for selective loading (bool 0/1)
+    int    async        = 0;                    // write approx.mfa in a background thread (bool 0/1)
+    int    stride       = 1;                    // distance between points taken from a raw input file (same for all dims)
     bool   help;                                // show help
 
     // get command line arguments
@@ -72,6 +80,11 @@ int main(int argc, char** argv)
     ops >> opts::Option('s', "noise",       noise,      " fraction of noise (0.0 - 1.0)");
     ops >> opts::Option('c', "error",       error,      " decode entire error field (default=true)");
     ops >> opts::Option('f', "infile",      infile,     " input file name");
+    ops >> opts::Option('r', "render",      render,     " volume render the first science variable to a PPM file");
+    ops >> opts::Option('z', "img_size",    img_size,   " rendered image size in pixels");
+    ops >> opts::Option('x', "indexed",     indexed,    " also write approx.mfai, indexed by block, variable, and tensor");
+    ops >> opts::Option('y', "async",       async,      " write approx.mfa in the background, overlapped with writing approx.mfai");
+    ops >> opts::Option('j', "stride",      stride,     " distance between points taken from a raw input file (1 = all points, default)");
     ops >> opts::Option('h', "help",        help,       " show help");
 
     if (!ops.parse(argc, argv) || help)
@@ -142,6 +155,16 @@ int main(int argc, char** argv)
         dom_bounds.max[i] =  4.0 * M_PI;
     }
 
+    // raw input file: the domain is the index space of its grid
+    if (input == "raw")
+    {
+        for (int i = 0; i < dom_dim; ++i)
+        {
+            dom_bounds.min[i] = 0.0;
+            dom_bounds.max[i] = ndomp - 1;
+        }
+    }
+
     // decompose the domain into blocks
     Decomposer<real_t> decomposer(dom_dim, dom_bounds, tot_blocks);
     decomposer.decompose(world.rank(),
@@ -183,6 +206,20 @@ int main(int argc, char** argv)
 
     // initilize input data
 
+    // raw grid of float values with ndomp points in each dimension, mapped from the input file
+    // each block takes every stride points inside its bounds
+    if (input == "raw")
+    {
+        d_args.infile = infile;
+        for (int i = 0; i < dom_dim; i++)
+        {
+            d_args.ndom_pts[i]  = ndomp;
+            d_args.strides[i]   = stride;
+        }
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                { b->read_mapped_data<float>(cp, d_args, 1); });
+    }
+
     // sine function f(x) = sin(x), f(x,y) = sin(x)sin(y), ...
     if (input == "sine")
     {
@@ -262,6 +299,67 @@ int main(int argc, char** argv)
     if (world.rank() == 0)
         fprintf(stderr, "\n\nFixed encoding done.\n\n");
 
+    // volume render the first science variable, composite with binary swap, and write the image
+    if (render.size() && dom_dim == 3)
+    {
+        // global range of the variable for the transfer function
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                {
+                    cp.all_reduce(b->bounds_mins(dom_dim), diy::mpi::minimum<real_t>());
+                    cp.all_reduce(b->bounds_maxs(dom_dim), diy::mpi::maximum<real_t>());
+                });
+        master.exchange();
+        real_t vmin = 0.0, vmax = 0.0;
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                {
+                    vmin = cp.get<real_t>();
+                    vmax = cp.get<real_t>();
+                });
+
+        // transparent middle of the range, blue low values and red high values
+        real_t diag     = sqrt(3.0) * (dom_bounds.max[0] - dom_bounds.min[0]);
+        real_t density  = 10.0 / diag;
+        mfa::TransferFunction<real_t> tf;
+        tf.AddPoint(vmin,                       0.2, 0.3, 1.0, density);
+        tf.AddPoint(vmin + 0.3 * (vmax - vmin), 0.2, 0.3, 1.0, 0.0);
+        tf.AddPoint(vmin + 0.7 * (vmax - vmin), 1.0, 0.3, 0.2, 0.0);
+        tf.AddPoint(vmax,                       1.0, 0.3, 0.2, density);
+
+        mfa::Camera<real_t> cam;
+        cam.center  = VectorX<real_t>::Zero(3);
+        for (int i = 0; i < 3; i++)
+            cam.center(i) = (dom_bounds.min[i] + dom_bounds.max[i]) / 2.0;
+        cam.dir     = VectorX<real_t>(3);
+        cam.dir     << -1.0, -0.7, -0.5;
+        cam.dir.normalize();
+        cam.up      = VectorX<real_t>::Unit(3, 2);
+        cam.up      = (cam.up - cam.up.dot(cam.dir) * cam.dir).normalized();
+        cam.width   = diag;
+        cam.height  = diag;
+        cam.nx      = img_size;
+        cam.ny      = img_size;
+
+        double render_time = MPI_Wtime();
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                { b->render_block(cp, 1, 0, cam, tf, diag / img_size); });
+        diy::RegularSwapPartners swap_partners(decomposer, 2, true);
+        diy::reduce(master, assigner, swap_partners,
+                [&](Block<real_t>* b, const diy::ReduceProxy& rp, const diy::RegularSwapPartners& partners)
+                { b->composite_image(rp, partners); });
+        diy::RegularMergePartners merge_partners(decomposer, 2, true);
+        diy::reduce(master, assigner, merge_partners,
+                [&](Block<real_t>* b, const diy::ReduceProxy& rp, const diy::RegularMergePartners& partners)
+                { b->gather_image(rp, partners); });
+        master.foreach([&](Block<real_t>* b, const diy::Master::ProxyWithLink& cp)
+                {
+                    if (cp.gid() == 0)
+                        b->image.WritePPM(render);
+                });
+        render_time = MPI_Wtime() - render_time;
+        if (world.rank() == 0)
+            fprintf(stderr, "rendering time = %.3lf s., image written to %s\n\n", render_time, render.c_str());
+    }
+
     // debug: compute error field for visualization and max error to verify that it is below the threshold
     double decode_time = MPI_Wtime();
     if (error)
@@ -312,5 +410,24 @@ int main(int argc, char** argv)
         fprintf(stderr, "\noverall encoding time = %.3lf s.\n", encode_time);
 
     // save the results in diy format
-    diy::io::write_blocks("approx.mfa", world, master);
+    if (async)
+    {
+        double write_time = MPI_Wtime();
+        mfa::AsyncWriter writer(world);
+        writer.Write("approx.mfa", master);
+        double return_time = MPI_Wtime() - write_time;
+        if (indexed)
+            mfa::write_indexed<Block<real_t>, real_t>("approx.mfai", master, world);
+        writer.Wait();
+        write_time = MPI_Wtime() - write_time;
+        if (world.rank() == 0)
+            fprintf(stderr, "async write: returned after %.3lf s., done after %.3lf s. (%.3lf s. in the background)\n",
+                    return_time, write_time, writer.time());
+    }
+    else
+    {
+        diy::io::write_blocks("approx.mfa", world, master);
+        if (indexed)
+            mfa::write_indexed<Block<real_t>, real_t>("approx.mfai", master, world);
+    }
 }
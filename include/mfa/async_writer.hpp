@@ -0,0 +1,206 @@
+//--------------------------------------------------------------
+// asynchronous writer of blocks, overlapping the file system with computation
+//
+// Write() serializes the blocks into memory and agrees on their offsets with
+// the other ranks (collective, but cheap); a background thread per rank then
+// writes them with POSIX pwrite while the caller goes on, e.g. encoding the
+// next time step; Wait() blocks until the data are in the file
+//
+// the file has the layout of diy::io::write_blocks and is read with
+// diy::io::read_blocks: the blocks of each rank are contiguous, and the
+// footer with the gid, offset, and size of every block is written by rank 0
+//
+// the background thread makes no MPI calls, so MPI needs no thread support
+// beyond the default
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _ASYNC_WRITER_HPP
+#define _ASYNC_WRITER_HPP
+
+#include    <diy/master.hpp>
+#include    <diy/io/block.hpp>
+
+#include    <fcntl.h>
+#include    <unistd.h>
+#include    <thread>
+#include    <chrono>
+#include    <algorithm>
+#include    <atomic>
+#include    <string>
+#include    <vector>
+
+using namespace std;
+
+namespace mfa
+{
+    class AsyncWriter
+    {
+        typedef diy::io::detail::offset_t           offset_t;
+        typedef diy::io::detail::GidOffsetCount     GidOffsetCount;
+
+        diy::mpi::communicator  comm;
+        thread                  worker;             // background thread writing the last file
+        atomic<bool>            done;               // whether the last write finished
+        string                  filename;           // file being written
+        vector<char>            data;               // serialized blocks of this rank
+        offset_t                offset;             // file offset of data
+        vector<char>            footer;             // diy footer (rank 0 only)
+        offset_t                footer_offset;
+        double                  write_time;         // seconds spent by the background thread in the last write
+
+        AsyncWriter(const AsyncWriter&);            // not copyable, owns a thread
+        AsyncWriter& operator=(const AsyncWriter&);
+
+        // writes n bytes at offset, in as many pwrite calls as needed
+        static void Pwrite(int fd, const char* buf, size_t n, offset_t offset, const string& filename)
+        {
+            while (n)
+            {
+                ssize_t w = pwrite(fd, buf, n, offset);
+                if (w < 0)
+                {
+                    fprintf(stderr, "Error: AsyncWriter: failed writing %s\n", filename.c_str());
+                    exit(1);
+                }
+                buf     += w;
+                n       -= w;
+                offset  += w;
+            }
+        }
+
+        // body of the background thread
+        void Run()
+        {
+            chrono::steady_clock::time_point t = chrono::steady_clock::now();
+            int fd = open(filename.c_str(), O_WRONLY);
+            if (fd < 0)
+            {
+                fprintf(stderr, "Error: AsyncWriter: unable to open %s for writing\n", filename.c_str());
+                exit(1);
+            }
+            Pwrite(fd, data.empty() ? NULL : &data[0], data.size(), offset, filename);
+            Pwrite(fd, footer.empty() ? NULL : &footer[0], footer.size(), footer_offset, filename);
+            close(fd);
+
+            // release the memory of the blocks as soon as they are written
+            vector<char>().swap(data);
+            vector<char>().swap(footer);
+            write_time  = chrono::duration<double>(chrono::steady_clock::now() - t).count();
+            done        = true;
+        }
+
+    public:
+
+        AsyncWriter(const diy::mpi::communicator& comm_) :
+            comm(comm_),
+            done(true),
+            write_time(0.0)                         {}
+
+        ~AsyncWriter()                              { Wait(); }
+
+        // serializes the blocks of master and starts writing them to filename in the background
+        // collective: every rank calls Write, even with no blocks
+        // waits first for the previous write of all ranks, so that files may be reused
+        void Write(
+                const string&               filename_,
+                diy::Master&                master,
+                const diy::MemoryBuffer&    extra   = diy::MemoryBuffer(),  // user-defined metadata for file footer; meaningful only on rank == 0
+                diy::Master::SaveBlock      save    = 0)                    // block save function in case different than or undefined in the master
+        {
+            Wait();
+            comm.barrier();
+
+            if (!save)
+                save = master.saver();
+            filename = filename_;
+
+            // serialize the blocks of this rank back to back
+            diy::MemoryBuffer           bb;
+            vector<offset_t>            starts(master.size());
+            for (auto i = 0; i < master.size(); i++)
+            {
+                starts[i] = bb.buffer.size();
+                diy::LinkFactory::save(bb, master.link(i));
+                save(master.get(i), bb);
+            }
+            data.swap(bb.buffer);
+
+            // create the file before any rank writes into it
+            if (comm.rank() == 0)
+            {
+                int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd < 0)
+                {
+                    fprintf(stderr, "Error: AsyncWriter: unable to open %s for writing\n", filename.c_str());
+                    exit(1);
+                }
+                close(fd);
+            }
+
+            // offsets of the blocks; the scan completes only after rank 0 created the file
+            offset_t count = data.size(), total;
+            diy::mpi::scan(comm, count, offset, std::plus<offset_t>());
+            offset -= count;
+            diy::mpi::all_reduce(comm, count, total, std::plus<offset_t>());
+
+            vector<GidOffsetCount> offset_counts;
+            for (auto i = 0; i < master.size(); i++)
+            {
+                offset_t end = i + 1 < master.size() ? starts[i + 1] : count;
+                offset_counts.push_back(GidOffsetCount(master.gid(i), offset + starts[i], end - starts[i]));
+            }
+
+            // footer: all offsets sorted by gid and the extra metadata, like diy::io::write_blocks
+            diy::MemoryBuffer oc_buffer;
+            diy::save(oc_buffer, offset_counts);
+            footer.clear();
+            footer_offset = total;
+            if (comm.rank() == 0)
+            {
+                vector<vector<char>> gathered;
+                diy::mpi::gather(comm, oc_buffer.buffer, gathered, 0);
+
+                vector<GidOffsetCount> all_offset_counts;
+                for (auto i = 0; i < gathered.size(); i++)
+                {
+                    diy::MemoryBuffer       rank_buffer;
+                    vector<GidOffsetCount>  rank_offset_counts;
+                    rank_buffer.buffer.swap(gathered[i]);
+                    diy::load(rank_buffer, rank_offset_counts);
+                    all_offset_counts.insert(all_offset_counts.end(), rank_offset_counts.begin(), rank_offset_counts.end());
+                }
+                sort(all_offset_counts.begin(), all_offset_counts.end());         // sorts by gid
+
+                diy::MemoryBuffer fb;
+                diy::save(fb, all_offset_counts);
+                diy::save(fb, extra);
+                size_t footer_size = fb.size();
+                diy::save(fb, footer_size);
+                footer.swap(fb.buffer);
+            }
+            else
+                diy::mpi::gather(comm, oc_buffer.buffer, 0);
+
+            done    = false;
+            worker  = thread(&AsyncWriter::Run, this);
+        }
+
+        // whether the last write of this rank finished, without waiting
+        bool Test() const                           { return done; }
+
+        // waits for the last write of this rank to finish (local)
+        void Wait()
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+
+        // seconds spent writing the last file in the background
+        double time() const                         { return write_time; }
+    };
+}
+
+#endif
@@ -17,6 +17,7 @@
 #include    <diy/thirdparty/fmt/format.h>
 #include    <diy/reduce.hpp>
 #include    <diy/partners/merge.hpp>
+#include    <diy/partners/swap.hpp>
 
 #include    <stdio.h>
 
@@ -43,7 +44,10 @@ struct ModelInfo
 {
     ModelInfo(int dom_dim_, int pt_dim_) :
         dom_dim(dom_dim_),
-        pt_dim(pt_dim_)
+        pt_dim(pt_dim_),
+        refit_iters(0),
+        checkpoint_interval(0),
+        checkpoint("adaptive")
     {
         geom_p.resize(dom_dim);
         vars_p.resize(pt_dim - dom_dim);
@@ -65,6 +69,9 @@ struct ModelInfo
     vector<vector<int>> vars_nctrl_pts;         // number of input pts in each dim of each science variable vars_nctrl_pts[var][dim]
     bool                weighted;               // solve for and use weights (default = true)
     bool                local;                  // solve locally (with constraints) each round (default = false)
+    int                 refit_iters;            // max. iterations of warm-started refit per adaptive round (default = 0, direct solve)
+    int                 checkpoint_interval;    // adaptive rounds between checkpoints (default = 0, no checkpoints)
+    string              checkpoint;             // checkpoint file name prefix, completed with _gid_<gid>.ckpt
     int                 verbose;                // debug level
 };
 
@@ -112,13 +119,42 @@ struct BlockBase
                                                 //  needed according to that core; symmetric with neighOverlaps
     vector<int>         map_dir;                // will map current directions with global directions
     vector<T>           max_errs_reduce;        // max_errs used in the reduce operations, plus location (2 T vals per entry)
+    MatrixX<T>          ders;                   // values and partial derivatives of science variables (decode_ders_block)
+    vector<VectorXi>    ders_orders;            // derivative orders in each domain dim. of the columns of ders, per variable
+    vector<T>           box_integrals;          // integral of each science variable over a box, all blocks (integrate_block)
+    vector<T>           box_means;              // mean of each science variable over the box, all blocks
+    vector<T>           box_variances;          // variance of each science variable over the box, all blocks
+    T                   box_volume;             // volume of the box inside the global domain
+    vector<size_t>      range_idxs;             // grid indices of points in a value range (range_block_grid)
+    mfa::TriangleMesh<T> iso_mesh;              // isosurface of a science variable, in domain coordinates (isosurface_block)
+    vector<mfa::CriticalPoint<T>> crit_pts;     // critical points of a science variable (critical_points_block)
+    MatrixX<T>          crit_coords;            // domain coordinates of crit_pts, one row per point
+    vector<mfa::Particle<T>> particles;         // particles to be traced in this block (seed_particles, trace_block)
+    vector<MatrixX<T>>  traces;                 // points of each trace segment in this block, in domain coordinates
+    vector<int>         trace_ids;              // seed id of each trace segment
+    mfa::Image<T>       image;                  // volume rendering of the core, or the rows owned after compositing (render_block)
+    T                   save_err_bound;         // absolute error bound on science variable control points when saving (0 = exact, legacy format)
+
+    // memory budget policy
+    // with a budget, encoding computes the error statistics in one streaming pass (no approx or errs)
+    // and then releases the input, and only the model is saved
+    size_t              mem_budget;             // memory budget of the block in bytes (0 = none)
+    bool                save_model_only;        // save the model without input, approx, errs, and blending output
+    size_t              peak_mem;               // peak bytes held by the point sets, models, and blending output (track_mem)
+    size_t              input_npts;             // number of input points, kept when the input is released
+    VectorX<T>          input_extents;          // range extent of each science variable, kept when the input is released
 
     // zero-initialize pointers during default construction
     BlockBase() : 
         mfa(NULL), 
         input(NULL), 
         approx(NULL), 
-        errs(NULL) { }
+        errs(NULL),
+        save_err_bound(0.0),
+        mem_budget(0),
+        save_model_only(false),
+        peak_mem(0),
+        input_npts(0) { }
 
     ~BlockBase()
     {
@@ -225,6 +261,7 @@ struct BlockBase
             vars[i].mfa_data->set_knots(*input);
             mfa->FixedEncode(*(vars[i].mfa_data), *input, nctrl_pts, a->verbose, a->weighted);
         }
+        apply_mem_budget(cp, input->structured);
 
 		// ------- Save mfab file which is the minimal mfa file, jianxin add start -------
 #if 1 // turn off for testing the GAN based parameter learning idea
@@ -261,11 +298,14 @@ struct BlockBase
     }
 
     // adaptively encode block to desired error limit
+    // with info.checkpoint_interval > 0, checkpoints are written every so many rounds,
+    // and resume continues from the last checkpoint of the block, if any
     void adaptive_encode_block(
             const diy::Master::ProxyWithLink& cp,
             T                                 err_limit,
             int                               max_rounds,
-            ModelInfo&                        info)
+            ModelInfo&                        info,
+            bool                              resume = false)
     {
         if (!input->structured)
         {
@@ -287,6 +327,10 @@ struct BlockBase
             p(j)            = a->geom_p[j];
         }
 
+        mfa::AdaptiveCheckpoint<T> checkpoint(fmt::format("{}_gid_{}.ckpt", a->checkpoint, cp.gid()), a->checkpoint_interval);
+        if (resume && checkpoint.Read() && a->verbose)
+            fmt::print(stderr, "gid {}: resuming from {}\n", cp.gid(), checkpoint.filename);
+
         // encode geometry
         if (a->verbose && cp.master()->communicator().rank() == 0)
             fprintf(stderr, "\nEncoding geometry\n\n");
@@ -296,7 +340,7 @@ struct BlockBase
                 dom_dim - 1);
         geometry.mfa_data->set_knots(*input);
         // TODO: consider not weighting the geometry (only science variables), depends on geometry complexity
-        mfa->AdaptiveEncode(*geometry.mfa_data, *input, err_limit, a->verbose, a->weighted, extents, max_rounds);
+        mfa->ResumeAdaptiveEncode(*geometry.mfa_data, *input, err_limit, a->verbose, a->weighted, extents, max_rounds, a->refit_iters, checkpoint);
 
         // encode science variables
         for (auto i = 0; i< vars.size(); i++)
@@ -315,8 +359,9 @@ struct BlockBase
                     dom_dim + i,        // assumes each variable is scalar
                     dom_dim + i);
             vars[i].mfa_data->set_knots(*input);
-            mfa->AdaptiveEncode(*(vars[i].mfa_data), *input, err_limit, a->verbose, a->weighted, extents, max_rounds);
+            mfa->ResumeAdaptiveEncode(*(vars[i].mfa_data), *input, err_limit, a->verbose, a->weighted, extents, max_rounds, a->refit_iters, checkpoint);
         }
+        apply_mem_budget(cp, false);
 
 		// ------- Save mfab file which is the minimal mfa file, jianxin add start -------
 		unsigned int knots_size = vars[0].mfa_data->tmesh.all_knots[0].size();
@@ -350,6 +395,7 @@ struct BlockBase
             // assumes each variable is scalar
             mfa->DecodePointSet(*(vars[i].mfa_data), *approx, verbose, dom_dim + i, dom_dim + i, saved_basis);
         }
+        track_mem();
     }
 
     // decode entire block over a regular grid
@@ -381,6 +427,440 @@ struct BlockBase
         }
     }
 
+    // same grid as decode_block_grid, but streamed to a raw file tile by tile, with at most max_bytes of values in memory
+    // the file holds the grid of each science variable in turn, as T, dim. 0 fastest, without geometry
+    void decode_block_grid_raw(
+        const   diy::Master::ProxyWithLink& cp,
+        vector<int>&                        grid_size,      // number of grid points in each dim.
+        size_t                              max_bytes,      // memory budget for the values of one tile
+        const char*                         filename)
+    {
+        VectorXi grid_npts(dom_dim);
+        for (int k = 0; k < dom_dim; k++)
+            grid_npts(k) = grid_size[k];
+
+        FILE* fp = fopen(filename, "wb");
+        if (!fp)
+        {
+            fprintf(stderr, "Error: decode_block_grid_raw(): unable to open %s for writing\n", filename);
+            exit(1);
+        }
+
+        // multicomponent values are interleaved per point
+        MatrixX<T> vt;
+        auto sink = [&](size_t first, const MatrixX<T>& values)
+        {
+            const MatrixX<T>* out = &values;
+            if (values.cols() > 1)
+            {
+                vt  = values.transpose();
+                out = &vt;
+            }
+            if (fwrite(out->data(), sizeof(T), out->size(), fp) != out->size())
+            {
+                fprintf(stderr, "Error: decode_block_grid_raw(): failed writing %s\n", filename);
+                exit(1);
+            }
+        };
+        for (auto i = 0; i < vars.size(); i++)
+            mfa->DecodeAtGridTiled(*(vars[i].mfa_data), VectorX<T>::Zero(dom_dim), VectorX<T>::Ones(dom_dim), grid_npts, max_bytes, sink);
+        fclose(fp);
+    }
+
+    // find the points of a regular grid over the block where a science variable is in [lo, hi]
+    // same grid as decode_block_grid, but only knot spans whose control points straddle lo or hi are decoded
+    // results are grid indices (dim. 0 fastest) in range_idxs
+    void range_block_grid(
+        const   diy::Master::ProxyWithLink& cp,
+        int                                 verbose,
+        int                                 var,            // science variable to query
+        T                                   lo,             // lower end of value range
+        T                                   hi,             // upper end of value range
+        vector<int>&                        grid_size)      // number of grid points in each dim.
+    {
+        VectorXi grid_npts(dom_dim);
+        for (int k = 0; k < dom_dim; k++)
+            grid_npts(k) = grid_size[k];
+
+        mfa::SpanBoundsIndex<T> index(*(vars[var].mfa_data));
+        size_t ndecoded = index.RangeGrid(lo, hi, VectorX<T>::Zero(dom_dim), VectorX<T>::Ones(dom_dim), grid_npts, range_idxs);
+
+        if (verbose)
+            fprintf(stderr, "gid %d var %d: %lu of %d grid points in [%e, %e], %lu points decoded\n",
+                    cp.gid(), var, range_idxs.size(), grid_npts.prod(), lo, hi, ndecoded);
+    }
+
+    // extract an isosurface of a science variable at the resolution of a regular grid over the block
+    // only grid cells in knot spans that may contain the isovalue are decoded
+    // the mesh vertices are mapped to domain coordinates by the geometry model
+    void isosurface_block(
+        const   diy::Master::ProxyWithLink& cp,
+        int                                 verbose,
+        int                                 var,            // science variable to contour
+        T                                   iso,            // isovalue
+        vector<int>&                        grid_size,      // number of grid points in each dim.
+        int                                 newton_iters = 2)   // max. Newton steps to refine each vertex
+    {
+        VectorXi grid_npts(dom_dim);
+        for (int k = 0; k < dom_dim; k++)
+            grid_npts(k) = grid_size[k];
+
+        mfa::Isosurface<T> isosurface(*(vars[var].mfa_data));
+        isosurface.Extract(iso, VectorX<T>::Zero(dom_dim), VectorX<T>::Ones(dom_dim), grid_npts, iso_mesh, newton_iters, verbose);
+
+        // parameters to domain coordinates
+        VectorX<T> param(dom_dim), geom_cpt(dom_dim);
+        for (auto i = 0; i < iso_mesh.verts.rows(); i++)
+        {
+            param = iso_mesh.verts.row(i).transpose();
+            mfa->DecodePt(*geometry.mfa_data, param, geom_cpt);
+            iso_mesh.verts.row(i) = geom_cpt.transpose();
+        }
+
+        if (verbose)
+            fprintf(stderr, "gid %d var %d: isosurface %e has %ld vertices and %lu triangles\n",
+                    cp.gid(), var, iso, iso_mesh.verts.rows(), iso_mesh.ntris());
+    }
+
+    // find the critical points of a science variable in the core of the block
+    // points within eps (in domain coordinates) of a neighbor's core are also sent to that neighbor;
+    // call dedup_critical_points() after master.exchange() to remove points found by more than one block
+    void critical_points_block(
+        const   diy::Master::ProxyWithLink& cp,
+        int                                 verbose,
+        int                                 var,            // science variable
+        T                                   eps)            // distance within which two critical points are the same
+    {
+        vector<mfa::CriticalPoint<T>> all_cps;
+        mfa->CriticalPoints(*(vars[var].mfa_data), all_cps, verbose);
+
+        // keep the points in the core, and map them to domain coordinates
+        crit_pts.clear();
+        vector<VectorX<T>> coords;
+        VectorX<T> geom_cpt(dom_dim);
+        for (auto& c : all_cps)
+        {
+            mfa->DecodePt(*geometry.mfa_data, c.param, geom_cpt);
+            bool in_core = true;
+            for (auto k = 0; k < dom_dim; k++)
+                if (geom_cpt(k) < core_mins(k) - eps || geom_cpt(k) > core_maxs(k) + eps)
+                    in_core = false;
+            if (in_core)
+            {
+                crit_pts.push_back(c);
+                coords.push_back(geom_cpt);
+            }
+        }
+        crit_coords.resize(crit_pts.size(), dom_dim);
+        for (auto i = 0; i < coords.size(); i++)
+            crit_coords.row(i) = coords[i].transpose();
+
+        // send points near each neighbor's core: coordinates, value, and type of each
+        RCLink<T> *l = static_cast<RCLink<T>*>(cp.link());
+        for (auto k = 0; k < l->size(); k++)
+        {
+            auto        core_k = l->core(k);
+            vector<T>   out;
+            for (auto i = 0; i < crit_pts.size(); i++)
+            {
+                bool near = true;
+                for (auto j = 0; j < dom_dim; j++)
+                    if (crit_coords(i, j) < core_k.min[j] - eps || crit_coords(i, j) > core_k.max[j] + eps)
+                        near = false;
+                if (!near)
+                    continue;
+                for (auto j = 0; j < dom_dim; j++)
+                    out.push_back(crit_coords(i, j));
+                out.push_back(crit_pts[i].value);
+                out.push_back(crit_pts[i].type);
+            }
+            cp.enqueue(l->target(k), out);
+        }
+
+        if (verbose)
+            fprintf(stderr, "gid %d var %d: %lu critical points in core\n", cp.gid(), var, crit_pts.size());
+    }
+
+    // remove critical points that a neighbor with a lower gid also found
+    void dedup_critical_points(
+        const   diy::Master::ProxyWithLink& cp,
+        int                                 verbose,
+        T                                   eps)            // distance within which two critical points are the same
+    {
+        vector<char> drop(crit_pts.size(), 0);
+        RCLink<T> *l = static_cast<RCLink<T>*>(cp.link());
+        for (auto k = 0; k < l->size(); k++)
+        {
+            vector<T> in;
+            cp.dequeue(l->target(k).gid, in);
+            if (l->target(k).gid > cp.gid())
+                continue;
+            for (size_t n = 0; n + dom_dim + 2 <= in.size(); n += dom_dim + 2)
+            {
+                Eigen::Map<VectorX<T>> other(&in[n], dom_dim);
+                int type = in[n + dom_dim + 1];
+                for (auto i = 0; i < crit_pts.size(); i++)
+                    if (crit_pts[i].type == type && (crit_coords.row(i).transpose() - other).norm() <= eps)
+                        drop[i] = 1;
+            }
+        }
+
+        size_t n = 0;
+        for (auto i = 0; i < crit_pts.size(); i++)
+            if (!drop[i])
+            {
+                crit_pts[n]         = crit_pts[i];
+                crit_coords.row(n)  = crit_coords.row(i);
+                n++;
+            }
+        if (verbose && n < crit_pts.size())
+            fprintf(stderr, "gid %d: removed %lu duplicate critical points\n", cp.gid(), crit_pts.size() - n);
+        crit_pts.resize(n);
+        crit_coords.conservativeResize(n, dom_dim);
+    }
+
+    // keep the seeds in the core of this block as particles to be traced
+    // a seed on a shared core boundary goes to the block with the lowest gid
+    void seed_particles(
+        const   diy::Master::ProxyWithLink& cp,
+        const   MatrixX<T>&                 seeds,          // seed points in domain coordinates, one per row; the row is the particle id
+        T                                   h)              // initial step size
+    {
+        RCLink<T> *l = static_cast<RCLink<T>*>(cp.link());
+        for (auto i = 0; i < seeds.rows(); i++)
+        {
+            VectorX<T> x = seeds.row(i).transpose();
+            if (((x - core_mins).array() < 0.0).any() || ((x - core_maxs).array() > 0.0).any())
+                continue;
+            bool mine = true;
+            for (auto k = 0; k < l->size(); k++)
+            {
+                auto core_k = l->core(k);
+                bool in_k   = true;
+                for (auto j = 0; j < dom_dim; j++)
+                    if (x(j) < core_k.min[j] || x(j) > core_k.max[j])
+                        in_k = false;
+                if (in_k && l->target(k).gid < cp.gid())
+                    mine = false;
+            }
+            if (!mine)
+                continue;
+            mfa::Particle<T> p;
+            p.id    = i;
+            p.x     = x;
+            p.h     = h;
+            particles.push_back(p);
+        }
+    }
+
+    // traces the particles in this block through a vector field given by one or more science variables
+    // the domain is mapped linearly to parameter space between the geometry at the parameter corners,
+    // ie, the geometry is a regular grid
+    // particles leaving the core are enqueued to the neighbor whose core contains them; the total number
+    // sent is all-reduced, so that the caller can repeat
+    //   master.foreach(trace_block); master.exchange(); master.foreach(receive_particles)
+    // until receive_particles returns 0
+    void trace_block(
+        const   diy::Master::ProxyWithLink& cp,
+        int                                 verbose,
+        const   vector<int>&                vel_vars,       // science variables holding the velocity components, in order
+        const   mfa::TraceParams<T>&        params)         // integration parameters
+    {
+        vector<const mfa::MFA_Data<T>*> models;
+        for (auto v : vel_vars)
+            models.push_back(vars[v].mfa_data);
+        VectorX<T> dom_mins(dom_dim), dom_maxs(dom_dim);
+        mfa->DecodePt(*geometry.mfa_data, VectorX<T>::Zero(dom_dim), dom_mins);
+        mfa->DecodePt(*geometry.mfa_data, VectorX<T>::Ones(dom_dim), dom_maxs);
+        vector<vector<VectorX<T>>> paths(particles.size());
+        mfa::VectorField<T> field(models);
+
+#ifdef MFA_TBB
+        enumerable_thread_specific<mfa::VectorField<T>> thread_field(field);  // each thread has its own span hints
+        parallel_for (size_t(0), particles.size(), [&] (size_t i)
+        {
+            mfa::Tracer<T> tracer(thread_field.local(), dom_mins, dom_maxs);
+            tracer.Trace(particles[i], core_mins, core_maxs, params, &paths[i]);
+        });
+#endif
+#ifdef MFA_SERIAL
+        mfa::Tracer<T> tracer(field, dom_mins, dom_maxs);
+        for (auto i = 0; i < particles.size(); i++)
+            tracer.Trace(particles[i], core_mins, core_maxs, params, &paths[i]);
+#endif
+
+        // save the trace segments and send the particles that left the core: id, step size, steps, coordinates
+        RCLink<T> *l = static_cast<RCLink<T>*>(cp.link());
+        vector<vector<T>> out(l->size());
+        size_t nsent = 0;
+        for (auto i = 0; i < particles.size(); i++)
+        {
+            MatrixX<T> pts(paths[i].size(), dom_dim);
+            for (auto j = 0; j < paths[i].size(); j++)
+                pts.row(j) = paths[i][j].transpose();
+            traces.push_back(pts);
+            trace_ids.push_back(particles[i].id);
+
+            if (particles[i].status != mfa::TRACE_LEFT_BOX)
+                continue;
+            const VectorX<T>& x = particles[i].x;
+            for (auto k = 0; k < l->size(); k++)
+            {
+                auto core_k = l->core(k);
+                bool in_k   = true;
+                for (auto j = 0; j < dom_dim; j++)
+                    if (x(j) < core_k.min[j] || x(j) > core_k.max[j])
+                        in_k = false;
+                if (!in_k)
+                    continue;
+                out[k].push_back(particles[i].id);
+                out[k].push_back(particles[i].h);
+                out[k].push_back(particles[i].nsteps);
+                for (auto j = 0; j < dom_dim; j++)
+                    out[k].push_back(x(j));
+                nsent++;
+                break;
+            }
+        }
+        for (auto k = 0; k < l->size(); k++)
+            cp.enqueue(l->target(k), out[k]);
+        cp.all_reduce(nsent, std::plus<size_t>());
+
+        if (verbose)
+            fprintf(stderr, "gid %d: traced %lu particles, %lu sent to neighbors\n", cp.gid(), particles.size(), nsent);
+        particles.clear();
+    }
+
+    // receives the particles sent by trace_block
+    // returns the total number of particles sent by all blocks
+    size_t receive_particles(
+        const   diy::Master::ProxyWithLink& cp,
+        int                                 verbose)
+    {
+        RCLink<T> *l = static_cast<RCLink<T>*>(cp.link());
+        for (auto k = 0; k < l->size(); k++)
+        {
+            vector<T> in;
+            cp.dequeue(l->target(k).gid, in);
+            for (size_t n = 0; n + dom_dim + 3 <= in.size(); n += dom_dim + 3)
+            {
+                mfa::Particle<T> p;
+                p.id        = in[n];
+                p.h         = in[n + 1];
+                p.nsteps    = in[n + 2];
+                p.x         = Eigen::Map<VectorX<T>>(&in[n + 3], dom_dim);
+                particles.push_back(p);
+            }
+        }
+        if (verbose)
+            fprintf(stderr, "gid %d: received %lu particles\n", cp.gid(), particles.size());
+        return cp.get<size_t>();
+    }
+
+    // volume renders a science variable in the core of the block with an orthographic camera
+    // the domain is mapped linearly to parameter space between the geometry at the parameter corners;
+    // composite the block images with diy::reduce and composite_image, then gather them with gather_image
+    void render_block(
+        const   diy::Master::ProxyWithLink&     cp,
+        int                                     verbose,
+        int                                     var,        // science variable
+        const   mfa::Camera<T>&                 cam,        // camera
+        const   mfa::TransferFunction<T>&       tf,         // transfer function
+        T                                       step)       // sample spacing along rays, domain units
+    {
+        VectorX<T> dom_mins(dom_dim), dom_maxs(dom_dim);
+        mfa->DecodePt(*geometry.mfa_data, VectorX<T>::Zero(dom_dim), dom_mins);
+        mfa->DecodePt(*geometry.mfa_data, VectorX<T>::Ones(dom_dim), dom_maxs);
+
+        mfa::RayCaster<T> ray_caster(*(vars[var].mfa_data), tf, dom_mins, dom_maxs);
+        image.Init(cam.nx, cam.ny);
+        ray_caster.Render(cam, core_mins, core_maxs, step, image, 16, verbose);
+        image.depth = cam.dir.dot((core_mins + core_maxs) / 2.0);
+
+        if (verbose)
+            fprintf(stderr, "gid %d: rendered var %d at depth %e\n", cp.gid(), var, image.depth);
+    }
+
+    // one round of binary swap (radix-k with RegularSwapPartners) compositing of the block images
+    // the pieces received in a round are composited front to back in order of their depth
+    void composite_image(
+        const   diy::ReduceProxy&               rp,
+        const   diy::RegularSwapPartners&       partners)
+    {
+        // composite the pieces of the rows owned by this block, including its own piece
+        if (rp.in_link().size())
+        {
+            vector<pair<T, int>>    order;
+            vector<vector<float>>   pieces(rp.in_link().size());
+            T                       depth = 0.0;
+            for (auto i = 0; i < rp.in_link().size(); i++)
+            {
+                int gid = rp.in_link().target(i).gid;
+                T   d;
+                rp.dequeue(gid, image.y0);
+                rp.dequeue(gid, image.y1);
+                rp.dequeue(gid, d);
+                rp.dequeue(gid, pieces[i]);
+                order.push_back(make_pair(d, i));
+                depth += d;
+            }
+            sort(order.begin(), order.end());
+            image.rgba.swap(pieces[order[0].second]);
+            for (auto i = 1; i < order.size(); i++)
+                image.Over(pieces[order[i].second]);
+            image.depth = depth / order.size();
+        }
+
+        // split the rows among the group for the next round
+        int k = rp.out_link().size();
+        if (k == 0)
+            return;
+        int nrows = image.y1 - image.y0;
+        for (auto i = 0; i < k; i++)
+        {
+            int     y0  = image.y0 + (int)((size_t)nrows * i / k);
+            int     y1  = image.y0 + (int)((size_t)nrows * (i + 1) / k);
+            size_t  ofst = (size_t)(y0 - image.y0) * image.nx * 4;
+            vector<float> piece(image.rgba.begin() + ofst, image.rgba.begin() + ofst + (size_t)(y1 - y0) * image.nx * 4);
+            rp.enqueue(rp.out_link().target(i), y0);
+            rp.enqueue(rp.out_link().target(i), y1);
+            rp.enqueue(rp.out_link().target(i), image.depth);
+            rp.enqueue(rp.out_link().target(i), piece);
+        }
+    }
+
+    // one round of gathering the composited rows to the root of a RegularMergePartners reduction (gid 0)
+    void gather_image(
+        const   diy::ReduceProxy&               rp,
+        const   diy::RegularMergePartners&      partners)
+    {
+        // expand the rows owned into a full image
+        if (image.y0 != 0 || image.y1 != image.ny)
+        {
+            vector<float> full((size_t)image.nx * image.ny * 4, 0.0f);
+            copy(image.rgba.begin(), image.rgba.end(), full.begin() + (size_t)image.y0 * image.nx * 4);
+            image.rgba.swap(full);
+            image.y0 = 0;
+            image.y1 = image.ny;
+        }
+
+        // the rows of different blocks are disjoint, so the images add
+        for (auto i = 0; i < rp.in_link().size(); i++)
+        {
+            int gid = rp.in_link().target(i).gid;
+            if (gid == rp.gid())
+                continue;
+            vector<float> in;
+            rp.dequeue(gid, in);
+            for (size_t j = 0; j < in.size(); j++)
+                image.rgba[j] += in[j];
+        }
+
+        for (auto i = 0; i < rp.out_link().size(); i++)
+            if (rp.out_link().target(i).gid != rp.gid())
+                rp.enqueue(rp.out_link().target(i), image.rgba);
+    }
+
     // decode one point
     void decode_point(
             const   diy::Master::ProxyWithLink& cp,
@@ -473,6 +953,18 @@ struct BlockBase
         for (auto i = 0; i < vars.size(); i++)
             if (var < 0 || var == i)
             {
+                // when possible, decode a derivative model built from the control points instead of
+                // evaluating basis function derivatives at every point
+                if (deriv && has_derivative_model(*(vars[i].mfa_data), derivs))
+                {
+                    mfa::MFA_Data<T>* d = derivative_model(*(vars[i].mfa_data), derivs);
+                    d->min_dim = dom_dim + i;       // assumes each variable is scalar
+                    d->max_dim = dom_dim + i;
+                    mfa->DecodePointSet(*d, *approx, verbose, dom_dim + i, dom_dim + i, false);
+                    delete d;
+                    continue;
+                }
+
                 // TODO: remove duplication of MFA_Data? Also, this leaks memory as-is
                 // TODO: hard-coded for one tensor product
                 vars[i].mfa_data = new mfa::MFA_Data<T>(vars[i].mfa_data->p,
@@ -504,55 +996,292 @@ struct BlockBase
                 approx->domain.col(i) = input->domain.col(i);
     }
 
+    // whether derivative_model() can represent the given derivatives of a model exactly:
+    // one tensor product, unit weights, and derivative orders no higher than the degree
+    bool has_derivative_model(
+            const mfa::MFA_Data<T>&         mfa_data,
+            const VectorXi&                 derivs) const   // order of derivative in each domain dim.
+    {
+        if (mfa_data.tmesh.tensor_prods.size() != 1)
+            return false;
+        const VectorX<T>& weights = mfa_data.tmesh.tensor_prods[0].weights;
+        if (weights.size() && (weights.array() != 1.0).any())
+            return false;
+        for (auto k = 0; k < mfa_data.dom_dim; k++)
+            if (derivs(k) > mfa_data.p(k))
+                return false;
+        return true;
+    }
+
+    // builds a new model of the given (mixed partial) derivative of a model in O(# control points)
+    // the derivative is with respect to the parameters in [0.0, 1.0], not the domain coordinates
+    // the result is an ordinary MFA_Data and can be decoded, saved, or differentiated again like any other model
+    // caller owns the returned model
+    mfa::MFA_Data<T>* derivative_model(
+            const mfa::MFA_Data<T>&         mfa_data,
+            const VectorXi&                 derivs) const   // order of derivative in each domain dim.
+    {
+        mfa::MFA_Data<T>* d = new mfa::MFA_Data<T>(mfa_data, 0, derivs(0));
+        for (auto k = 1; k < mfa_data.dom_dim; k++)
+        {
+            if (!derivs(k))
+                continue;
+            mfa::MFA_Data<T>* dk = new mfa::MFA_Data<T>(*d, k, derivs(k));
+            delete d;
+            d = dk;
+        }
+        return d;
+    }
+
+    // decode the value, gradient, Hessian, ... (all partial derivatives up to total order nders) of the science variables
+    // at the input points, or on a regular grid if grid_size is given
+    // ders has one row per point and, for each decoded variable in turn, one column per entry of ders_orders
+    // derivatives are scaled by the block extents to be with respect to the domain coordinates
+    void decode_ders_block(
+            const diy::Master::ProxyWithLink& cp,
+            int                               verbose,              // debug level
+            int                               nders,                // max. total order of derivatives (2 = value, gradient, Hessian)
+            int                               var,                  // decode only this one science variable (0 to nvars -1, -1 = all vars)
+            const vector<int>&                grid_size = vector<int>())  // number of grid points in each dim. (empty = input points)
+    {
+        vector<int> var_ids;
+        for (auto i = 0; i < vars.size(); i++)
+            if (var < 0 || var == i)
+                var_ids.push_back(i);
+
+        ders_orders = mfa::DersDecodeInfo<T>(*vars[var_ids[0]].mfa_data, nders).ders;
+        int nterms  = ders_orders.size();
+        size_t npts = input->npts;
+        VectorXi grid_npts(dom_dim);
+        if (grid_size.size())
+        {
+            for (auto k = 0; k < dom_dim; k++)
+                grid_npts(k) = grid_size[k];
+            npts = grid_npts.prod();
+        }
+        ders.resize(npts, nterms * var_ids.size());
+
+        MatrixX<T> result;
+        for (auto v = 0; v < var_ids.size(); v++)
+        {
+            const mfa::MFA_Data<T>& mfa_data = *vars[var_ids[v]].mfa_data;
+            if (grid_size.size())
+                mfa->DecodeGridDers(mfa_data, VectorX<T>::Zero(dom_dim), VectorX<T>::Ones(dom_dim), grid_npts, nders, result, verbose);
+            else
+                mfa->DecodePointSetDers(mfa_data, *input, nders, result, verbose);
+
+            // assumes each variable is scalar
+            for (auto j = 0; j < nterms; j++)
+            {
+                T scale = 1.0;
+                for (auto k = 0; k < dom_dim; k++)
+                    scale *= pow(bounds_maxs(k) - bounds_mins(k), ders_orders[j](k));
+                ders.col(v * nterms + j) = result.col(j) / scale;
+            }
+        }
+    }
+
+    // exact integral and integral of the square of each science variable over the part of a box (in domain coordinates)
+    // inside the core of this block, posted as all-reduce collectives summed over all blocks
+    // call for all blocks, then master.exchange(), then box_stats() for all blocks
+    // assumes each science variable is scalar
+    void integrate_block(
+            const diy::Master::ProxyWithLink& cp,
+            const VectorX<T>&                 box_mins,             // minimum corner of box in domain coordinates
+            const VectorX<T>&                 box_maxs,             // maximum corner of box in domain coordinates
+            int                               verbose)              // debug level
+    {
+        // clip the box to the core so that overlapping (ghost) regions are counted once
+        VectorX<T>  par_min(dom_dim), par_max(dom_dim);
+        T           vol     = 1.0;                                  // volume of clipped box in domain coordinates
+        T           jac     = 1.0;                                  // volume of block in domain coordinates
+        for (auto k = 0; k < dom_dim; k++)
+        {
+            T lo    = std::max(box_mins(k), core_mins(k));
+            T hi    = std::min(box_maxs(k), core_maxs(k));
+            T ext   = bounds_maxs(k) - bounds_mins(k);
+            vol     *= std::max(hi - lo, T(0.0));
+            jac     *= ext;
+            par_min(k) = (lo - bounds_mins(k)) / ext;
+            par_max(k) = (hi - bounds_mins(k)) / ext;
+        }
+
+        cp.all_reduce(vol, std::plus<T>());
+        for (auto i = 0; i < vars.size(); i++)
+        {
+            VectorX<T> integral, sq_integral;
+            if (vol > 0.0)
+                mfa->Integrate(*(vars[i].mfa_data), par_min, par_max, integral, &sq_integral, verbose);
+            else
+                integral = sq_integral = VectorX<T>::Zero(1);
+            cp.all_reduce(integral(0) * jac, std::plus<T>());
+            cp.all_reduce(sq_integral(0) * jac, std::plus<T>());
+        }
+    }
+
+    // retrieves the integrals reduced over all blocks by integrate_block and computes the means and variances
+    void box_stats(
+            const diy::Master::ProxyWithLink& cp,
+            int                               verbose)              // debug level
+    {
+        box_volume = cp.get<T>();
+        box_integrals.resize(vars.size());
+        box_means.resize(vars.size());
+        box_variances.resize(vars.size());
+        for (auto i = 0; i < vars.size(); i++)
+        {
+            box_integrals[i]    = cp.get<T>();
+            T sq_integral       = cp.get<T>();
+            box_means[i]        = box_volume > 0.0 ? box_integrals[i] / box_volume : 0.0;
+            box_variances[i]    = box_volume > 0.0 ? sq_integral / box_volume - box_means[i] * box_means[i] : 0.0;
+            if (verbose && cp.gid() == 0)
+                fprintf(stderr, "var %d: box volume %e integral %e mean %e variance %e\n",
+                        i, box_volume, box_integrals[i], box_means[i], box_variances[i]);
+        }
+    }
+
+    // builds a multiresolution pyramid of each science variable, down to min_nctrl_pts in each dim (p + 1 if size 0)
+    // prints the size, max. error against the input, and decoding time of each level, coarse to fine,
+    // and writes the pyramids of all variables as one progressive stream to <filename>_gid_<gid>.mfp
+    void pyramid_block(
+            const   diy::Master::ProxyWithLink& cp,
+            const   string&                     filename,
+            const   VectorXi&                   min_nctrl_pts,
+            int                                 verbose)    // output level
+    {
+        diy::MemoryBuffer bb;
+        diy::save(bb, vars.size());
+        for (auto i = 0; i < vars.size(); i++)
+        {
+            mfa::ModelPyramid<T> pyramid;
+            pyramid.Build(*mfa, *vars[i].mfa_data, min_nctrl_pts, verbose);
+            pyramid.Save(bb);
+
+            for (auto l = 0; l < pyramid.levels.size(); l++)
+            {
+                const mfa::MFA_Data<T>& m = *pyramid.levels[l];
+                diy::MemoryBuffer level_bb;
+                mfa::ModelPyramid<T>::SaveLevel(level_bb, m);
+                string stats = fmt::format("gid {} var {} pyramid level {}: {} control points, {} bytes",
+                        cp.gid(), i, l, m.tmesh.tensor_prods[0].ctrl_pts.rows(), level_bb.size());
+
+                if (input != nullptr)                       // input was not released
+                {
+                    int                 ncols = m.max_dim - m.min_dim + 1;
+                    mfa::PointSet<T>    level_approx(input->params, input->pt_dim);
+                    double decode_time = MPI_Wtime();
+                    mfa->DecodePointSet(m, level_approx, 0, m.min_dim, m.max_dim, false);
+                    decode_time = MPI_Wtime() - decode_time;
+                    T max_err = (level_approx.domain.middleCols(m.min_dim, ncols) - input->domain.middleCols(m.min_dim, ncols)).cwiseAbs().maxCoeff();
+                    stats += fmt::format(", max. error {:e}, decoded in {:.3f} s", max_err, decode_time);
+                }
+                fprintf(stderr, "%s\n", stats.c_str());
+            }
+        }
+
+        string outfile = fmt::format("{}_gid_{}.mfp", filename, cp.gid());
+        FILE* fd = fopen(outfile.c_str(), "wb");
+        if (!fd || fwrite(&bb.buffer[0], 1, bb.size(), fd) != bb.size() || fclose(fd))
+        {
+            fprintf(stderr, "Error: pyramid_block: failed writing %s\n", outfile.c_str());
+            exit(1);
+        }
+    }
+
     // compute error field and maximum error in the block
     // uses coordinate-wise difference between values
     void range_error(
             const   diy::Master::ProxyWithLink& cp,
             int     verbose,                                // output level
-            bool    decode_block_,                          // decode entire block first
-            bool    saved_basis)                            // whether basis functions were saved and can be reused
+            bool    decode_block_,                          // keep the decoded block in approx
+            bool    saved_basis,                            // whether basis functions were saved and can be reused
+            bool    save_errs = true)                       // keep the error field in errs
     {
+        if (input == nullptr && input_npts)                 // errors were computed before the input was released
+            return;
         if (input == nullptr)
         {
             cerr << "ERROR: Cannot compute range_error; no valid input data" << endl;
             exit(1);
         }
+        if (mem_budget)                                     // stream the errors without keeping any point set
+        {
+            decode_block_   = false;
+            save_errs       = false;
+        }
         if (errs != nullptr)
         {
             cerr << "Warning: Overwriting existing error field" << endl;
             delete errs;
+            errs = nullptr;
+        }
+        if (save_errs)
+            errs = new mfa::PointSet<T>(input->params, input->pt_dim);
+        if (decode_block_)
+        {
+            delete approx;
+            approx = new mfa::PointSet<T>(input->params, input->pt_dim);  // Set decode params from input params
         }
-        errs = new mfa::PointSet<T>(input->params, input->pt_dim);
 
         // saved_basis only applies when not using tmesh
 #ifdef MFA_TMESH
         saved_basis = false;
 #endif
-        // Decode entire block and then compare to input
-        if (decode_block_)
+        // decode each input point, compare to input, and reduce the error in one pass
+        fprintf(stderr, "\n--- Decoding and computing error ---\n\n");
+        vector<mfa::ErrorStats<T>>  stats;
+        VectorX<T>                  no_extents;             // size 0 means do not normalize
+        mfa->PointSetErrorStats(*input, vars, stats, no_extents, &geometry, approx, errs, saved_basis, verbose);
+        track_mem();
+
+        // error metrics
+        for (auto j = 0; j < stats.size(); j++)
         {
-            decode_block(cp, verbose, saved_basis);
+            max_errs[j]     = stats[j].max_abs_err;
+            sum_sq_errs[j]  = stats[j].sum_sq_abs_errs;
+        }
 
-            mfa->AbsPointSetDiff(*input, *approx, *errs, verbose);
+        // copy the computed error in a new array for reduce operations
+        max_errs_reduce.resize(max_errs.size() * 2);
+        for (auto i = 0; i < max_errs.size(); i++)
+        {
+            max_errs_reduce[2 * i] = max_errs[i];
+            max_errs_reduce[2 * i + 1] = cp.gid(); // use converter from type T to integer
         }
-        else // Compute error at each input point on the fly
+     }
+
+    // estimates the range error from a stratified random sample of the input points
+    // max_errs become lower bounds (max. over the sample) and sum_sq_errs estimates of the totals
+    // no error field is stored
+    void sampled_range_error(
+            const   diy::Master::ProxyWithLink& cp,
+            int     verbose,                                // output level
+            size_t  budget,                                 // max. number of points to decode
+            T       rel_tol,                                // target relative half-width of confidence interval on RMS error
+            T       z       = 1.96,                         // standard normal quantile of confidence level (1.96 = 95%)
+            unsigned seed   = 0)                            // random seed
+    {
+        if (input == nullptr && input_npts)                 // exact errors were computed before the input was released
+            return;
+        if (input == nullptr)
         {
-            mfa->AbsPointSetError(*input, *errs, vars, verbose);
+            cerr << "ERROR: Cannot compute sampled_range_error; no valid input data" << endl;
+            exit(1);
         }
 
-        // Compute error metrics
-        MatrixX<T>& errpts = errs->domain;
+        vector<mfa::ErrorStats<T>>  stats;
+        vector<T>                   rms_lo, rms_hi;
+        VectorX<T>                  no_extents;             // size 0 means do not normalize
+        size_t nsampled = mfa->SampledPointSetError(*input, vars, stats, rms_lo, rms_hi, no_extents,
+                budget, rel_tol, z, seed + cp.gid(), verbose);
 
-        for (auto j = dom_dim; j < errs->pt_dim; j++)
-            sum_sq_errs[j - dom_dim] = 0.0;
-        for (auto i = 0; i < errs->npts; i++)
+        for (auto j = 0; j < stats.size(); j++)
         {
-            for (auto j = dom_dim; j < input->domain.cols(); j++)
-            {
-                sum_sq_errs[j - dom_dim] += (errpts(i, j) * errpts(i, j));
-                if ((i == 0 && j == dom_dim) || errpts(i, j) > max_errs[j - dom_dim])
-                    max_errs[j - dom_dim] = errpts(i, j);
-            }
+            max_errs[j]     = stats[j].max_abs_err;
+            sum_sq_errs[j]  = stats[j].sum_sq_abs_errs;
+            if (verbose)
+                fprintf(stderr, "gid %d var %d: sampled %lu of %d points, max_err >= %e, RMS error in [%e, %e]\n",
+                        cp.gid(), j, nsampled, input->npts, max_errs[j], rms_lo[j], rms_hi[j]);
         }
 
         // copy the computed error in a new array for reduce operations
@@ -562,7 +1291,83 @@ struct BlockBase
             max_errs_reduce[2 * i] = max_errs[i];
             max_errs_reduce[2 * i + 1] = cp.gid(); // use converter from type T to integer
         }
-     }
+    }
+
+    // bytes held by a point set
+    size_t mem_usage(const mfa::PointSet<T>* ps) const
+    {
+        if (!ps)
+            return 0;
+        size_t n = ps->domain.size();
+        if (ps->params && (ps == input || !input || ps->params != input->params))   // params are shared with the input
+        {
+            n += ps->params->param_list.size();
+            for (auto k = 0; k < ps->params->param_grid.size(); k++)
+                n += ps->params->param_grid[k].size();
+        }
+        return n * sizeof(T);
+    }
+
+    // bytes held by a model: control points, weights, knots, and saved basis functions
+    size_t mem_usage(const mfa::MFA_Data<T>* mfa_data) const
+    {
+        if (!mfa_data)
+            return 0;
+        size_t n = 0;
+        for (auto j = 0; j < mfa_data->tmesh.tensor_prods.size(); j++)
+            n += mfa_data->tmesh.tensor_prods[j].ctrl_pts.size() + mfa_data->tmesh.tensor_prods[j].weights.size();
+        for (auto k = 0; k < mfa_data->tmesh.all_knots.size(); k++)
+            n += mfa_data->tmesh.all_knots[k].size();
+        for (auto k = 0; k < mfa_data->N.size(); k++)
+            n += mfa_data->N[k].size();
+        return n * sizeof(T);
+    }
+
+    // bytes held by the point sets, models, and blending output of the block
+    size_t mem_usage() const
+    {
+        size_t n = mem_usage(input) + mem_usage(approx) + mem_usage(errs) + mem_usage(geometry.mfa_data) + blend.size() * sizeof(T);
+        for (auto i = 0; i < vars.size(); i++)
+            n += mem_usage(vars[i].mfa_data);
+        return n;
+    }
+
+    // records the current memory use in peak_mem
+    void track_mem()
+    {
+        peak_mem = max(peak_mem, mem_usage());
+    }
+
+    // releases the input and everything decoded at the input points, keeping the block bounds,
+    // the number of input points, and the range extents of the science variables for reporting errors
+    void release_input()
+    {
+        if (!input)
+            return;
+        input_npts      = input->npts;
+        input_extents   = (input->domain.colwise().maxCoeff() - input->domain.colwise().minCoeff()).tail(pt_dim - dom_dim).transpose();
+        delete input;
+        delete approx;
+        delete errs;
+        input = approx = errs = nullptr;
+
+        // basis functions saved at the input points are of no use without them
+        geometry.mfa_data->N.clear();
+        for (auto i = 0; i < vars.size(); i++)
+            vars[i].mfa_data->N.clear();
+    }
+
+    // after encoding under a memory budget: streaming error statistics, then release of the input
+    void apply_mem_budget(
+            const   diy::Master::ProxyWithLink& cp,
+            bool    saved_basis)                            // whether basis functions were saved and can be reused
+    {
+        track_mem();
+        if (!mem_budget)
+            return;
+        range_error(cp, 0, false, saved_basis, false);
+        release_input();
+    }
 
     void print_block(const diy::Master::ProxyWithLink& cp,
             bool                              error)       // error was computed
@@ -607,7 +1412,8 @@ struct BlockBase
         cerr << "\n----- science variable models -----" << endl;
         for (auto i = 0; i < vars.size(); i++)
         {
-            T range_extent = input->domain.col(dom_dim + i).maxCoeff() - input->domain.col(dom_dim + i).minCoeff();
+            T range_extent = input ? input->domain.col(dom_dim + i).maxCoeff() - input->domain.col(dom_dim + i).minCoeff() :
+                input_extents(i);
             cerr << "\n---------- var " << i << " ----------" << endl;
             tot_nctrl_pts_dim   = VectorXi::Zero(vars[i].mfa_data->dom_dim);
             tot_nctrl_pts       = 0;
@@ -638,7 +1444,7 @@ struct BlockBase
 
             if (error)
             {
-                T rms_err = sqrt(sum_sq_errs[i] / (input->domain.rows()));
+                T rms_err = sqrt(sum_sq_errs[i] / (input ? input->domain.rows() : input_npts));
                 fprintf(stderr, "range extent          = %e\n",  range_extent);
                 fprintf(stderr, "max_err               = %e\n",  max_errs[i]);
                 fprintf(stderr, "normalized max_err    = %e\n",  max_errs[i] / range_extent);
@@ -699,14 +1505,19 @@ struct BlockBase
         //  debug: print approximated points
 //         cerr << approx->npts << " approximated points\n" << approx->domain << endl;
 
-        fprintf(stderr, "# input points        = %ld\n", input->domain.rows());
+        fprintf(stderr, "# input points        = %ld\n", input ? input->domain.rows() : input_npts);
         fprintf(stderr, "compression ratio     = %.2f\n", compute_compression());
+        track_mem();
+        fprintf(stderr, "peak block memory     = %.2f MB", peak_mem / 1048576.0);
+        if (mem_budget)
+            fprintf(stderr, " of budget %.2f MB%s", mem_budget / 1048576.0, peak_mem > mem_budget ? " (exceeded)" : "");
+        fprintf(stderr, "\n");
     }
 
     // compute compression ratio
     float compute_compression()
     {
-        float in_coords = (input->npts) * (input->pt_dim);
+        float in_coords = (input ? input->npts : input_npts) * pt_dim;
         float out_coords = 0.0;
         for (auto j = 0; j < geometry.mfa_data->tmesh.tensor_prods.size(); j++)
             out_coords += geometry.mfa_data->tmesh.tensor_prods[j].ctrl_pts.rows() *
@@ -1389,6 +2200,43 @@ namespace mfa
             b->init_block(core, domain, dom_dim, pt_dim, ghost_factor);
         }
 
+    // control points of one tensor product, error-bounded and entropy coded when err_bound > 0
+    template<typename T>                            // T = float or double
+        void save_ctrl_pts(
+                diy::BinaryBuffer&      bb,
+                const TensorProduct<T>& t,
+                T                       err_bound)
+        {
+            if (err_bound <= 0.0)
+            {
+                diy::save(bb, t.ctrl_pts);
+                return;
+            }
+            vector<unsigned char> bytes;
+            CtrlPtCodec<T>::Compress(t.ctrl_pts, t.nctrl_pts, err_bound, bytes);
+            diy::save(bb, (int)t.ctrl_pts.cols());
+            diy::save(bb, bytes);
+        }
+
+    template<typename T>                            // T = float or double
+        void load_ctrl_pts(
+                diy::BinaryBuffer&      bb,
+                TensorProduct<T>&       t,              // nctrl_pts must already be loaded
+                T                       err_bound)
+        {
+            if (err_bound <= 0.0)
+            {
+                diy::load(bb, t.ctrl_pts);
+                return;
+            }
+            int ncols;
+            vector<unsigned char> bytes;
+            diy::load(bb, ncols);
+            diy::load(bb, bytes);
+            const unsigned char* in = bytes.empty() ? NULL : &bytes[0];
+            CtrlPtCodec<T>::Decompress(in, in + bytes.size(), t.nctrl_pts, ncols, err_bound, t.ctrl_pts);
+        }
+
     template<typename B, typename T>                // B = block object,  T = float or double
         void save(
                 const void*        b_,
@@ -1396,6 +2244,13 @@ namespace mfa
         {
             B* b = (B*)b_;
 
+            // compressed format is flagged ahead of the legacy layout
+            if (b->save_err_bound > 0.0)
+            {
+                diy::save(bb, COMPRESSED_MODEL_FLAG);
+                diy::save(bb, b->save_err_bound);
+            }
+
             // top-level mfa data
             diy::save(bb, b->dom_dim);
             diy::save(bb, b->pt_dim);
@@ -1407,9 +2262,10 @@ namespace mfa
             diy::save(bb, b->core_maxs);
 
             // TODO: don't save data sets in practice
-            diy::save(bb, b->input);
-            diy::save(bb, b->approx);
-            diy::save(bb, b->errs);
+            bool model_only = b->save_model_only || b->mem_budget;
+            diy::save(bb, model_only ? (mfa::PointSet<T>*) nullptr : b->input);
+            diy::save(bb, model_only ? (mfa::PointSet<T>*) nullptr : b->approx);
+            diy::save(bb, model_only ? (mfa::PointSet<T>*) nullptr : b->errs);
 
             // geometry
             diy::save(bb, b->geometry.mfa_data->p);
@@ -1438,7 +2294,7 @@ namespace mfa
                 for (TensorProduct<T>& t: b->vars[i].mfa_data->tmesh.tensor_prods)
                     diy::save(bb, t.nctrl_pts);
                 for (TensorProduct<T>& t: b->vars[i].mfa_data->tmesh.tensor_prods)
-                    diy::save(bb, t.ctrl_pts);
+                    save_ctrl_pts(bb, t, b->save_err_bound);
                 for (TensorProduct<T>& t: b->vars[i].mfa_data->tmesh.tensor_prods)
                     diy::save(bb, t.weights);
                 for (TensorProduct<T>& t: b->vars[i].mfa_data->tmesh.tensor_prods)
@@ -1452,8 +2308,16 @@ namespace mfa
             }
 
             // output for blending
-            diy::save(bb, b->ndom_outpts);
-            diy::save(bb, b->blend);
+            if (model_only)
+            {
+                diy::save(bb, VectorXi());
+                diy::save(bb, MatrixX<T>());
+            }
+            else
+            {
+                diy::save(bb, b->ndom_outpts);
+                diy::save(bb, b->blend);
+            }
         }
 
     template<typename B, typename T>                // B = block object, T = float or double
@@ -1463,8 +2327,14 @@ namespace mfa
         {
             B* b = (B*)b_;
 
-            // top-level mfa data
+            // top-level mfa data, preceded by the error bound in the compressed format
             diy::load(bb, b->dom_dim);
+            b->save_err_bound = 0.0;
+            if (b->dom_dim == COMPRESSED_MODEL_FLAG)
+            {
+                diy::load(bb, b->save_err_bound);
+                diy::load(bb, b->dom_dim);
+            }
             diy::load(bb, b->pt_dim);
             b->mfa = new mfa::MFA<T>(b->dom_dim);
 
@@ -1513,7 +2383,7 @@ namespace mfa
                 for (TensorProduct<T>& t: b->vars[i].mfa_data->tmesh.tensor_prods)
                     diy::load(bb, t.nctrl_pts);
                 for (TensorProduct<T>& t: b->vars[i].mfa_data->tmesh.tensor_prods)
-                    diy::load(bb, t.ctrl_pts);
+                    load_ctrl_pts(bb, t, b->save_err_bound);
                 for (TensorProduct<T>& t: b->vars[i].mfa_data->tmesh.tensor_prods)
                     diy::load(bb, t.weights);
                 for (TensorProduct<T>& t: b->vars[i].mfa_data->tmesh.tensor_prods)
@@ -0,0 +1,224 @@
+//--------------------------------------------------------------
+// checkpoint and restart of adaptive encoding
+//
+// an encoding of several models in turn (e.g., the geometry and the science
+// variables of a block) registers each model with the checkpoint before
+// refining it; every interval rounds, the encoder writes the T-meshes of all
+// registered models, the round and level to continue from, and the knots
+// needed by a warm-started refit, to one file with diy serialization
+//
+// on restart, the models are created as for a new encoding and restored in
+// the same order: models completed before the checkpoint are skipped, and
+// the last one continues from the saved round with identical results
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _CHECKPOINT_HPP
+#define _CHECKPOINT_HPP
+
+#include    <vector>
+#include    <string>
+#include    <cstdio>
+#include    <diy/serialization.hpp>
+
+using namespace std;
+
+namespace mfa
+{
+    template <typename T>                               // float or double
+    class AdaptiveCheckpoint
+    {
+        diy::MemoryBuffer       bb;                     // checkpoint being restored
+        size_t                  nsaved;                 // number of models in the checkpoint being restored
+        bool                    last_done;              // whether the last model in the checkpoint was complete
+
+        static void SaveTmesh(diy::BinaryBuffer& bb, const Tmesh<T>& tmesh)
+        {
+            diy::save(bb, tmesh.all_knots);
+            diy::save(bb, tmesh.all_knot_levels);
+            diy::save(bb, tmesh.all_knot_param_idxs);
+            diy::save(bb, tmesh.cur_split_dim);
+            diy::save(bb, tmesh.max_level);
+            diy::save(bb, tmesh.tensor_prods.size());
+            for (auto i = 0; i < tmesh.tensor_prods.size(); i++)
+            {
+                const TensorProduct<T>& t = tmesh.tensor_prods[i];
+                diy::save(bb, t.knot_mins);
+                diy::save(bb, t.knot_maxs);
+                diy::save(bb, t.nctrl_pts.data(), t.nctrl_pts.size());
+                diy::save(bb, t.ctrl_pts.rows());
+                diy::save(bb, t.ctrl_pts.cols());
+                diy::save(bb, t.ctrl_pts.data(), t.ctrl_pts.size());
+                diy::save(bb, t.weights.size());
+                diy::save(bb, t.weights.data(), t.weights.size());
+                diy::save(bb, t.next);
+                diy::save(bb, t.prev);
+                diy::save(bb, t.level);
+                diy::save(bb, t.knot_idxs);
+                diy::save(bb, t.done);
+                diy::save(bb, t.parent);
+                diy::save(bb, t.parent_exists);
+            }
+        }
+
+        static void LoadTmesh(diy::BinaryBuffer& bb, Tmesh<T>& tmesh)
+        {
+            Eigen::Index    rows, cols;
+            size_t          ntensor_prods;
+            diy::load(bb, tmesh.all_knots);
+            diy::load(bb, tmesh.all_knot_levels);
+            diy::load(bb, tmesh.all_knot_param_idxs);
+            diy::load(bb, tmesh.cur_split_dim);
+            diy::load(bb, tmesh.max_level);
+            diy::load(bb, ntensor_prods);
+            tmesh.tensor_prods.clear();
+            tmesh.tensor_prods.resize(ntensor_prods);
+            for (auto i = 0; i < ntensor_prods; i++)
+            {
+                TensorProduct<T>& t = tmesh.tensor_prods[i];
+                diy::load(bb, t.knot_mins);
+                diy::load(bb, t.knot_maxs);
+                t.nctrl_pts.resize(tmesh.dom_dim_);
+                diy::load(bb, t.nctrl_pts.data(), tmesh.dom_dim_);
+                diy::load(bb, rows);
+                diy::load(bb, cols);
+                t.ctrl_pts.resize(rows, cols);
+                diy::load(bb, t.ctrl_pts.data(), t.ctrl_pts.size());
+                diy::load(bb, rows);
+                t.weights.resize(rows);
+                diy::load(bb, t.weights.data(), rows);
+                diy::load(bb, t.next);
+                diy::load(bb, t.prev);
+                diy::load(bb, t.level);
+                diy::load(bb, t.knot_idxs);
+                diy::load(bb, t.done);
+                diy::load(bb, t.parent);
+                diy::load(bb, t.parent_exists);
+            }
+            tmesh.tensor_index.clear(tmesh.dom_dim_);     // the index of the model as created counts as many tensors, but covers other extents
+            tmesh.sync_tensor_index();
+        }
+
+        // writes all registered models; the file is replaced only once complete
+        void Write(bool done) const
+        {
+            diy::MemoryBuffer out;
+            diy::save(out, models.size());
+            diy::save(out, done);
+            diy::save(out, iter);
+            diy::save(out, parent_level);
+            diy::save(out, old_knots);
+            for (auto i = 0; i < models.size(); i++)
+                SaveTmesh(out, models[i]->tmesh);
+
+            string tmp = filename + ".tmp";
+            FILE* fd = fopen(tmp.c_str(), "wb");
+            if (!fd || fwrite(&out.buffer[0], 1, out.size(), fd) != out.size() || fclose(fd))
+            {
+                fprintf(stderr, "Error: AdaptiveCheckpoint: failed writing %s\n", tmp.c_str());
+                exit(1);
+            }
+            if (rename(tmp.c_str(), filename.c_str()))
+            {
+                fprintf(stderr, "Error: AdaptiveCheckpoint: unable to rename %s to %s\n", tmp.c_str(), filename.c_str());
+                exit(1);
+            }
+        }
+
+    public:
+
+        string                  filename;               // checkpoint file
+        int                     interval;               // rounds between checkpoints (0 = no checkpoints)
+        vector<MFA_Data<T>*>    models;                 // registered models, in order of encoding; the last one is being refined
+        int                     iter;                   // next round of the last model
+        int                     parent_level;           // level of the T-mesh being refined in the last model (MFA_TMESH only)
+        vector<vector<T>>       old_knots;              // knots of the last model before its latest insertion (warm-started refit only)
+        bool                    resume;                 // whether the last model continues from the above state
+
+        AdaptiveCheckpoint(
+                const string&   filename_,              // checkpoint file
+                int             interval_) :            // rounds between checkpoints (0 = no checkpoints)
+            nsaved(0),
+            last_done(false),
+            filename(filename_),
+            interval(interval_),
+            iter(0),
+            parent_level(0),
+            resume(false)                               {}
+
+        // reads a checkpoint to restore models from
+        // returns the number of models saved in it, 0 if there is no checkpoint file
+        size_t Read()
+        {
+            FILE* fd = fopen(filename.c_str(), "rb");
+            if (!fd)
+                return 0;
+            fseek(fd, 0, SEEK_END);
+            bb.buffer.resize(ftell(fd));
+            fseek(fd, 0, SEEK_SET);
+            if (bb.buffer.size() && fread(&bb.buffer[0], 1, bb.buffer.size(), fd) != bb.buffer.size())
+            {
+                fprintf(stderr, "Error: AdaptiveCheckpoint: failed reading %s\n", filename.c_str());
+                exit(1);
+            }
+            fclose(fd);
+            bb.reset();
+
+            diy::load(bb, nsaved);
+            diy::load(bb, last_done);
+            diy::load(bb, iter);
+            diy::load(bb, parent_level);
+            diy::load(bb, old_knots);
+            return nsaved;
+        }
+
+        // registers the next model to be encoded, restoring its T-mesh if it is in the checkpoint
+        // mfa_data is created and its knots set as for a new encoding
+        // returns true if the model was complete in the checkpoint and needs no more refinement;
+        // otherwise, resume is set if the encoding of the model continues from the checkpoint
+        bool Restore(MFA_Data<T>& mfa_data)
+        {
+            models.push_back(&mfa_data);
+            resume = false;
+            if (models.size() > nsaved)                 // not in the checkpoint, start over
+            {
+                iter            = 0;
+                parent_level    = 0;
+                old_knots.clear();
+                return false;
+            }
+
+            LoadTmesh(bb, mfa_data.tmesh);
+            if (models.size() < nsaved || last_done)
+                return true;
+            resume = true;
+            return false;
+        }
+
+        // called by the encoder at the end of round iter_ of the last model
+        void Round(
+                int                         iter_,      // round just finished
+                int                         parent_level_,
+                const vector<vector<T>>&    old_knots_)
+        {
+            iter            = iter_ + 1;
+            parent_level    = parent_level_;
+            if (interval > 0 && iter % interval == 0)
+            {
+                old_knots = old_knots_;
+                Write(false);
+            }
+        }
+
+        // called by the encoder when the last model is complete
+        void Done()
+        {
+            if (interval > 0)
+                Write(true);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,301 @@
+//--------------------------------------------------------------
+// compact T-mesh storage
+//
+// tensor products stored as flat structure-of-arrays:
+// extents, levels, and numbers of control points in contiguous arrays,
+// neighbors and tensor knot indices in compressed sparse row (CSR) form,
+// and control points and weights in one arena with per-tensor offsets
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _COMPACT_TMESH_HPP
+#define _COMPACT_TMESH_HPP
+
+using namespace std;
+
+namespace mfa
+{
+    template <typename T>
+    struct CompactTmesh
+    {
+        int                 dom_dim;            // domain dimensionality
+        size_t              ntensors;           // number of tensor products
+
+        // per tensor arrays, [tensor * dom_dim + dim] for arrays over dimensions
+        vector<KnotIdx>     knot_mins;          // indices into all_knots of min. corner
+        vector<KnotIdx>     knot_maxs;          // indices into all_knots of max. corner
+        vector<int>         nctrl_pts;          // number of control points
+        vector<int>         levels;             // refinement level
+        vector<char>        done;               // no more knots need to be added to this tensor
+        vector<TensorIdx>   parents;            // parent from which tensor was refined (candidate tensors only)
+        vector<char>        parent_exists;      // parent exists and index to it is valid
+
+        // CSR arrays: entries for (tensor, dim) are [ofst[tensor * dom_dim + dim], ofst[tensor * dom_dim + dim + 1])
+        vector<size_t>      next_ofst;          // offsets into next_idxs
+        vector<TensorIdx>   next_idxs;          // next neighbors (unsorted)
+        vector<size_t>      prev_ofst;          // offsets into prev_idxs
+        vector<TensorIdx>   prev_idxs;          // previous neighbors (unsorted)
+        vector<size_t>      knot_idxs_ofst;     // offsets into knot_idxs
+        vector<KnotIdx>     knot_idxs;          // all_knots indices of knots belonging to the tensor (sorted)
+
+        // arena: rows of tensor t are [ctrl_pt_ofst[t], ctrl_pt_ofst[t + 1])
+        MatrixX<T>          ctrl_pts;           // control points of all tensors, one per row
+        VectorX<T>          weights;            // weights of all tensors
+        vector<size_t>      ctrl_pt_ofst;       // offsets into rows of ctrl_pts
+        vector<size_t>      weight_ofst;        // offsets into weights
+
+        CompactTmesh(int dom_dim_ = 0)          { clear(dom_dim_); }
+
+        CompactTmesh(const Tmesh<T>& tmesh)     { assign(tmesh); }
+
+        // remove all tensors and set the dimensionality
+        void clear(int dom_dim_)
+        {
+            dom_dim     = dom_dim_;
+            ntensors    = 0;
+            knot_mins.clear();
+            knot_maxs.clear();
+            nctrl_pts.clear();
+            levels.clear();
+            done.clear();
+            parents.clear();
+            parent_exists.clear();
+            next_ofst.assign(1, 0);
+            next_idxs.clear();
+            prev_ofst.assign(1, 0);
+            prev_idxs.clear();
+            knot_idxs_ofst.assign(1, 0);
+            knot_idxs.clear();
+            ctrl_pts.resize(0, 0);
+            weights.resize(0);
+            ctrl_pt_ofst.assign(1, 0);
+            weight_ofst.assign(1, 0);
+        }
+
+        // copy tensor products of a tmesh into compact form
+        void assign(const Tmesh<T>& tmesh)
+        {
+            assign(tmesh.tensor_prods, tmesh.dom_dim_);
+        }
+
+        // copy tensor products into compact form
+        // each array is sized once, so the copy makes a fixed number of allocations regardless of the number of tensors
+        void assign(const vector<TensorProduct<T>>& tensor_prods,
+                    int                             dom_dim_)
+        {
+            clear(dom_dim_);
+            size_t nt = tensor_prods.size();
+
+            // sizes
+            size_t nnext = 0, nprev = 0, nknots = 0, nctrl = 0, nweights = 0;
+            int    cols  = nt ? tensor_prods[0].ctrl_pts.cols() : 0;
+            for (auto& t : tensor_prods)
+            {
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    nnext   += t.next[k].size();
+                    nprev   += t.prev[k].size();
+                    nknots  += t.knot_idxs[k].size();
+                }
+                if (t.ctrl_pts.rows() && t.ctrl_pts.cols() != cols)
+                {
+                    fprintf(stderr, "Error: CompactTmesh::assign(): tensors have control points of different dimensionality\n");
+                    abort();
+                }
+                nctrl       += t.ctrl_pts.rows();
+                nweights    += t.weights.size();
+            }
+
+            knot_mins.reserve(nt * dom_dim);
+            knot_maxs.reserve(nt * dom_dim);
+            nctrl_pts.reserve(nt * dom_dim);
+            levels.reserve(nt);
+            done.reserve(nt);
+            parents.reserve(nt);
+            parent_exists.reserve(nt);
+            next_ofst.reserve(nt * dom_dim + 1);
+            prev_ofst.reserve(nt * dom_dim + 1);
+            knot_idxs_ofst.reserve(nt * dom_dim + 1);
+            next_idxs.reserve(nnext);
+            prev_idxs.reserve(nprev);
+            knot_idxs.reserve(nknots);
+            ctrl_pt_ofst.reserve(nt + 1);
+            weight_ofst.reserve(nt + 1);
+            ctrl_pts.resize(nctrl, cols);
+            weights.resize(nweights);
+
+            for (auto& t : tensor_prods)
+                append(t);
+        }
+
+        // append one tensor product
+        // the control point arena grows geometrically when its capacity is exceeded
+        void append(const TensorProduct<T>& t)
+        {
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                knot_mins.push_back(t.knot_mins[k]);
+                knot_maxs.push_back(t.knot_maxs[k]);
+                nctrl_pts.push_back(t.nctrl_pts.size() ? t.nctrl_pts(k) : 0);
+
+                next_idxs.insert(next_idxs.end(), t.next[k].begin(), t.next[k].end());
+                next_ofst.push_back(next_idxs.size());
+                prev_idxs.insert(prev_idxs.end(), t.prev[k].begin(), t.prev[k].end());
+                prev_ofst.push_back(prev_idxs.size());
+                knot_idxs.insert(knot_idxs.end(), t.knot_idxs[k].begin(), t.knot_idxs[k].end());
+                knot_idxs_ofst.push_back(knot_idxs.size());
+            }
+            levels.push_back(t.level);
+            done.push_back(t.done);
+            parents.push_back(t.parent);
+            parent_exists.push_back(t.parent_exists);
+
+            // control points
+            size_t ofst = ctrl_pt_ofst.back();
+            if (t.ctrl_pts.rows())
+            {
+                if (ctrl_pts.cols() == 0 && ofst == 0)
+                    ctrl_pts.resize(ctrl_pts.rows(), t.ctrl_pts.cols());
+                if (t.ctrl_pts.cols() != ctrl_pts.cols())
+                {
+                    fprintf(stderr, "Error: CompactTmesh::append(): tensor has control points of different dimensionality\n");
+                    abort();
+                }
+                if (ofst + t.ctrl_pts.rows() > ctrl_pts.rows())
+                    ctrl_pts.conservativeResize(max(ofst + t.ctrl_pts.rows(), 2 * (size_t)ctrl_pts.rows()), Eigen::NoChange);
+                ctrl_pts.middleRows(ofst, t.ctrl_pts.rows()) = t.ctrl_pts;
+            }
+            ctrl_pt_ofst.push_back(ofst + t.ctrl_pts.rows());
+
+            // weights
+            ofst = weight_ofst.back();
+            if (t.weights.size())
+            {
+                if (ofst + t.weights.size() > weights.size())
+                    weights.conservativeResize(max(ofst + t.weights.size(), 2 * (size_t)weights.size()));
+                weights.segment(ofst, t.weights.size()) = t.weights;
+            }
+            weight_ofst.push_back(ofst + t.weights.size());
+
+            ntensors++;
+        }
+
+        // release unused capacity of the control point and weight arenas
+        void shrink()
+        {
+            ctrl_pts.conservativeResize(ctrl_pt_ofst.back(), Eigen::NoChange);
+            weights.conservativeResize(weight_ofst.back());
+        }
+
+        // expand into tensor products of the current structure, for compatibility
+        void expand(vector<TensorProduct<T>>& tensor_prods) const
+        {
+            tensor_prods.resize(ntensors);
+            for (auto i = 0; i < ntensors; i++)
+                tensor(i, tensor_prods[i]);
+        }
+
+        // replace the tensor products of a tmesh by the expanded compact tensors
+        // rebuilds the tmesh spatial index
+        void expand(Tmesh<T>& tmesh) const
+        {
+            if (tmesh.dom_dim_ != dom_dim)
+            {
+                fprintf(stderr, "Error: CompactTmesh::expand(): tmesh dimensionality does not match\n");
+                abort();
+            }
+            expand(tmesh.tensor_prods);
+            tmesh.sync_tensor_index();
+        }
+
+        // expand one tensor product
+        void tensor(TensorIdx               t_idx,
+                    TensorProduct<T>&       t) const
+        {
+            t.knot_mins.assign(&knot_mins[t_idx * dom_dim], &knot_mins[t_idx * dom_dim] + dom_dim);
+            t.knot_maxs.assign(&knot_maxs[t_idx * dom_dim], &knot_maxs[t_idx * dom_dim] + dom_dim);
+            t.nctrl_pts.resize(dom_dim);
+            t.next.resize(dom_dim);
+            t.prev.resize(dom_dim);
+            t.knot_idxs.resize(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                size_t i = t_idx * dom_dim + k;
+                t.nctrl_pts(k) = nctrl_pts[i];
+                t.next[k].assign(next_idxs.begin() + next_ofst[i], next_idxs.begin() + next_ofst[i + 1]);
+                t.prev[k].assign(prev_idxs.begin() + prev_ofst[i], prev_idxs.begin() + prev_ofst[i + 1]);
+                t.knot_idxs[k].assign(knot_idxs.begin() + knot_idxs_ofst[i], knot_idxs.begin() + knot_idxs_ofst[i + 1]);
+            }
+            t.level         = levels[t_idx];
+            t.done          = done[t_idx];
+            t.parent        = parents[t_idx];
+            t.parent_exists = parent_exists[t_idx];
+            t.ctrl_pts      = tensor_ctrl_pts(t_idx);
+            t.weights       = tensor_weights(t_idx);
+        }
+
+        // control points of one tensor, a view into the arena
+        Eigen::Block<MatrixX<T>> tensor_ctrl_pts(TensorIdx t_idx)
+        {
+            return ctrl_pts.middleRows(ctrl_pt_ofst[t_idx], ctrl_pt_ofst[t_idx + 1] - ctrl_pt_ofst[t_idx]);
+        }
+
+        Eigen::Block<const MatrixX<T>> tensor_ctrl_pts(TensorIdx t_idx) const
+        {
+            return ctrl_pts.middleRows(ctrl_pt_ofst[t_idx], ctrl_pt_ofst[t_idx + 1] - ctrl_pt_ofst[t_idx]);
+        }
+
+        // weights of one tensor, a view into the arena
+        Eigen::VectorBlock<VectorX<T>> tensor_weights(TensorIdx t_idx)
+        {
+            return weights.segment(weight_ofst[t_idx], weight_ofst[t_idx + 1] - weight_ofst[t_idx]);
+        }
+
+        Eigen::VectorBlock<const VectorX<T>> tensor_weights(TensorIdx t_idx) const
+        {
+            return weights.segment(weight_ofst[t_idx], weight_ofst[t_idx + 1] - weight_ofst[t_idx]);
+        }
+
+        // next neighbors of a tensor in one dimension, [first, last)
+        const TensorIdx* next_begin(TensorIdx t_idx, int dim) const { return next_idxs.data() + next_ofst[t_idx * dom_dim + dim]; }
+        const TensorIdx* next_end(TensorIdx t_idx, int dim) const   { return next_idxs.data() + next_ofst[t_idx * dom_dim + dim + 1]; }
+
+        // previous neighbors of a tensor in one dimension, [first, last)
+        const TensorIdx* prev_begin(TensorIdx t_idx, int dim) const { return prev_idxs.data() + prev_ofst[t_idx * dom_dim + dim]; }
+        const TensorIdx* prev_end(TensorIdx t_idx, int dim) const   { return prev_idxs.data() + prev_ofst[t_idx * dom_dim + dim + 1]; }
+
+        // knot indices of a tensor in one dimension, [first, last)
+        const KnotIdx* knot_idxs_begin(TensorIdx t_idx, int dim) const { return knot_idxs.data() + knot_idxs_ofst[t_idx * dom_dim + dim]; }
+        const KnotIdx* knot_idxs_end(TensorIdx t_idx, int dim) const   { return knot_idxs.data() + knot_idxs_ofst[t_idx * dom_dim + dim + 1]; }
+
+        // total number of control points in all tensors
+        size_t tot_nctrl_pts() const                { return ctrl_pt_ofst.back(); }
+
+        // whether a point in index space is in the closed box of a tensor
+        bool in(const vector<KnotIdx>&  pt,
+                TensorIdx               t_idx) const
+        {
+            const KnotIdx* mins = &knot_mins[t_idx * dom_dim];
+            const KnotIdx* maxs = &knot_maxs[t_idx * dom_dim];
+            for (auto k = 0; k < dom_dim; k++)
+                if (pt[k] < mins[k] || pt[k] > maxs[k])
+                    return false;
+            return true;
+        }
+
+        // first tensor containing a point in index space, optionally only at levels <= max_level
+        // returns ntensors if not found
+        TensorIdx search(const vector<KnotIdx>&     pt,
+                         int                        max_level = -1) const
+        {
+            for (auto i = 0; i < ntensors; i++)
+                if ((max_level < 0 || levels[i] <= max_level) && in(pt, i))
+                    return i;
+            return ntensors;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,489 @@
+//--------------------------------------------------------------
+// error-bounded compression of control points
+//
+// each column of a tensor's control points is predicted from its already
+// reconstructed neighbors in the control net (Lorenzo predictor), the
+// prediction residual is quantized to within an absolute error bound, and
+// the quantization codes are entropy coded with a canonical Huffman code;
+// residuals that do not fit the code range are stored exactly
+//
+// because the B-spline basis functions are nonnegative and sum to one, a
+// bound on the error of every control point also bounds the error of every
+// decoded point
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _COMPRESS_HPP
+#define _COMPRESS_HPP
+
+#include    <vector>
+#include    <queue>
+#include    <cmath>
+#include    <cstring>
+#include    <cstdint>
+#include    <algorithm>
+
+using namespace std;
+
+namespace mfa
+{
+    // first int of a saved block in the compressed format; the legacy format starts with dom_dim > 0
+    static const int COMPRESSED_MODEL_FLAG = -0x4d464143;
+
+    // appends bits to a byte vector, most significant bit first
+    struct BitWriter
+    {
+        vector<unsigned char>&  out;
+        uint64_t                acc;                    // pending bits
+        int                     nbits;                  // number of pending bits
+
+        BitWriter(vector<unsigned char>& out_) : out(out_), acc(0), nbits(0)    {}
+
+        void Put(uint32_t code, int len)
+        {
+            acc = (acc << len) | code;
+            nbits += len;
+            while (nbits >= 8)
+            {
+                nbits -= 8;
+                out.push_back((unsigned char)(acc >> nbits));
+            }
+            acc &= (uint64_t(1) << nbits) - 1;
+        }
+
+        void Flush()
+        {
+            if (nbits)
+                out.push_back((unsigned char)(acc << (8 - nbits)));
+            acc = 0;
+            nbits = 0;
+        }
+    };
+
+    // reads bits written by BitWriter
+    struct BitReader
+    {
+        const unsigned char*    in;
+        size_t                  n;                      // number of bytes available
+        size_t                  pos;                    // current bit position
+
+        BitReader(const unsigned char* in_, size_t n_) : in(in_), n(n_), pos(0)   {}
+
+        int Bit()
+        {
+            if ((pos >> 3) >= n)
+            {
+                fprintf(stderr, "Error: BitReader ran past the end of the compressed stream\n");
+                exit(1);
+            }
+            int b = (in[pos >> 3] >> (7 - (pos & 7))) & 1;
+            pos++;
+            return b;
+        }
+
+        size_t Bytes() const                            { return (pos + 7) >> 3; }
+    };
+
+    // variable-length unsigned integers, 7 bits per byte
+    inline void PutVarint(vector<unsigned char>& out, uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back((unsigned char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((unsigned char)v);
+    }
+
+    inline uint64_t GetVarint(const unsigned char*& in, const unsigned char* end)
+    {
+        uint64_t v = 0;
+        for (int shift = 0; in < end && shift < 64; shift += 7)
+        {
+            unsigned char c = *in++;
+            v |= uint64_t(c & 0x7f) << shift;
+            if (!(c & 0x80))
+                return v;
+        }
+        fprintf(stderr, "Error: GetVarint(): truncated compressed stream\n");
+        exit(1);
+    }
+
+    // canonical Huffman coding of small nonnegative integer symbols
+    class HuffmanCoder
+    {
+        static const int max_len = 30;                  // longest code length allowed
+
+        // code length of each symbol from its frequency (0 for unused symbols)
+        static void CodeLengths(
+                const vector<size_t>&   freq,
+                vector<int>&            len)
+        {
+            len.assign(freq.size(), 0);
+            vector<size_t> f(freq);
+            for (;;)
+            {
+                // package-merge would be optimal; rebuilding with flattened frequencies is good enough
+                typedef pair<size_t, int> Node;             // (weight, node index)
+                priority_queue<Node, vector<Node>, greater<Node>> heap;
+                vector<int> parent;
+                for (auto i = 0; i < f.size(); i++)
+                    if (f[i])
+                    {
+                        heap.push(Node(f[i], (int)parent.size()));
+                        parent.push_back(-1);
+                    }
+                if (parent.size() == 1)
+                {
+                    for (auto i = 0; i < f.size(); i++)
+                        if (f[i])
+                            len[i] = 1;
+                    return;
+                }
+                while (heap.size() > 1)
+                {
+                    Node a = heap.top(); heap.pop();
+                    Node b = heap.top(); heap.pop();
+                    parent[a.second] = parent[b.second] = (int)parent.size();
+                    heap.push(Node(a.first + b.first, (int)parent.size()));
+                    parent.push_back(-1);
+                }
+
+                // leaves are the first nodes, in symbol order
+                int leaf = 0, longest = 0;
+                for (auto i = 0; i < f.size(); i++)
+                {
+                    if (!f[i])
+                        continue;
+                    int l = 0;
+                    for (int k = leaf++; parent[k] >= 0; k = parent[k])
+                        l++;
+                    len[i] = l;
+                    longest = max(longest, l);
+                }
+                if (longest <= max_len)
+                    return;
+                for (auto i = 0; i < f.size(); i++)
+                    if (f[i])
+                        f[i] = (f[i] >> 1) | 1;
+            }
+        }
+
+        // canonical codes from code lengths
+        static void Codes(
+                const vector<int>&      len,
+                vector<uint32_t>&       code)
+        {
+            code.assign(len.size(), 0);
+            uint32_t c = 0;
+            for (int l = 1; l <= max_len; l++)
+            {
+                for (auto i = 0; i < len.size(); i++)
+                    if (len[i] == l)
+                        code[i] = c++;
+                c <<= 1;
+            }
+        }
+
+    public:
+
+        // appends the code table and the coded symbols to out
+        static void Encode(
+                const vector<uint32_t>&     syms,
+                vector<unsigned char>&      out)
+        {
+            uint32_t nsyms = 0;
+            for (auto i = 0; i < syms.size(); i++)
+                nsyms = max(nsyms, syms[i] + 1);
+            vector<size_t> freq(nsyms, 0);
+            for (auto i = 0; i < syms.size(); i++)
+                freq[syms[i]]++;
+
+            vector<int>         len;
+            vector<uint32_t>    code;
+            CodeLengths(freq, len);
+            Codes(len, code);
+
+            // table: number of used symbols, then (symbol delta, length) pairs
+            PutVarint(out, syms.size());
+            size_t nused = 0;
+            for (auto i = 0; i < nsyms; i++)
+                if (len[i])
+                    nused++;
+            PutVarint(out, nused);
+            uint32_t prev = 0;
+            for (uint32_t i = 0; i < nsyms; i++)
+                if (len[i])
+                {
+                    PutVarint(out, i - prev);
+                    out.push_back((unsigned char)len[i]);
+                    prev = i;
+                }
+
+            // coded symbols, preceded by their length in bytes
+            vector<unsigned char> bits;
+            BitWriter bw(bits);
+            for (auto i = 0; i < syms.size(); i++)
+                bw.Put(code[syms[i]], len[syms[i]]);
+            bw.Flush();
+            PutVarint(out, bits.size());
+            out.insert(out.end(), bits.begin(), bits.end());
+        }
+
+        // decodes symbols written by Encode, advancing in past them
+        static void Decode(
+                const unsigned char*&       in,
+                const unsigned char*        end,
+                vector<uint32_t>&           syms)
+        {
+            size_t n        = GetVarint(in, end);
+            size_t nused    = GetVarint(in, end);
+
+            // symbols sorted by (length, symbol) are in canonical code order
+            vector<uint32_t>    sorted_syms;
+            vector<int>         count(max_len + 1, 0);
+            vector<pair<int, uint32_t>> table(nused);
+            uint32_t prev = 0;
+            for (auto i = 0; i < nused; i++)
+            {
+                prev += (uint32_t)GetVarint(in, end);
+                if (in >= end || *in < 1 || *in > max_len)
+                {
+                    fprintf(stderr, "Error: HuffmanCoder::Decode(): corrupt code table\n");
+                    exit(1);
+                }
+                table[i] = make_pair((int)*in++, prev);
+                count[table[i].first]++;
+            }
+            sort(table.begin(), table.end());
+            for (auto i = 0; i < nused; i++)
+                sorted_syms.push_back(table[i].second);
+
+            size_t nbytes = GetVarint(in, end);
+            if (nbytes > (size_t)(end - in))
+            {
+                fprintf(stderr, "Error: HuffmanCoder::Decode(): truncated compressed stream\n");
+                exit(1);
+            }
+
+            syms.resize(n);
+            if (nused == 1)                             // a single symbol has a 1-bit code
+            {
+                fill(syms.begin(), syms.end(), sorted_syms[0]);
+                in += nbytes;
+                return;
+            }
+
+            // walk the canonical code one bit at a time
+            BitReader br(in, nbytes);
+            for (auto i = 0; i < n; i++)
+            {
+                uint32_t    c       = 0;                // code read so far
+                uint32_t    first   = 0;                // first code of the current length
+                size_t      index   = 0;                // index of the first symbol of the current length
+                for (int l = 1; ; l++)
+                {
+                    if (l > max_len)
+                    {
+                        fprintf(stderr, "Error: HuffmanCoder::Decode(): invalid code\n");
+                        exit(1);
+                    }
+                    c = (c << 1) | br.Bit();
+                    if (c - first < (uint32_t)count[l])
+                    {
+                        syms[i] = sorted_syms[index + c - first];
+                        break;
+                    }
+                    index += count[l];
+                    first  = (first + count[l]) << 1;
+                }
+            }
+            in += nbytes;
+        }
+    };
+
+    // error-bounded coder for the control points of one tensor product
+    template <typename T>                               // float or double
+    class CtrlPtCodec
+    {
+        static const int radius = 1 << 15;              // quantization codes are in (-radius, radius); code 0 escapes
+
+        // Lorenzo prediction of point idx from the reconstructed values of lower-index neighbors
+        static T Predict(
+                const vector<T>&    R,                  // reconstructed values so far
+                size_t              idx,                // linear index of the point in the control net
+                const VectorXi&     ijk,                // multi-index of the point
+                const vector<size_t>& stride)           // linear stride of each dimension
+        {
+            int dom_dim = ijk.size();
+            T   pred    = 0.0;
+            for (int s = 1; s < (1 << dom_dim); s++)    // nonempty subsets of dimensions
+            {
+                size_t  nbr     = idx;
+                int     nset    = 0;
+                bool    valid   = true;
+                for (int k = 0; k < dom_dim; k++)
+                    if (s & (1 << k))
+                    {
+                        if (ijk(k) == 0)
+                        {
+                            valid = false;
+                            break;
+                        }
+                        nbr -= stride[k];
+                        nset++;
+                    }
+                if (valid)
+                    pred += (nset & 1) ? R[nbr] : -R[nbr];
+            }
+            return pred;
+        }
+
+        static void Advance(
+                VectorXi&           ijk,
+                const VectorXi&     nctrl_pts)
+        {
+            for (auto k = 0; k < ijk.size(); k++)
+            {
+                if (++ijk(k) < nctrl_pts(k))
+                    return;
+                ijk(k) = 0;
+            }
+        }
+
+        static void Strides(
+                const VectorXi&     nctrl_pts,
+                vector<size_t>&     stride)
+        {
+            stride.resize(nctrl_pts.size());
+            size_t s = 1;
+            for (auto k = 0; k < nctrl_pts.size(); k++)
+            {
+                stride[k] = s;
+                s *= nctrl_pts(k);
+            }
+        }
+
+    public:
+
+        // appends the compressed control points to out
+        // when base is given, the differences P - base are coded instead, with the same bound on P
+        static void Compress(
+                const MatrixX<T>&       P,              // control points, one row per point
+                const VectorXi&         nctrl_pts,      // number of control points in each dimension
+                T                       err_bound,      // absolute error bound on every control point (> 0)
+                vector<unsigned char>&  out,
+                const MatrixX<T>*       base = NULL,    // (optional) reconstructed prediction of P, same size
+                bool                    lorenzo = true) // predict from neighbors in the control net
+        {
+            if (P.rows() != nctrl_pts.prod())
+            {
+                fprintf(stderr, "Error: CtrlPtCodec::Compress(): %ld control points do not match the control net\n",
+                        (long)P.rows());
+                exit(1);
+            }
+            vector<size_t> stride;
+            Strides(nctrl_pts, stride);
+
+            T               step = 2.0 * err_bound;     // quantization step
+            vector<T>       R(P.rows());                // reconstructed values (differences from base)
+            vector<uint32_t> syms(P.rows());            // quantization codes
+            vector<T>       outliers;                   // values stored exactly
+            VectorXi        ijk(nctrl_pts.size());
+
+            for (auto j = 0; j < P.cols(); j++)
+            {
+                outliers.clear();
+                ijk.setZero();
+                for (size_t i = 0; i < P.rows(); i++)
+                {
+                    T v     = P(i, j);
+                    T b     = base ? (*base)(i, j) : 0.0;
+                    T pred  = lorenzo ? Predict(R, i, ijk, stride) : 0.0;
+                    T q     = std::round((v - b - pred) / step);
+                    T r     = pred + q * step;
+                    if (std::isfinite(q) && fabs(q) < radius && fabs(b + r - v) <= err_bound)
+                    {
+                        syms[i] = (uint32_t)(q + radius);
+                        R[i]    = r;
+                    }
+                    else
+                    {
+                        syms[i] = 0;
+                        R[i]    = v - b;
+                        outliers.push_back(v);
+                    }
+                    Advance(ijk, nctrl_pts);
+                }
+                HuffmanCoder::Encode(syms, out);
+                PutVarint(out, outliers.size());
+                size_t pos = out.size();
+                out.resize(pos + outliers.size() * sizeof(T));
+                if (outliers.size())
+                    memcpy(&out[pos], &outliers[0], outliers.size() * sizeof(T));
+            }
+        }
+
+        // decompresses control points written by Compress, advancing in past them
+        static void Decompress(
+                const unsigned char*&   in,
+                const unsigned char*    end,
+                const VectorXi&         nctrl_pts,      // number of control points in each dimension
+                int                     ncols,          // number of coordinates per control point
+                T                       err_bound,      // error bound used by Compress
+                MatrixX<T>&             P,              // (output) control points, must not be base
+                const MatrixX<T>*       base = NULL,    // (optional) base used by Compress
+                bool                    lorenzo = true) // lorenzo flag used by Compress
+        {
+            vector<size_t> stride;
+            Strides(nctrl_pts, stride);
+
+            T               step = 2.0 * err_bound;
+            size_t          npts = nctrl_pts.prod();
+            vector<T>       R(npts);
+            vector<uint32_t> syms;
+            VectorXi        ijk(nctrl_pts.size());
+            P.resize(npts, ncols);
+
+            for (auto j = 0; j < ncols; j++)
+            {
+                HuffmanCoder::Decode(in, end, syms);
+                size_t noutliers = GetVarint(in, end);
+                if (syms.size() != npts || noutliers * sizeof(T) > (size_t)(end - in))
+                {
+                    fprintf(stderr, "Error: CtrlPtCodec::Decompress(): corrupt compressed control points\n");
+                    exit(1);
+                }
+                const unsigned char* outliers = in;
+                in += noutliers * sizeof(T);
+
+                size_t o = 0;
+                ijk.setZero();
+                for (size_t i = 0; i < npts; i++)
+                {
+                    T b = base ? (*base)(i, j) : 0.0;
+                    if (syms[i] == 0)
+                    {
+                        if (o == noutliers)
+                        {
+                            fprintf(stderr, "Error: CtrlPtCodec::Decompress(): missing outlier values\n");
+                            exit(1);
+                        }
+                        memcpy(&P(i, j), outliers + sizeof(T) * o++, sizeof(T));
+                        R[i] = P(i, j) - b;
+                    }
+                    else
+                    {
+                        R[i]    = (lorenzo ? Predict(R, i, ijk, stride) : 0.0) + (T(syms[i]) - radius) * step;
+                        P(i, j) = b + R[i];
+                    }
+                    Advance(ijk, nctrl_pts);
+                }
+            }
+        }
+    };
+}
+
+#endif
@@ -13,6 +13,9 @@
 #include    "mfa.hpp"
 
 #include    <Eigen/Dense>
+#include    <map>
+#include    <queue>
+#include    <limits>
 
 typedef Eigen::MatrixXi MatrixXi;
 
@@ -24,6 +27,9 @@ namespace mfa
     template <typename T>
     class Decoder;
 
+    template <typename T>
+    class SpanBoundsIndex;
+
     template <typename T>                                   // float or double
     struct DecodeInfo
     {
@@ -240,6 +246,138 @@ namespace mfa
     };
 
 
+    // DecodeInfo for VolPtDers, decoding the value and all partial derivatives up to a given total order together
+    template <typename T>
+    struct DersDecodeInfo
+    {
+        BasisFunInfo<T>             bfi;        // scratch space for basis function computation
+        int                         dom_dim;    // domain dimension of model
+        int                         nders;      // max. total order of derivatives
+        vector<VectorXi>            ders;       // derivative orders in each dim. of each output row, graded by total order
+        vector<vector<vector<T>>>   D;          // D[k][r][i] = r-th derivative of i-th nonzero basis function in dim. k
+        vector<int>                 span;       // span containing the parameter in each dim.
+        MatrixX<T>                  P;          // control points (and weights) in the support of the point
+        vector<MatrixX<T>>          t0;         // control points contracted in dim. 0, one per derivative order in dim. 0
+        MatrixX<T>                  t1, t2;     // ping-pong buffers for contracting the remaining dims.
+        MatrixX<T>                  A;          // numerators of all derivatives (with denominators in last column if weighted)
+        vector<vector<int>>         rat_terms;  // for each row, pairs of (row of weight derivative, row of lower derivative) in the quotient rule
+        vector<vector<T>>           rat_coeffs; // binomial coefficients of the quotient rule terms
+
+        DersDecodeInfo(const MFA_Data<T>&   mfa_data,           // current mfa
+                       int                  nders_) :           // max. total order of derivatives
+            bfi(orders(mfa_data.p)),
+            dom_dim(mfa_data.dom_dim),
+            nders(nders_)
+        {
+            // derivative orders: by total order, then by decreasing order in the lowest dims
+            // eg, 2-d, nders = 2: (0,0), (1,0), (0,1), (2,0), (1,1), (0,2)
+            VectorXi a = VectorXi::Zero(dom_dim);
+            for (auto r = 0; r <= nders; r++)
+                graded(r, 0, a);
+
+            span.resize(dom_dim);
+            D.resize(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                D[k].resize(nders + 1);
+                for (auto r = 0; r <= nders; r++)
+                    D[k][r].assign(mfa_data.p(k) + 1, 0.0);
+            }
+            t0.resize(nders + 1);
+
+            // quotient rule: S_a = (A_a - sum_{0 < b <= a} C(a,b) W_b S_{a-b}) / W_0
+            rat_terms.resize(ders.size());
+            rat_coeffs.resize(ders.size());
+            for (auto i = 0; i < ders.size(); i++)
+                for (auto b = 1; b <= i; b++)
+                {
+                    if (((ders[b].array() > ders[i].array())).any())
+                        continue;
+                    VectorXi    c = ders[i] - ders[b];
+                    int         j = row(c);
+                    T           coeff = 1.0;
+                    for (auto k = 0; k < dom_dim; k++)
+                        coeff *= binom(ders[i](k), ders[b](k));
+                    rat_terms[i].push_back(b);
+                    rat_terms[i].push_back(j);
+                    rat_coeffs[i].push_back(coeff);
+                }
+        }
+
+        // output row of a vector of derivative orders
+        int row(const VectorXi& a) const
+        {
+            for (auto i = 0; i < ders.size(); i++)
+                if (ders[i] == a)
+                    return i;
+            return -1;
+        }
+
+        // output row of the second derivative in dims. k and l (k == l for pure 2nd derivatives)
+        int hess_row(int k, int l) const
+        {
+            VectorXi a = VectorXi::Zero(dom_dim);
+            a(k)++;
+            a(l)++;
+            return row(a);
+        }
+
+        private:
+
+        // appends all derivative orders with total order r whose dims. < k are already set in a
+        void graded(int r, int k, VectorXi& a)
+        {
+            if (k == dom_dim - 1)
+            {
+                a(k) = r;
+                ders.push_back(a);
+                a(k) = 0;
+                return;
+            }
+            for (auto i = r; i >= 0; i--)
+            {
+                a(k) = i;
+                graded(r - i, k + 1, a);
+            }
+            a(k) = 0;
+        }
+
+        // spline orders p + 1
+        static vector<int> orders(const VectorXi& p)
+        {
+            vector<int> q(p.size());
+            for (auto k = 0; k < p.size(); k++)
+                q[k] = p(k) + 1;
+            return q;
+        }
+
+        static T binom(int n, int k)
+        {
+            T b = 1.0;
+            for (auto i = 1; i <= k; i++)
+                b = b * (n - k + i) / i;
+            return b;
+        }
+    };
+
+    // type of a critical point from the signs of the Hessian eigenvalues
+    enum CriticalPointType
+    {
+        CP_MIN,                                             // all positive
+        CP_MAX,                                             // all negative
+        CP_SADDLE,                                          // mixed signs
+        CP_DEGENERATE,                                      // at least one (near) zero
+    };
+
+    template <typename T>                                   // float or double
+    struct CriticalPoint
+    {
+        VectorX<T>          param;                          // location in parameter space
+        T                   value;                          // value of the model
+        int                 type;                           // CriticalPointType
+        int                 index;                          // Morse index, number of negative Hessian eigenvalues
+    };
+
     template <typename T>                               // float or double
     class Decoder
     {
@@ -571,6 +709,131 @@ namespace mfa
 
         }
 
+        // decode at a regular grid in tiles, handing each tile of values to sink as soon as it is decoded,
+        // so that the whole grid is never in memory
+        // tiles are runs of consecutive grid points (dim. 0 fastest): all indices of the lower dims, a range of
+        // slabs in one dim, and a single index in the higher dims, sized so that the values fit in max_bytes
+        // concatenated in the order they are handed to sink, the tiles are the whole grid
+        // basis functions of the lower dims are computed once for all tiles, the others for each tile
+        // sink(first, values) receives the linear grid index of the first point of the tile and
+        // the values of the tile, one row per point and no geometry coordinates
+        template <typename Sink>
+        void DecodeGridTiled(
+                const VectorX<T>&   min_params,     // lower corner of decoding points
+                const VectorX<T>&   max_params,     // upper corner of decoding points
+                const VectorXi&     ndom_pts,       // number of points to decode in each direction
+                size_t              max_bytes,      // memory budget for the values of one tile
+                Sink&               sink)           // called with (size_t first, const MatrixX<T>& values) for each tile
+        {
+            const TensorProduct<T>& tensor  = mfa_data.tmesh.tensor_prods[0];          // assume only one tensor
+            int                     dom_dim = mfa_data.dom_dim;
+            Param<T>                grid(ndom_pts, min_params, max_params);
+            auto&                   params  = grid.param_grid;
+
+            // tile dim.: the highest dim. whose slabs of all the lower dims fit in the budget
+            size_t          max_pts = max(max_bytes / (tensor.ctrl_pts.cols() * sizeof(T)), size_t(1));
+            vector<size_t>  slab_pts(dom_dim, 1);                                       // number of points in one slab of each dim.
+            for (auto k = 1; k < dom_dim; k++)
+                slab_pts[k] = slab_pts[k - 1] * ndom_pts(k - 1);
+            int tile_dim = dom_dim - 1;
+            while (tile_dim > 0 && slab_pts[tile_dim] > max_pts)
+                tile_dim--;
+            int nslabs = min(size_t(ndom_pts(tile_dim)), max_pts / slab_pts[tile_dim]);
+
+            // basis functions of the lower dims. are the same for all tiles
+            vector<MatrixX<T>> NN(dom_dim);
+            for (auto k = 0; k < tile_dim; k++)
+                GridBasisFuns(k, params[k], 0, ndom_pts(k), NN[k]);
+
+            VectorXi    tile_start  = VectorXi::Zero(dom_dim);                          // grid index of first point of tile
+            VectorXi    tile_npts   = ndom_pts;                                         // number of points of tile in each dim.
+            size_t      first       = 0;                                                // linear grid index of first point of tile
+            size_t      tot_pts     = 1;
+            for (auto k = 0; k < dom_dim; k++)
+                tot_pts *= ndom_pts(k);
+            MatrixX<T>  values;
+            VectorXi    derivs;                                                         // do not use derivatives yet, pass size 0
+
+            while (first < tot_pts)
+            {
+                for (auto k = tile_dim; k < dom_dim; k++)
+                {
+                    tile_npts(k) = k == tile_dim ? min(nslabs, ndom_pts(k) - tile_start(k)) : 1;
+                    GridBasisFuns(k, params[k], tile_start(k), tile_npts(k), NN[k]);
+                }
+                VolIterator vol_it(tile_npts);
+                values.resize(vol_it.tot_iters(), tensor.ctrl_pts.cols());
+
+#ifdef MFA_SERIAL   // serial version
+
+                DecodeInfo<T>   decode_info(mfa_data, derivs);                          // reusable decode point info for calling VolPt repeatedly
+                VectorX<T>      cpt(tensor.ctrl_pts.cols());                            // evaluated point
+                VectorX<T>      param(dom_dim);                                         // parameters for one point
+                VectorXi        ijk(dom_dim);                                           // multidim index in tile
+
+                while (!vol_it.done())
+                {
+                    int j = (int) vol_it.cur_iter();
+                    for (auto i = 0; i < dom_dim; i++)
+                    {
+                        ijk[i]      = vol_it.idx_dim(i);
+                        param(i)    = params[i][tile_start(i) + ijk[i]];
+                    }
+                    VolPt_saved_basis_grid(ijk, param, cpt, decode_info, tensor, NN);
+                    vol_it.incr_iter();
+                    values.row(j) = cpt.transpose();
+                }
+
+#endif              // serial version
+
+#ifdef MFA_TBB      // TBB version
+
+                enumerable_thread_specific<DecodeInfo<T>>   thread_decode_info(mfa_data, derivs);
+                enumerable_thread_specific<VectorXi>        thread_ijk(dom_dim);            // multidim index in tile
+                enumerable_thread_specific<VectorX<T>>      thread_cpt(tensor.ctrl_pts.cols()); // evaluated point
+                enumerable_thread_specific<VectorX<T>>      thread_param(dom_dim);          // parameters for one point
+
+                parallel_for (size_t(0), (size_t)vol_it.tot_iters(), [&] (size_t j)
+                {
+                    vol_it.idx_ijk(j, thread_ijk.local());
+                    for (auto i = 0; i < dom_dim; i++)
+                        thread_param.local()(i) = params[i][tile_start(i) + thread_ijk.local()[i]];
+                    VolPt_saved_basis_grid(thread_ijk.local(), thread_param.local(), thread_cpt.local(), thread_decode_info.local(), tensor, NN);
+                    values.row(j) = thread_cpt.local().transpose();
+                });
+
+#endif              // TBB version
+
+                sink(first, values);
+                first += values.rows();
+
+                // next tile: advance the tile dim., carrying into the higher dims.
+                tile_start(tile_dim) += tile_npts(tile_dim);
+                for (auto k = tile_dim; k < dom_dim - 1 && tile_start(k) == ndom_pts(k); k++)
+                {
+                    tile_start(k) = 0;
+                    tile_start(k + 1)++;
+                }
+            }
+        }
+
+        // basis functions of n consecutive grid params of one dim., starting at params[first]
+        void GridBasisFuns(
+                int                 k,              // dimension
+                const vector<T>&    params,         // grid params of dim. k
+                int                 first,          // index of first param
+                int                 n,              // number of params
+                MatrixX<T>&         N)              // (output) basis functions, one row per param
+        {
+            int nctrl_pts = mfa_data.tmesh.tensor_prods[0].nctrl_pts(k);
+            N = MatrixX<T>::Zero(n, nctrl_pts);
+            for (auto i = 0; i < n; i++)
+            {
+                int span = mfa_data.FindSpan(k, params[first + i], nctrl_pts);
+                mfa_data.OrigBasisFuns(k, params[first + i], span, N, i);
+            }
+        }
+
         // decode a point in the t-mesh
         // TODO: serial implementation, no threading
         // TODO: no derivatives as yet
@@ -1453,6 +1716,590 @@ exit(1);
 			std::cout << "out_pt(0): " << out_pt(0) << std::endl;
         }
 
+        // value and all partial derivatives up to total order di.nders at a given parameter value
+        // basis functions and their derivatives are computed once per dim. with FastBasisFunsDers, the control points
+        // are contracted once per derivative order in dim. 0, and only the small partial sums are contracted per derivative
+        // derivatives are with respect to parameters; rows of out are ordered as di.ders, columns are coordinates
+        void VolPtDers(
+                const VectorX<T>&       param,      // parameter value in each dim. of desired point
+                DersDecodeInfo<T>&      di,         // reusable decode info allocated by caller
+                const TensorProduct<T>& tensor,     // tensor product to use for decoding
+                MatrixX<T>&             out) const  // (output) value and derivatives, di.ders.size() x ctrl_pts.cols()
+        {
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                di.span[k] = mfa_data.FindSpan(k, param(k), tensor);
+                BasisFunsDers(k, param(k), di.span[k], di.nders, di.D[k], di.bfi);
+            }
+            ContractDers(di, tensor, out);
+        }
+
+        // decodes the value and all partial derivatives up to total order nders at all points of a point set
+        // result has one row per point and DersDecodeInfo::ders.size() * ctrl_pts.cols() columns,
+        // ordered by derivative and then by coordinate
+        void DecodePointSetDers(
+                const PointSet<T>&      ps,         // PointSet containing parameters to decode at
+                int                     nders,      // max. total order of derivatives
+                MatrixX<T>&             result)     // (output) values and derivatives
+        {
+#ifdef MFA_TMESH
+            cerr << "ERROR: Cannot use DecodePointSetDers with TMesh" << endl;
+            exit(1);
+#endif
+            const TensorProduct<T>& tensor = mfa_data.tmesh.tensor_prods[0];
+            int ncols = tensor.ctrl_pts.cols();
+
+#ifdef MFA_TBB
+            enumerable_thread_specific<DersDecodeInfo<T>> thread_di([&]() { return DersDecodeInfo<T>(mfa_data, nders); });
+            result.resize(ps.npts, thread_di.local().ders.size() * ncols);
+
+            parallel_for (blocked_range<size_t>(0, ps.npts), [&](blocked_range<size_t>& r)
+            {
+                DersDecodeInfo<T>&  di = thread_di.local();
+                VectorX<T>          param(dom_dim);
+                MatrixX<T>          out;
+                for (auto i = r.begin(); i < r.end(); i++)
+                {
+                    ps.pt_params(i, param);
+                    VolPtDers(param, di, tensor, out);
+                    for (auto d = 0; d < out.rows(); d++)
+                        result.block(i, d * ncols, 1, ncols) = out.row(d);
+                }
+            });
+#endif
+#ifdef MFA_SERIAL
+            DersDecodeInfo<T>   di(mfa_data, nders);
+            VectorX<T>          param(dom_dim);
+            MatrixX<T>          out;
+            result.resize(ps.npts, di.ders.size() * ncols);
+            for (auto i = 0; i < ps.npts; i++)
+            {
+                ps.pt_params(i, param);
+                VolPtDers(param, di, tensor, out);
+                for (auto d = 0; d < out.rows(); d++)
+                    result.block(i, d * ncols, 1, ncols) = out.row(d);
+            }
+#endif
+        }
+
+        // decodes the value and all partial derivatives up to total order nders at a regular grid
+        // spans and basis function derivatives are computed once per grid line in each dim.
+        // result has one row per grid point (dim. 0 fastest) and DersDecodeInfo::ders.size() * ctrl_pts.cols() columns,
+        // ordered by derivative and then by coordinate
+        void DecodeGridDers(
+                const VectorX<T>&       min_params, // lower corner of decoding points
+                const VectorX<T>&       max_params, // upper corner of decoding points
+                const VectorXi&         ndom_pts,   // number of points to decode in each direction
+                int                     nders,      // max. total order of derivatives
+                MatrixX<T>&             result)     // (output) values and derivatives
+        {
+#ifdef MFA_TMESH
+            cerr << "ERROR: Cannot use DecodeGridDers with TMesh" << endl;
+            exit(1);
+#endif
+            const TensorProduct<T>& tensor = mfa_data.tmesh.tensor_prods[0];
+            int ncols = tensor.ctrl_pts.cols();
+            Param<T> full_params(ndom_pts, min_params, max_params);
+            auto& params = full_params.param_grid;
+
+            // spans and basis function derivatives at the grid lines
+            DersDecodeInfo<T>                       di(mfa_data, nders);
+            vector<vector<int>>                     spans(dom_dim);
+            vector<vector<vector<vector<T>>>>       DD(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                spans[k].resize(ndom_pts(k));
+                DD[k].resize(ndom_pts(k), di.D[k]);
+                for (auto i = 0; i < ndom_pts(k); i++)
+                {
+                    spans[k][i] = mfa_data.FindSpan(k, params[k][i], tensor);
+                    BasisFunsDers(k, params[k][i], spans[k][i], nders, DD[k][i], di.bfi);
+                }
+            }
+
+            VolIterator vol_it(ndom_pts);
+            result.resize(vol_it.tot_iters(), di.ders.size() * ncols);
+
+            // decodes grid point j using the precomputed basis functions
+            auto decode_pt = [&](size_t j, DersDecodeInfo<T>& di, VectorXi& ijk, MatrixX<T>& out)
+            {
+                vol_it.idx_ijk(j, ijk);
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    di.span[k]  = spans[k][ijk(k)];
+                    di.D[k]     = DD[k][ijk(k)];
+                }
+                ContractDers(di, tensor, out);
+                for (auto d = 0; d < out.rows(); d++)
+                    result.block(j, d * ncols, 1, ncols) = out.row(d);
+            };
+
+#ifdef MFA_TBB
+            enumerable_thread_specific<DersDecodeInfo<T>> thread_di(di);
+            parallel_for (blocked_range<size_t>(0, vol_it.tot_iters()), [&](blocked_range<size_t>& r)
+            {
+                VectorXi    ijk(dom_dim);
+                MatrixX<T>  out;
+                for (auto j = r.begin(); j < r.end(); j++)
+                    decode_pt(j, thread_di.local(), ijk, out);
+            });
+#endif
+#ifdef MFA_SERIAL
+            VectorXi    ijk(dom_dim);
+            MatrixX<T>  out;
+            for (auto j = 0; j < vol_it.tot_iters(); j++)
+                decode_pt(j, di, ijk, out);
+#endif
+        }
+
+        // basis functions and their derivatives up to order nders in one dim.
+        // only orders up to the degree are computed; higher derivatives are zero and D is sized to omit them
+        void BasisFunsDers(
+                int                     k,          // current dimension
+                T                       u,          // parameter value
+                int                     span,       // span containing u
+                int                     nders,      // max. derivative order
+                vector<vector<T>>&      D,          // (output) D[r][i] = r-th derivative of i-th nonzero basis function
+                BasisFunInfo<T>&        bfi) const  // scratch space
+        {
+            D.resize(std::min(nders, mfa_data.p(k)) + 1, vector<T>(mfa_data.p(k) + 1, 0.0));
+            mfa_data.FastBasisFunsDers(k, u, span, D.size() - 1, D, bfi);
+        }
+
+        // contracts the control points in the support of di.span with the basis function derivatives in di.D
+        void ContractDers(
+                DersDecodeInfo<T>&      di,         // decode info with spans and basis function derivatives filled
+                const TensorProduct<T>& tensor,     // tensor product to use for decoding
+                MatrixX<T>&             out) const  // (output) value and derivatives, di.ders.size() x ctrl_pts.cols()
+        {
+            int ncols = tensor.ctrl_pts.cols();
+#ifdef MFA_NO_WEIGHTS
+            int nw = 0;                                 // no column for weights
+#else
+            int nw = 1;                                 // last column holds the weights
+#endif
+
+            // gather the control points in the support, weighted, in the same order as FastVolPt (dim. 0 fastest)
+            int start_ctrl_idx = 0;
+            for (auto k = 0; k < dom_dim; k++)
+                start_ctrl_idx += (di.span[k] - mfa_data.p(k)) * cs[k];
+            di.P.resize(tot_iters, ncols + nw);
+            for (auto m = 0; m < tot_iters; m++)
+            {
+                int idx = start_ctrl_idx + jumps(m);
+                di.P.row(m).head(ncols) = tensor.ctrl_pts.row(idx);
+#ifndef MFA_NO_WEIGHTS
+                T w = tensor.weights(idx);
+#ifdef WEIGH_ALL_DIMS
+                di.P.row(m).head(ncols) *= w;
+#else
+                di.P(m, ncols - 1) *= w;
+#endif
+                di.P(m, ncols) = w;
+#endif
+            }
+
+            // contract dim. 0 once per derivative order
+            int n0 = tot_iters / q0;
+            for (auto r = 0; r < di.D[0].size(); r++)
+            {
+                di.t0[r].resize(n0, ncols + nw);
+                Eigen::Map<VectorX<T>> N(&di.D[0][r][0], q0);
+                for (auto c = 0; c < ncols + nw; c++)
+                    di.t0[r].col(c) = Eigen::Map<MatrixX<T>>(di.P.col(c).data(), q0, n0).transpose() * N;
+            }
+
+            // contract the remaining dims. for each derivative
+            di.A.resize(di.ders.size(), ncols + nw);
+            for (auto i = 0; i < di.ders.size(); i++)
+            {
+                const VectorXi& a = di.ders[i];
+                bool zero = false;
+                for (auto k = 0; k < dom_dim; k++)
+                    if (a(k) >= di.D[k].size())
+                        zero = true;
+                if (zero)
+                {
+                    di.A.row(i).setZero();
+                    continue;
+                }
+                const MatrixX<T>*   cur = &di.t0[a(0)];
+                MatrixX<T>*         next = &di.t1;
+                for (auto k = 1; k < dom_dim; k++)
+                {
+                    int n = cur->rows() / q[k];
+                    next->resize(n, ncols + nw);
+                    Eigen::Map<VectorX<T>> N(&di.D[k][a(k)][0], q[k]);
+                    for (auto c = 0; c < ncols + nw; c++)
+                        next->col(c) = Eigen::Map<const MatrixX<T>>(cur->col(c).data(), q[k], n).transpose() * N;
+                    cur     = next;
+                    next    = (next == &di.t1) ? &di.t2 : &di.t1;
+                }
+                di.A.row(i) = cur->row(0);
+            }
+
+#ifdef MFA_NO_WEIGHTS
+            out = di.A;
+#else
+            // quotient rule for the rational coordinates, in order of increasing total derivative order
+            out = di.A.leftCols(ncols);
+#ifdef WEIGH_ALL_DIMS
+            int first_rat = 0;
+#else
+            int first_rat = ncols - 1;
+#endif
+            T w0 = di.A(0, ncols);
+            for (auto i = 0; i < di.ders.size(); i++)
+                for (auto c = first_rat; c < ncols; c++)
+                {
+                    T v = di.A(i, c);
+                    for (auto j = 0; j < di.rat_coeffs[i].size(); j++)
+                        v -= di.rat_coeffs[i][j] * di.A(di.rat_terms[i][2 * j], ncols) * out(di.rat_terms[i][2 * j + 1], c);
+                    out(i, c) = v / w0;
+                }
+#endif
+        }
+
+        // Gauss-Legendre nodes and weights for n points on [0, 1]
+        // exact for polynomials of degree <= 2n - 1
+        static void GaussLegendre(
+                int                     n,          // number of points
+                vector<T>&              x,          // (output) nodes
+                vector<T>&              w)          // (output) weights
+        {
+            x.resize(n);
+            w.resize(n);
+            for (auto i = 0; i < (n + 1) / 2; i++)
+            {
+                // Newton iteration on the Legendre polynomial P_n, starting from the Chebyshev approximation
+                T z = cos(M_PI * (i + 0.75) / (n + 0.5));
+                T dp;
+                for (auto it = 0; it < 100; it++)
+                {
+                    T p0 = 1.0, p1 = 0.0;
+                    for (auto j = 1; j <= n; j++)
+                    {
+                        T p2 = p1;
+                        p1 = p0;
+                        p0 = ((2.0 * j - 1.0) * z * p1 - (j - 1.0) * p2) / j;
+                    }
+                    dp = n * (z * p0 - p1) / (z * z - 1.0);
+                    T dz = p0 / dp;
+                    z -= dz;
+                    if (fabs(dz) <= 1e-15)
+                        break;
+                }
+                x[i]            = 0.5 * (1.0 - z);
+                x[n - 1 - i]    = 0.5 * (1.0 + z);
+                w[i]            = 1.0 / ((1.0 - z * z) * dp * dp);
+                w[n - 1 - i]    = w[i];
+            }
+        }
+
+        // integrals of the basis functions in one dim. over [a, b]: w(i) = int_a^b N_i(u) du
+        // Gauss-Legendre quadrature with p + 1 points per knot span is exact, partial spans at the ends included
+        void BasisIntegrals(
+                int                     k,          // current dimension
+                T                       a,          // start of interval
+                T                       b,          // end of interval
+                VectorX<T>&             w) const    // (output) integrals, one per control point
+        {
+            int                 deg     = mfa_data.p(k);
+            const vector<T>&    knots   = mfa_data.tmesh.all_knots[k];
+            w = VectorX<T>::Zero(knots.size() - deg - 1);
+            if (b <= a)
+                return;
+
+            vector<T>           gx, gw;
+            GaussLegendre(deg + 1, gx, gw);
+            BasisFunInfo<T>     bfi(q);
+            vector<vector<T>>   D(1, vector<T>(deg + 1));
+
+            for (auto span = mfa_data.FindSpan(k, a); span <= mfa_data.FindSpan(k, b); span++)
+            {
+                T u0 = std::max(a, knots[span]);
+                T u1 = std::min(b, knots[span + 1]);
+                if (u1 <= u0)
+                    continue;
+                for (auto g = 0; g < gx.size(); g++)
+                {
+                    mfa_data.FastBasisFunsDers(k, u0 + gx[g] * (u1 - u0), span, 0, D, bfi);
+                    for (auto j = 0; j <= deg; j++)
+                        w(span - deg + j) += gw[g] * (u1 - u0) * D[0][j];
+                }
+            }
+        }
+
+        // integrals of products of pairs of basis functions in one dim. over [a, b]: G(i, j) = int_a^b N_i(u) N_j(u) du
+        // G is symmetric with bandwidth p
+        void BasisProductIntegrals(
+                int                     k,          // current dimension
+                T                       a,          // start of interval
+                T                       b,          // end of interval
+                SparseMatrixX<T>&       G) const    // (output) integrals, nctrl_pts x nctrl_pts
+        {
+            int                 deg     = mfa_data.p(k);
+            const vector<T>&    knots   = mfa_data.tmesh.all_knots[k];
+            int                 n       = knots.size() - deg - 1;
+            G.resize(n, n);
+            if (b <= a)
+                return;
+
+            vector<T>                       gx, gw;
+            GaussLegendre(deg + 1, gx, gw);
+            BasisFunInfo<T>                 bfi(q);
+            vector<vector<T>>               D(1, vector<T>(deg + 1));
+            vector<Eigen::Triplet<T>>       coeffs;
+
+            for (auto span = mfa_data.FindSpan(k, a); span <= mfa_data.FindSpan(k, b); span++)
+            {
+                T u0 = std::max(a, knots[span]);
+                T u1 = std::min(b, knots[span + 1]);
+                if (u1 <= u0)
+                    continue;
+                for (auto g = 0; g < gx.size(); g++)
+                {
+                    mfa_data.FastBasisFunsDers(k, u0 + gx[g] * (u1 - u0), span, 0, D, bfi);
+                    for (auto i = 0; i <= deg; i++)
+                        for (auto j = 0; j <= deg; j++)
+                            coeffs.push_back(Eigen::Triplet<T>(span - deg + i, span - deg + j,
+                                        gw[g] * (u1 - u0) * D[0][i] * D[0][j]));
+                }
+            }
+            G.setFromTriplets(coeffs.begin(), coeffs.end());    // duplicates are summed
+        }
+
+        // integral of the model, and optionally of its square, over a box in parameter space
+        // the integrand is a tensor product of 1-d B-splines, so the integral is a contraction of the control points
+        // with the 1-d basis integrals, and the integral of the square a quadratic form in the 1-d Gram matrices
+        // requires a single tensor product with unit weights
+        void Integrate(
+                const VectorX<T>&       box_min,        // minimum corner of box in parameter space
+                const VectorX<T>&       box_max,        // maximum corner of box in parameter space
+                VectorX<T>&             integral,       // (output) integral of each coordinate of the model
+                VectorX<T>*             sq_integral)    // (output, optional) integral of the square of each coordinate
+            const
+        {
+            if (mfa_data.tmesh.tensor_prods.size() != 1)
+            {
+                fprintf(stderr, "Error: Integrate() only implemented for a single tensor product\n");
+                exit(1);
+            }
+            const TensorProduct<T>& tensor = mfa_data.tmesh.tensor_prods[0];
+            if (tensor.weights.size() && (tensor.weights.array() != 1.0).any())
+            {
+                fprintf(stderr, "Error: Integrate() requires unit weights; the integral of a rational model has no closed form\n");
+                exit(1);
+            }
+
+            // clamp the box to the parameter domain
+            VectorX<T> a = box_min.cwiseMax(0.0).cwiseMin(1.0);
+            VectorX<T> b = box_max.cwiseMax(0.0).cwiseMin(1.0);
+
+            int ncols = tensor.ctrl_pts.cols();
+
+            // integral: contract one dim. at a time, dim. 0 is fastest in the control points
+            VectorX<T>  w;
+            MatrixX<T>  cur = tensor.ctrl_pts;
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                BasisIntegrals(k, a(k), b(k), w);
+                int n = w.size();
+                int m = cur.size() / n;
+                VectorX<T> next = Eigen::Map<const MatrixX<T>>(cur.data(), n, m).transpose() * w;
+                cur = Eigen::Map<MatrixX<T>>(next.data(), next.size(), 1);
+            }
+            integral = Eigen::Map<VectorX<T>>(cur.data(), ncols);
+
+            if (!sq_integral)
+                return;
+
+            // integral of the square: P^T (G_{d-1} x ... x G_0) P for each coordinate
+            // apply the Gram matrix of each dim. along that dim. of the control point grid
+            SparseMatrixX<T>    G;
+            MatrixX<T>          GP = tensor.ctrl_pts;
+            int                 stride = 1;             // product of numbers of control points in lower dims.
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                BasisProductIntegrals(k, a(k), b(k), G);
+                int n       = tensor.nctrl_pts(k);
+                int nouter  = GP.size() / (stride * n);
+                for (auto o = 0; o < nouter; o++)
+                {
+                    Eigen::Map<MatrixX<T>> slab(GP.data() + (size_t)o * stride * n, stride, n);
+                    MatrixX<T> res = slab * G;          // G is symmetric
+                    slab = res;
+                }
+                stride *= n;
+            }
+            sq_integral->resize(ncols);
+            for (auto c = 0; c < ncols; c++)
+                (*sq_integral)(c) = tensor.ctrl_pts.col(c).dot(GP.col(c));
+        }
+
+        // finds the critical points (zero gradient) of one coordinate of the model
+        // the derivative models in each dim. bound the gradient over each knot span by their control points;
+        // only spans where every partial derivative may vanish are searched, by Newton iterations on the
+        // gradient with the Hessian, started from the center of the span and the centers of its 2^d octants
+        // points are classified by the signs of the Hessian eigenvalues
+        // requires a single tensor product with unit weights (see the derivative MFA_Data constructor)
+        void CriticalPoints(
+                vector<CriticalPoint<T>>&   cps,                // (output) critical points, sorted by span
+                int                         col = -1,           // column of the control points (-1 = last, ie, the science variable)
+                int                         max_iters = 30,     // max. Newton iterations per start
+                T                           eig_tol = 1e-8)     // relative magnitude below which a Hessian eigenvalue is zero
+            const
+        {
+            const TensorProduct<T>& t = mfa_data.tmesh.tensor_prods[0];
+            if (col < 0)
+                col = t.ctrl_pts.cols() - 1;
+            cps.clear();
+
+            // spans where the bounds of all partial derivatives contain 0
+            map<vector<T>, int>         nzero;              // number of partials that may vanish, keyed by span min. corner
+            map<vector<T>, VectorX<T>>  span_maxs;
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                MFA_Data<T>         dk(mfa_data, k, 1);
+                SpanBoundsIndex<T>  index(dk, col);
+                vector<VectorX<T>>  box_mins, box_maxs;
+                index.RangeSpans(0.0, 0.0, box_mins, box_maxs);
+                for (auto i = 0; i < box_mins.size(); i++)
+                {
+                    vector<T> key(box_mins[i].data(), box_mins[i].data() + dom_dim);
+                    nzero[key]++;
+                    span_maxs[key] = box_maxs[i];
+                }
+            }
+            vector<VectorX<T>> cand_mins, cand_maxs;
+            for (auto& z : nzero)
+                if (z.second == dom_dim)
+                {
+                    cand_mins.push_back(Eigen::Map<const VectorX<T>>(&z.first[0], dom_dim));
+                    cand_maxs.push_back(span_maxs[z.first]);
+                }
+
+            // magnitude of the function, for judging the gradient at convergence
+            T grad_scale = t.ctrl_pts.col(col).maxCoeff() - t.ctrl_pts.col(col).minCoeff();
+            if (grad_scale == 0.0)
+                grad_scale = 1.0;
+
+            // Newton iterations in one span
+            auto search = [&](size_t s, DersDecodeInfo<T>& di, vector<CriticalPoint<T>>& local_cps)
+            {
+                const VectorX<T>&   lo      = cand_mins[s];
+                const VectorX<T>&   hi      = cand_maxs[s];
+                VectorX<T>          width   = hi - lo;
+                T                   diag    = width.norm();
+                VectorXi            two     = VectorXi::Constant(dom_dim, 2);
+                VectorX<T>          x(dom_dim), g(dom_dim);
+                MatrixX<T>          H(dom_dim, dom_dim), out;
+                vector<int>         grad_rows(dom_dim);
+                for (auto k = 0; k < dom_dim; k++)
+                    grad_rows[k] = di.row(VectorXi::Unit(dom_dim, k));
+                size_t first = local_cps.size();
+
+                for (auto seed = -1; seed < (1 << dom_dim); seed++)
+                {
+                    for (auto k = 0; k < dom_dim; k++)      // seed -1 is the center, others are octant centers
+                        x(k) = lo(k) + width(k) * (seed < 0 ? 0.5 : ((seed >> k) & 1 ? 0.75 : 0.25));
+
+                    bool converged = false;
+                    for (auto it = 0; it < max_iters; it++)
+                    {
+                        VolPtDers(x, di, t, out);
+                        for (auto k = 0; k < dom_dim; k++)
+                        {
+                            g(k) = out(grad_rows[k], col);
+                            for (auto l = 0; l < dom_dim; l++)
+                                H(k, l) = out(di.hess_row(k, l), col);
+                        }
+                        VectorX<T> step = H.fullPivLu().solve(g);
+                        if (!step.allFinite())
+                            break;
+                        x -= step;
+                        x = x.cwiseMax(0.0).cwiseMin(1.0);
+
+                        // stop if the iterate wanders far from the span; another span will find that point
+                        if (((x - lo).array() < -0.5 * width.array()).any() || ((x - hi).array() > 0.5 * width.array()).any())
+                            break;
+                        if (step.norm() <= 1e-12 * diag)
+                        {
+                            converged = true;
+                            break;
+                        }
+                    }
+                    if (!converged)
+                        continue;
+
+                    // keep points in the half-open span (closed at the end of the domain) so that neighbors do not repeat them
+                    bool inside = true;
+                    for (auto k = 0; k < dom_dim; k++)
+                        if (x(k) < lo(k) || x(k) > hi(k) || (x(k) == hi(k) && hi(k) < 1.0))
+                            inside = false;
+                    if (!inside)
+                        continue;
+                    bool dup = false;
+                    for (auto i = first; i < local_cps.size(); i++)
+                        if ((local_cps[i].param - x).norm() <= 1e-8 * diag)
+                            dup = true;
+                    if (dup)
+                        continue;
+
+                    // reject points where a singular Hessian stalled the iterations short of a zero gradient
+                    VolPtDers(x, di, t, out);
+                    for (auto k = 0; k < dom_dim; k++)
+                        g(k) = out(grad_rows[k], col);
+                    if (g.norm() > 1e-8 * grad_scale / width.minCoeff())
+                        continue;
+
+                    // classify
+                    for (auto k = 0; k < dom_dim; k++)
+                        for (auto l = 0; l < dom_dim; l++)
+                            H(k, l) = out(di.hess_row(k, l), col);
+                    Eigen::SelfAdjointEigenSolver<MatrixX<T>> eig(H, Eigen::EigenvaluesOnly);
+                    const VectorX<T>& lambda = eig.eigenvalues();
+                    T   scale   = lambda.cwiseAbs().maxCoeff();
+                    int nneg    = 0, npos = 0;
+                    for (auto k = 0; k < dom_dim; k++)
+                    {
+                        if (lambda(k) < -eig_tol * scale)
+                            nneg++;
+                        else if (lambda(k) > eig_tol * scale)
+                            npos++;
+                    }
+                    CriticalPoint<T> cp;
+                    cp.param    = x;
+                    cp.value    = out(0, col);
+                    cp.index    = nneg;
+                    if (nneg + npos < dom_dim || scale == 0.0)
+                        cp.type = CP_DEGENERATE;
+                    else
+                        cp.type = nneg == 0 ? CP_MIN : (npos == 0 ? CP_MAX : CP_SADDLE);
+                    local_cps.push_back(cp);
+                }
+            };
+
+#ifdef MFA_TBB
+            enumerable_thread_specific<DersDecodeInfo<T>> thread_ders_info([&]()
+                    { return DersDecodeInfo<T>(mfa_data, 2); });
+            vector<vector<CriticalPoint<T>>> span_cps(cand_mins.size());
+            parallel_for (size_t(0), cand_mins.size(), [&] (size_t s)
+            {
+                search(s, thread_ders_info.local(), span_cps[s]);
+            });
+            for (auto& sc : span_cps)
+                cps.insert(cps.end(), sc.begin(), sc.end());
+#endif
+#ifdef MFA_SERIAL
+            DersDecodeInfo<T> di(mfa_data, 2);
+            for (auto s = 0; s < cand_mins.size(); s++)
+                search(s, di, cps);
+#endif
+            if (verbose)
+                fprintf(stderr, "CriticalPoints(): %lu candidate spans, %lu critical points\n", cand_mins.size(), cps.size());
+        }
+
         // compute a point from a NURBS curve at a given parameter value
         // this version takes a temporary set of control points for one curve only rather than
         // reading full n-d set of control points from the mfa
@@ -1492,6 +2339,485 @@ exit(1);
         }
 
     };
+
+    // hierarchical min/max bounds over the knot spans of a model
+    // by the convex hull property (positive weights), the p+1 control points in each dim. supporting a knot span
+    // bound the model over the span; a k-d tree over the spans, whose nodes hold the bounds of their subtrees,
+    // answers range, threshold, and global min/max queries by pruning whole subtrees and decoding only the candidates
+    // only for a single tensor product; call Rebuild() after the control points change
+    template <typename T>                                   // float or double
+    class SpanBoundsIndex
+    {
+        struct Node
+        {
+            long            left;                           // index of left child in nodes_, -1 for a leaf
+            long            right;                          // index of right child in nodes_, -1 for a leaf
+            T               min;                            // lower bound of the model over the node
+            T               max;                            // upper bound of the model over the node
+        };
+
+        const MFA_Data<T>&  mfa_data;                       // the mfa data model
+        int                 dom_dim;
+        int                 col_;                           // column of the control points to bound
+        vector<vector<int>> spans_;                         // knot spans of nonzero length in each dim.
+        VectorXi            nspans_;                        // number of nonzero spans in each dim.
+        vector<vector<int>> ord_of_span_;                   // ordinal of each nonzero knot span in each dim., -1 for empty spans
+        vector<T>           span_min_;                      // lower bound of each span, flattened (dim. 0 fastest)
+        vector<T>           span_max_;                      // upper bound of each span
+        vector<Node>        nodes_;                         // tree nodes, root is nodes_[0]
+        vector<int>         node_lo_;                       // first span ordinal of node in each dim. [node * dom_dim + k]
+        vector<int>         node_hi_;                       // one past the last span ordinal of node in each dim.
+
+        // sliding window min or max of width w along dim. k of a flattened grid with sizes n, shrinks dim. k by w - 1
+        void window(vector<T>&      a,
+                    VectorXi&       n,
+                    int             k,
+                    int             w,
+                    bool            take_min) const
+        {
+            size_t stride = 1;
+            for (auto j = 0; j < k; j++)
+                stride *= n(j);
+            size_t nouter = a.size() / (stride * n(k));
+            int    nk     = n(k) - w + 1;
+            vector<T> b(stride * nk * nouter);
+            for (size_t o = 0; o < nouter; o++)
+                for (auto i = 0; i < nk; i++)
+                    for (size_t s = 0; s < stride; s++)
+                    {
+                        const T* src = &a[(o * n(k) + i) * stride + s];
+                        T v = src[0];
+                        for (auto j = 1; j < w; j++)
+                            v = take_min ? std::min(v, src[j * stride]) : std::max(v, src[j * stride]);
+                        b[(o * nk + i) * stride + s] = v;
+                    }
+            a.swap(b);
+            n(k) = nk;
+        }
+
+        // recursively builds the subtree over a box of span ordinals, returns node index
+        long build(vector<int>& lo, vector<int>& hi)
+        {
+            long n = nodes_.size();
+            nodes_.push_back(Node{-1, -1, 0.0, 0.0});
+            node_lo_.insert(node_lo_.end(), lo.begin(), lo.end());
+            node_hi_.insert(node_hi_.end(), hi.begin(), hi.end());
+
+            int split_dim = 0;
+            for (auto k = 1; k < dom_dim; k++)
+                if (hi[k] - lo[k] > hi[split_dim] - lo[split_dim])
+                    split_dim = k;
+
+            if (hi[split_dim] - lo[split_dim] == 1)                 // leaf: one span
+            {
+                size_t idx = span_idx(lo);
+                nodes_[n].min = span_min_[idx];
+                nodes_[n].max = span_max_[idx];
+                return n;
+            }
+
+            int mid     = (lo[split_dim] + hi[split_dim]) / 2;
+            int save    = hi[split_dim];
+            hi[split_dim] = mid;
+            long left   = build(lo, hi);
+            hi[split_dim] = save;
+            save        = lo[split_dim];
+            lo[split_dim] = mid;
+            long right  = build(lo, hi);
+            lo[split_dim] = save;
+
+            nodes_[n].left  = left;
+            nodes_[n].right = right;
+            nodes_[n].min   = std::min(nodes_[left].min, nodes_[right].min);
+            nodes_[n].max   = std::max(nodes_[left].max, nodes_[right].max);
+            return n;
+        }
+
+        // flattened index of a vector of span ordinals
+        size_t span_idx(const vector<int>& ord) const
+        {
+            size_t idx = 0, stride = 1;
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                idx    += ord[k] * stride;
+                stride *= nspans_(k);
+            }
+            return idx;
+        }
+
+        // leaves whose bounds overlap [a, b]; inside[i] = 1 if the bounds of leaves[i] are entirely within [a, b]
+        void candidates(T               a,
+                        T               b,
+                        vector<long>&   leaves,
+                        vector<char>&   inside) const
+        {
+            leaves.clear();
+            inside.clear();
+            if (nodes_.empty())
+                return;
+            vector<long> stack(1, 0);
+            while (stack.size())
+            {
+                long n = stack.back();
+                stack.pop_back();
+                const Node& node = nodes_[n];
+                if (node.max < a || node.min > b)
+                    continue;
+                if (node.left < 0)
+                {
+                    leaves.push_back(n);
+                    inside.push_back(node.min >= a && node.max <= b);
+                }
+                else
+                {
+                    stack.push_back(node.left);
+                    stack.push_back(node.right);
+                }
+            }
+        }
+
+    public:
+
+        SpanBoundsIndex(
+                const MFA_Data<T>&  mfa_data_,              // MFA data model
+                int                 col = -1) :             // column of control points to bound (-1 = last, ie, the science variable)
+            mfa_data(mfa_data_),
+            dom_dim(mfa_data_.dom_dim),
+            col_(col)
+        {
+            Rebuild();
+        }
+
+        // recomputes the span bounds and the tree from the current control points
+        void Rebuild()
+        {
+            if (mfa_data.tmesh.tensor_prods.size() != 1)
+            {
+                fprintf(stderr, "Error: SpanBoundsIndex only implemented for a single tensor product\n");
+                exit(1);
+            }
+            const TensorProduct<T>& t = mfa_data.tmesh.tensor_prods[0];
+            int col = col_ < 0 ? t.ctrl_pts.cols() - 1 : col_;
+
+            // nonzero knot spans
+            spans_.resize(dom_dim);
+            ord_of_span_.resize(dom_dim);
+            nspans_.resize(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                const vector<T>& knots = mfa_data.tmesh.all_knots[k];
+                spans_[k].clear();
+                ord_of_span_[k].assign(knots.size(), -1);
+                for (auto s = mfa_data.p(k); s < t.nctrl_pts(k); s++)
+                    if (knots[s] < knots[s + 1])
+                    {
+                        ord_of_span_[k][s] = spans_[k].size();
+                        spans_[k].push_back(s);
+                    }
+                nspans_(k) = spans_[k].size();
+            }
+
+            // bounds of all spans s, s = p, ..., nctrl_pts - 1, from the control points s - p, ..., s in each dim.
+            vector<T> all_min(t.ctrl_pts.col(col).data(), t.ctrl_pts.col(col).data() + t.ctrl_pts.rows());
+            vector<T> all_max(all_min);
+            VectorXi  n_min = t.nctrl_pts, n_max = t.nctrl_pts;
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                window(all_min, n_min, k, mfa_data.p(k) + 1, true);
+                window(all_max, n_max, k, mfa_data.p(k) + 1, false);
+            }
+
+            // keep the nonzero spans
+            span_min_.resize(nspans_.prod());
+            span_max_.resize(nspans_.prod());
+            VolIterator vol_iter(nspans_);
+            VectorXi    ord(dom_dim);
+            while (!vol_iter.done())
+            {
+                vol_iter.idx_ijk(vol_iter.cur_iter(), ord);
+                size_t idx = 0, stride = 1;
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    idx    += (spans_[k][ord(k)] - mfa_data.p(k)) * stride;
+                    stride *= n_min(k);
+                }
+                span_min_[vol_iter.cur_iter()] = all_min[idx];
+                span_max_[vol_iter.cur_iter()] = all_max[idx];
+                vol_iter.incr_iter();
+            }
+
+            nodes_.clear();
+            node_lo_.clear();
+            node_hi_.clear();
+            vector<int> lo(dom_dim, 0), hi(nspans_.data(), nspans_.data() + dom_dim);
+            build(lo, hi);
+        }
+
+        // bounds of the model over the whole domain, without decoding
+        void Bounds(T& min, T& max) const
+        {
+            min = nodes_[0].min;
+            max = nodes_[0].max;
+        }
+
+        // bounds of the model over one nonempty knot span, given by its knot index in each dim. (eg. from FindSpan)
+        void SpanBounds(const VectorXi&     span,
+                        T&                  min,
+                        T&                  max) const
+        {
+            vector<int> ord(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+                ord[k] = ord_of_span_[k][span(k)];
+            size_t idx = span_idx(ord);
+            min = span_min_[idx];
+            max = span_max_[idx];
+        }
+
+        // parameter space box of the knot spans of a node
+        void NodeBox(long               n,
+                     VectorX<T>&        box_min,
+                     VectorX<T>&        box_max) const
+        {
+            box_min.resize(dom_dim);
+            box_max.resize(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                box_min(k) = mfa_data.tmesh.all_knots[k][spans_[k][node_lo_[n * dom_dim + k]]];
+                box_max(k) = mfa_data.tmesh.all_knots[k][spans_[k][node_hi_[n * dom_dim + k] - 1] + 1];
+            }
+        }
+
+        // parameter space boxes of the knot spans where the model may take values in [a, b]
+        // the union of the boxes contains the set where the model is in [a, b]
+        void RangeSpans(T                       a,
+                        T                       b,
+                        vector<VectorX<T>>&     box_mins,   // (output) minimum corners of the spans
+                        vector<VectorX<T>>&     box_maxs)   // (output) maximum corners of the spans
+            const
+        {
+            vector<long> leaves;
+            vector<char> inside;
+            candidates(a, b, leaves, inside);
+            box_mins.resize(leaves.size());
+            box_maxs.resize(leaves.size());
+            for (auto i = 0; i < leaves.size(); i++)
+                NodeBox(leaves[i], box_mins[i], box_maxs[i]);
+        }
+
+        // indices (dim. 0 fastest, sorted) of the points of a regular grid in parameter space where the model is in [a, b]
+        // spans whose bounds are outside [a, b] are skipped, spans whose bounds are inside are accepted without
+        // decoding, and only the grid points in the remaining spans are decoded
+        // returns the number of decoded points
+        size_t RangeGrid(T                      a,
+                         T                      b,
+                         const VectorX<T>&      par_min,    // lower corner of grid in param space
+                         const VectorX<T>&      par_max,    // upper corner of grid in param space
+                         const VectorXi&        ndom_pts,   // number of grid points in each dim.
+                         vector<size_t>&        idxs)       // (output) grid indices of points in [a, b]
+            const
+        {
+            idxs.clear();
+            const TensorProduct<T>& t = mfa_data.tmesh.tensor_prods[0];
+            int col = col_ < 0 ? t.ctrl_pts.cols() - 1 : col_;
+
+            // grid parameters and the first grid point in each span ordinal (plus one past the end) in each dim.
+            vector<vector<T>>       params(dom_dim);
+            vector<vector<size_t>>  first(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                params[k].resize(ndom_pts(k));
+                for (auto i = 0; i < ndom_pts(k); i++)
+                    params[k][i] = ndom_pts(k) > 1 ?
+                        par_min(k) + i * (par_max(k) - par_min(k)) / (ndom_pts(k) - 1) : par_min(k);
+                first[k].assign(nspans_(k) + 1, 0);
+                for (auto i = 0; i < ndom_pts(k); i++)
+                    first[k][ord_of_span_[k][mfa_data.FindSpan(k, params[k][i])] + 1]++;
+                for (auto o = 0; o < nspans_(k); o++)
+                    first[k][o + 1] += first[k][o];
+            }
+
+            vector<long> leaves;
+            vector<char> inside;
+            candidates(a, b, leaves, inside);
+
+            Decoder<T> decoder(mfa_data, 0);
+            VectorXi   no_derivs;
+
+            // visits the grid points of one leaf, decoding them unless the leaf is inside [a, b]
+            auto visit = [&](size_t                 i,
+                             DecodeInfo<T>&         di,
+                             vector<size_t>&        local_idxs,
+                             size_t&                ndecoded)
+            {
+                long        n = leaves[i];
+                VectorXi    lo(dom_dim), npts(dom_dim);
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    int o   = node_lo_[n * dom_dim + k];
+                    lo(k)   = first[k][o];
+                    npts(k) = first[k][o + 1] - first[k][o];
+                }
+                if (npts.prod() == 0)
+                    return;
+                VectorX<T>  param(dom_dim);
+                VectorX<T>  cpt(t.ctrl_pts.cols());
+                VolIterator vol_iter(npts);
+                while (!vol_iter.done())
+                {
+                    size_t idx = 0, stride = 1;
+                    for (auto k = 0; k < dom_dim; k++)
+                    {
+                        int j    = lo(k) + vol_iter.idx_dim(k);
+                        param(k) = params[k][j];
+                        idx     += j * stride;
+                        stride  *= ndom_pts(k);
+                    }
+                    bool in = inside[i];
+                    if (!in)
+                    {
+                        decoder.VolPt(param, cpt, di, t, no_derivs);
+                        ndecoded++;
+                        in = cpt(col) >= a && cpt(col) <= b;
+                    }
+                    if (in)
+                        local_idxs.push_back(idx);
+                    vol_iter.incr_iter();
+                }
+            };
+
+            size_t ndecoded = 0;
+
+#ifdef MFA_TBB
+            enumerable_thread_specific<DecodeInfo<T>>   thread_decode_info([&]()
+                    { return DecodeInfo<T>(mfa_data, no_derivs); });
+            enumerable_thread_specific<vector<size_t>>  thread_idxs;
+            enumerable_thread_specific<size_t>          thread_ndecoded(0);
+            parallel_for (blocked_range<size_t>(0, leaves.size()), [&](blocked_range<size_t>& r)
+            {
+                for (auto i = r.begin(); i < r.end(); i++)
+                    visit(i, thread_decode_info.local(), thread_idxs.local(), thread_ndecoded.local());
+            });
+            for (auto& local_idxs : thread_idxs)
+                idxs.insert(idxs.end(), local_idxs.begin(), local_idxs.end());
+            for (auto& n : thread_ndecoded)
+                ndecoded += n;
+#endif
+#ifdef MFA_SERIAL
+            DecodeInfo<T> di(mfa_data, no_derivs);
+            for (auto i = 0; i < leaves.size(); i++)
+                visit(i, di, idxs, ndecoded);
+#endif
+
+            sort(idxs.begin(), idxs.end());
+            return ndecoded;
+        }
+
+        // points of a regular grid where the model is above (or below) a threshold
+        size_t ThresholdGrid(T                  threshold,
+                             bool               above,      // select points >= threshold (true) or <= threshold (false)
+                             const VectorX<T>&  par_min,    // lower corner of grid in param space
+                             const VectorX<T>&  par_max,    // upper corner of grid in param space
+                             const VectorXi&    ndom_pts,   // number of grid points in each dim.
+                             vector<size_t>&    idxs)       // (output) grid indices of selected points
+            const
+        {
+            T inf = numeric_limits<T>::max();
+            return above ? RangeGrid(threshold, inf, par_min, par_max, ndom_pts, idxs) :
+                           RangeGrid(-inf, threshold, par_min, par_max, ndom_pts, idxs);
+        }
+
+        // global minimum and maximum of the model by branch and bound over the tree
+        // each visited span is sampled on a grid of p + 2 points per dim.; subtrees whose bounds cannot improve
+        // the current extrema by more than tol are pruned
+        // min_bound and max_bound are certified bounds, ie, the true extrema are in [min_bound, min] and [max, max_bound]
+        void MinMax(T&              min,            // (output) smallest value found
+                    T&              max,            // (output) largest value found
+                    VectorX<T>&     arg_min,        // (output) parameters of min
+                    VectorX<T>&     arg_max,        // (output) parameters of max
+                    T&              min_bound,      // (output) lower bound on the true minimum
+                    T&              max_bound,      // (output) upper bound on the true maximum
+                    T               tol = 0.0)      // absolute tolerance for pruning
+            const
+        {
+            const TensorProduct<T>& t = mfa_data.tmesh.tensor_prods[0];
+            int col = col_ < 0 ? t.ctrl_pts.cols() - 1 : col_;
+
+            Decoder<T>      decoder(mfa_data, 0);
+            VectorXi        no_derivs;
+            DecodeInfo<T>   di(mfa_data, no_derivs);
+            VectorX<T>      param(dom_dim), cpt(t.ctrl_pts.cols());
+            VectorX<T>      box_min, box_max;
+
+            min = numeric_limits<T>::max();
+            max = -numeric_limits<T>::max();
+            arg_min.resize(dom_dim);
+            arg_max.resize(dom_dim);
+            min_bound = min;
+            max_bound = max;
+
+            // samples a leaf span and updates the extrema
+            auto sample = [&](long n)
+            {
+                NodeBox(n, box_min, box_max);
+                VectorXi npts = mfa_data.p + VectorXi::Constant(dom_dim, 2);
+                VolIterator vol_iter(npts);
+                while (!vol_iter.done())
+                {
+                    for (auto k = 0; k < dom_dim; k++)
+                        param(k) = box_min(k) + vol_iter.idx_dim(k) * (box_max(k) - box_min(k)) / (npts(k) - 1);
+                    decoder.VolPt(param, cpt, di, t, no_derivs);
+                    if (cpt(col) < min)
+                    {
+                        min     = cpt(col);
+                        arg_min = param;
+                    }
+                    if (cpt(col) > max)
+                    {
+                        max     = cpt(col);
+                        arg_max = param;
+                    }
+                    vol_iter.incr_iter();
+                }
+            };
+
+            // best-first search, once for the minimum and once for the maximum
+            for (auto pass = 0; pass < 2; pass++)
+            {
+                bool    lo      = pass == 0;
+                T       bound   = lo ? numeric_limits<T>::max() : -numeric_limits<T>::max();   // bound over pruned and sampled leaves
+                auto    key     = [&](long n) { return lo ? nodes_[n].min : -nodes_[n].max; };
+                auto    cmp     = [&](long a, long b) { return key(a) > key(b); };
+                std::priority_queue<long, vector<long>, decltype(cmp)> queue(cmp);
+                queue.push(0);
+                while (!queue.empty())
+                {
+                    long n = queue.top();
+                    queue.pop();
+                    const Node& node = nodes_[n];
+                    if (lo ? node.min >= min - tol : node.max <= max + tol)
+                    {
+                        // remaining nodes cannot improve; their bound is no better than this one
+                        bound = lo ? std::min(bound, node.min) : std::max(bound, node.max);
+                        break;
+                    }
+                    if (node.left < 0)
+                    {
+                        sample(n);
+                        bound = lo ? std::min(bound, node.min) : std::max(bound, node.max);
+                    }
+                    else
+                    {
+                        queue.push(node.left);
+                        queue.push(node.right);
+                    }
+                }
+                if (lo)
+                    min_bound = std::min(bound, min);
+                else
+                    max_bound = std::max(bound, max);
+            }
+        }
+    };
 }
 
 #endif
@@ -16,6 +16,8 @@
 
 #include    <vector>
 #include    <set>
+#include    <map>
+#include    <algorithm>
 #include    <iostream>
 
 // temporary utilities for testing
@@ -63,6 +65,29 @@ namespace mfa
         const PointSet<T>&  input;                          // input points
         size_t              max_num_curves;                 // max num. curves per dimension to check in curve version
 
+#ifdef MFA_TMESH
+
+        // cached sparse matrices and factorization of the local solve for one tensor product
+        // valid as long as the knots, the input points covered by the tensor, and the constraint anchors are unchanged,
+        // in which case only the right hand side needs to be recomputed
+        struct LocalSolveCache
+        {
+            vector<KnotIdx>                             knot_mins;          // tensor knot mins when cached
+            vector<KnotIdx>                             knot_maxs;          // tensor knot maxs when cached
+            VectorXi                                    ndom_pts;           // number of relevant input points in each dim
+            VectorXi                                    dom_starts;         // starting offsets of relevant input points in each dim
+            vector<vector<KnotIdx>>                     anchors;            // anchors of constraint control points
+            vector<TensorIdx>                           t_idx_anchors;      // tensors containing corresponding anchors
+            SparseMatrixX<T>                            Nfree;              // normalized free control point basis functions
+            SparseMatrixX<T>                            Ncons;              // normalized constraint control point basis functions
+            Eigen::SimplicialLDLT<SparseMatrixX<T>>     solver;             // sparse Cholesky factorization of Nfree^T * Nfree
+        };
+
+        map<TensorIdx, LocalSolveCache> local_solve_cache;  // cached local solves, by tensor index
+        vector<size_t>                  local_solve_nknots; // number of knots in each dim when the cache was filled
+
+#endif
+
     public:
 
         Encoder(
@@ -577,166 +602,153 @@ namespace mfa
 
 #ifdef MFA_TMESH
 
-        // free control points matrix of basis functions
-        // helper function for EncodeTensorLocalLinear
-        // returns max number of nonzeros in any column
-        int  FreeCtrlPtMat(TensorIdx            t_idx,              // index of tensor of control points
-                           VectorXi&            ndom_pts,           // number of relevant input points in each dim
-                           VectorXi&            dom_starts,         // starting offsets of relevant input points in each dim
-                           MatrixX<T>&          Nfree)              // (output) matrix of free control points basis functions
+        // whether a cached local solve matches the current tensor, input points, and constraints
+        bool LocalSolveCacheValid(
+                const LocalSolveCache&          cache,                  // cached local solve
+                const TensorProduct<T>&         t,                      // current tensor product
+                const VectorXi&                 ndom_pts,               // number of relevant input points in each dim
+                const VectorXi&                 dom_starts,             // starting offsets of relevant input points in each dim
+                const vector<vector<KnotIdx>>&  anchors,                // anchors of constraint control points
+                const vector<TensorIdx>&        t_idx_anchors)          // tensors containing corresponding anchors
         {
-            TensorProduct<T>&   t = mfa_data.tmesh.tensor_prods[t_idx];
-            vector<KnotIdx>     anchor(mfa_data.dom_dim);                                       // control point anchor
-            Nfree = MatrixX<T>::Zero(ndom_pts.prod(), t.ctrl_pts.rows());
-            int max_nnz_col = 0;                                                                // max num nonzeros in any column
+            return cache.knot_mins          == t.knot_mins          &&
+                   cache.knot_maxs          == t.knot_maxs          &&
+                   cache.ndom_pts.size()    == ndom_pts.size()      &&
+                   cache.ndom_pts           == ndom_pts             &&
+                   cache.dom_starts         == dom_starts           &&
+                   cache.anchors            == anchors              &&
+                   cache.t_idx_anchors      == t_idx_anchors        &&
+                   cache.Nfree.cols()       == t.nctrl_pts.prod();
+        }
 
-            // debug
-            fmt::print(stderr, "Nfree has {} rows and {} columns\n", Nfree.rows(), Nfree.cols());
+        // drop all cached local solves
+        void ClearLocalSolveCache()
+        {
+            local_solve_cache.clear();
+            local_solve_nknots.clear();
+        }
+
+        // nonzero basis function values of one control point at the relevant input points
+        // helper function for FreeCtrlPtMat and ConsCtrlPtMat
+        // only visits the input points inside the support of the basis function
+        // appends (row, col, value) triplets and accumulates row sums for normalization
+        void SupportTriplets(
+                const vector<vector<T>>&    local_knots,            // local knot vector in each dim in parameter space
+                int                         col,                    // column of the control point
+                const VectorXi&             ndom_pts,               // number of relevant input points in each dim
+                const VectorXi&             dom_starts,             // starting offsets of relevant input points in each dim
+                vector<vector<T>>&          B,                      // (scratch) 1-d basis functions in each dim
+                vector<SpMatTriplet<T>>&    coeffs,                 // (output) nonzero basis functions, appended
+                VectorX<T>&                 row_sums)               // (output) row sums of basis functions, accumulated
+        {
+            VectorXi supp_starts(mfa_data.dom_dim);                 // first input point in support, relative to dom_starts
+            VectorXi supp_npts(mfa_data.dom_dim);                   // number of input points in support
 
-            // local knot vector
-            vector<vector<KnotIdx>> local_knot_idxs(mfa_data.dom_dim);                          // local knot indices
-            vector<vector<T>> local_knots(mfa_data.dom_dim);                                    // local knot vector for current dim in parameter space
             for (auto k = 0; k < mfa_data.dom_dim; k++)
             {
-                local_knot_idxs[k].resize(mfa_data.p(k) + 2);
-                local_knots[k].resize(mfa_data.p(k) + 2);
+                const vector<T>& params = input.params->param_grid[k];
+                auto first  = params.begin() + dom_starts(k);
+                auto last   = first + ndom_pts(k);
+                auto lo     = std::lower_bound(first, last, local_knots[k].front());
+                auto hi     = std::upper_bound(lo, last, local_knots[k].back());
+                supp_starts(k)  = lo - first;
+                supp_npts(k)    = hi - lo;
+                if (supp_npts(k) == 0)                              // no input points in support
+                    return;
+
+                B[k].resize(supp_npts(k));
+                for (auto i = 0; i < supp_npts(k); i++)
+                    B[k][i] = mfa_data.OneBasisFun(k, *(lo + i), local_knots[k]);
             }
 
-#ifdef MFA_TBB  // TBB
-
-            VolIterator dom_iter(ndom_pts, dom_starts, input.ndom_pts); // iterator over input points
-            VolIterator free_iter(t.nctrl_pts);                         // iterator over free control points
-
-            enumerable_thread_specific<vector<vector<KnotIdx>>> thread_local_knot_idxs(mfa_data.dom_dim);   // local knot idices
-            enumerable_thread_specific<vector<vector<T>>>       thread_local_knots(mfa_data.dom_dim);       // local knot idices
-            enumerable_thread_specific<VectorXi>                thread_dom_ijk(mfa_data.dom_dim);           // multidim index of domain point
-            enumerable_thread_specific<VectorXi>                thread_free_ijk(mfa_data.dom_dim);          // multidim index of control point
-            enumerable_thread_specific<vector<KnotIdx>>         thread_anchor(mfa_data.dom_dim);            // anchor of control point
-            enumerable_thread_specific<vector<int>>             thread_nnz_col(Nfree.cols(), 0);            // number of nonzeros in each column
-            static affinity_partitioner                         ap;
-            parallel_for (blocked_range2d<size_t>(0, dom_iter.tot_iters(), 0, free_iter.tot_iters()), [&] (blocked_range2d<size_t>& r)
+            VolIterator supp_iter(supp_npts, supp_starts, ndom_pts);
+            while (!supp_iter.done())
             {
-                for (auto i = r.cols().begin(); i < r.cols().end(); i++)                                // for control points
-                {
-                    if (i == r.cols().begin())
-                    {
-                        for (auto k = 0; k < mfa_data.dom_dim; k++)
-                        {
-                            thread_local_knot_idxs.local()[k].resize(mfa_data.p(k) + 2);
-                            thread_local_knots.local()[k].resize(mfa_data.p(k) + 2);
-                        }
-                    }
-
-                    free_iter.idx_ijk(i, thread_free_ijk.local());                                      // ijk of domain point
-                    mfa_data.tmesh.ctrl_pt_anchor(t, thread_free_ijk.local(), thread_anchor.local());   // anchor of control point
-
-                    // local knot vector
-                    mfa_data.tmesh.knot_intersections(thread_anchor.local(), t_idx, true, thread_local_knot_idxs.local());
-                    for (auto k = 0; k < mfa_data.dom_dim; k++)
-                    {
-                        for (auto n = 0; n < thread_local_knot_idxs.local()[k].size(); n++)
-                            thread_local_knots.local()[k][n] = mfa_data.tmesh.all_knots[k][thread_local_knot_idxs.local()[k][n]];
-                    }
-
-                    for (auto j = r.rows().begin(); j < r.rows().end(); j++)                            // for input domain points
-                    {
-                        dom_iter.idx_ijk(j, thread_dom_ijk.local());                                    // ijk of domain point
-                        for (auto k = 0; k < mfa_data.dom_dim; k++)
-                        {
-                            T u = input.params->param_grid[k][thread_dom_ijk.local()(k)];               // parameter of current input point
-                            T B = mfa_data.OneBasisFun(k, u, thread_local_knots.local()[k]);                           // basis function
-                            Nfree(j, i) = (k == 0 ? B : Nfree(j, i) * B);
-                        }
-                        if (Nfree(j, i) != 0.0)
-                            thread_nnz_col.local()[i]++;
-                    }       // for blocked range rows, ie, input domain points
-                }       // for blocked range cols, ie, control points
-            }, ap); // parallel for
-
-            // combine thread-safe nnz_col
-            vector<int> nnz_col(Nfree.cols(), 0);       // nonzeros in each column of Nfree, summed from threads
-            thread_nnz_col.combine_each([&](const vector<int>& nnzs)
-            {
-                for (auto i = 0; i < Nfree.cols(); i++)
+                T v = 1.0;
+                for (auto k = 0; k < mfa_data.dom_dim; k++)
+                    v *= B[k][supp_iter.idx_dim(k) - supp_starts(k)];
+                if (v != 0.0)
                 {
-                    nnz_col[i]  += nnzs[i];
-                    if (nnz_col[i] > max_nnz_col)
-                        max_nnz_col = nnz_col[i];
+                    size_t row = supp_iter.cur_iter_full();
+                    coeffs.push_back(SpMatTriplet<T>(row, col, v));
+                    row_sums(row) += v;
                 }
-            });
-
-#else           // serial
+                supp_iter.incr_iter();
+            }
+        }
 
-            VolIterator free_iter(t.nctrl_pts);                         // iterator over free control points
-            while (!free_iter.done())
-            {
-                VectorXi ijk(mfa_data.dom_dim);                                                 // ijk of current control point
-                free_iter.idx_ijk(free_iter.cur_iter(), ijk);
+        // free control points matrix of basis functions
+        // helper function for EncodeTensorLocalLinear
+        // fills nonzero triplets directly, skipping any dense matrix
+        void FreeCtrlPtMat(TensorIdx                    t_idx,              // index of tensor of control points
+                           const VectorXi&              ndom_pts,           // number of relevant input points in each dim
+                           const VectorXi&              dom_starts,         // starting offsets of relevant input points in each dim
+                           vector<SpMatTriplet<T>>&     coeffs,             // (output) nonzero basis functions
+                           VectorX<T>&                  row_sums)           // (output) row sums of basis functions, accumulated
+        {
+            TensorProduct<T>&   t = mfa_data.tmesh.tensor_prods[t_idx];
+            VolIterator         free_iter(t.nctrl_pts);                                         // iterator over free control points
 
-                // anchor of control point
-                mfa_data.tmesh.ctrl_pt_anchor(t, ijk, anchor);
+#ifdef MFA_TBB  // TBB
 
-                // local knot vector
-                mfa_data.tmesh.knot_intersections(anchor, t_idx, true, local_knot_idxs);
+            enumerable_thread_specific<vector<vector<KnotIdx>>>     thread_local_knot_idxs(mfa_data.dom_dim);   // local knot idices
+            enumerable_thread_specific<vector<vector<T>>>           thread_local_knots(mfa_data.dom_dim);       // local knot vector
+            enumerable_thread_specific<vector<vector<T>>>           thread_B(mfa_data.dom_dim);                 // 1-d basis functions
+            enumerable_thread_specific<VectorXi>                    thread_free_ijk(mfa_data.dom_dim);          // multidim index of control point
+            enumerable_thread_specific<vector<KnotIdx>>             thread_anchor(mfa_data.dom_dim);            // anchor of control point
+            enumerable_thread_specific<vector<SpMatTriplet<T>>>     thread_coeffs;                              // nonzero basis functions
+            enumerable_thread_specific<VectorX<T>>                  thread_row_sums(VectorX<T>::Zero(row_sums.size())); // row sums
+            static affinity_partitioner                             ap;
+            parallel_for (blocked_range<size_t>(0, free_iter.tot_iters()), [&] (blocked_range<size_t>& r)
+            {
+                auto& local_knot_idxs   = thread_local_knot_idxs.local();
+                auto& local_knots       = thread_local_knots.local();
                 for (auto k = 0; k < mfa_data.dom_dim; k++)
-                    for (auto n = 0; n < local_knot_idxs[k].size(); n++)
-                        local_knots[k][n] = mfa_data.tmesh.all_knots[k][local_knot_idxs[k][n]];
-
-                int nnz_col = 0;                                                                // num nonzeros in current column
+                {
+                    local_knot_idxs[k].resize(mfa_data.p(k) + 2);
+                    local_knots[k].resize(mfa_data.p(k) + 2);
+                }
 
-                VolIterator dom_iter(ndom_pts, dom_starts, input.ndom_pts);                     // iterator over input points
-                while (!dom_iter.done())
+                for (auto i = r.begin(); i < r.end(); i++)                                      // for control points
                 {
-                    for (auto k = 0; k < mfa_data.dom_dim; k++)                                 // for all dims
-                    {
-                        T u = input.params->param_grid[k][dom_iter.idx_dim(k)];                 // parameter of current input point
-                        T B = mfa_data.OneBasisFun(k, u, local_knots[k]);                       // basis function
-                        Nfree(dom_iter.cur_iter(), free_iter.cur_iter()) =
-                            (k == 0 ? B : Nfree(dom_iter.cur_iter(), free_iter.cur_iter()) * B);
-                    }       // for all dims
-                    if (Nfree(dom_iter.cur_iter(), free_iter.cur_iter()) != 0.0)
-                        nnz_col++;
-                    dom_iter.incr_iter();
-                }       // domain point iterator
-
-                if (nnz_col > max_nnz_col)
-                    max_nnz_col = nnz_col;
-                free_iter.incr_iter();
-            }       // free control point iterator
+                    free_iter.idx_ijk(i, thread_free_ijk.local());                              // ijk of control point
+                    mfa_data.tmesh.ctrl_pt_anchor(t, thread_free_ijk.local(), thread_anchor.local());
 
-#endif          // TBB or serial
+                    // local knot vector
+                    mfa_data.tmesh.knot_intersections(thread_anchor.local(), t_idx, true, local_knot_idxs);
+                    for (auto k = 0; k < mfa_data.dom_dim; k++)
+                        for (auto n = 0; n < local_knot_idxs[k].size(); n++)
+                            local_knots[k][n] = mfa_data.tmesh.all_knots[k][local_knot_idxs[k][n]];
 
-            return max_nnz_col;
-        }
+                    SupportTriplets(local_knots, i, ndom_pts, dom_starts, thread_B.local(), thread_coeffs.local(), thread_row_sums.local());
+                }
+            }, ap);
 
-        // free control points matrix of basis functions
-        // helper function for EncodeTensorLocalLinear
-        // sparse matrix version; not used for now, but might be in the future
-        void FreeCtrlPtMatSparse(TensorIdx          t_idx,              // index of tensor of control points
-                                 VectorXi&          ndom_pts,           // number of relevant input points in each dim
-                                 VectorXi&          dom_starts,         // starting offsets of relevant input points in each dim
-                                 SparseMatrixX<T>&  Nfree_sparse)       // (output) matrix of free control points basis functions
-        {
-            typedef Eigen::Triplet<T> Triplet;                                                  // (row, column, value)
-            vector<Triplet> coeffs;                                                             // nonzero coefficients
+            // combine thread-local triplets and row sums
+            thread_coeffs.combine_each([&](const vector<SpMatTriplet<T>>& c)
+            {
+                coeffs.insert(coeffs.end(), c.begin(), c.end());
+            });
+            thread_row_sums.combine_each([&](const VectorX<T>& s)
+            {
+                row_sums += s;
+            });
 
-            TensorProduct<T>&   t = mfa_data.tmesh.tensor_prods[t_idx];
-            vector<KnotIdx>     anchor(mfa_data.dom_dim);                                       // control point anchor
+#else           // serial
 
-            // local knot vector
+            vector<KnotIdx>         anchor(mfa_data.dom_dim);                                   // control point anchor
             vector<vector<KnotIdx>> local_knot_idxs(mfa_data.dom_dim);                          // local knot indices
-            vector<vector<T>> local_knots(mfa_data.dom_dim);                                    // local knot vector for current dim in parameter space
+            vector<vector<T>>       local_knots(mfa_data.dom_dim);                              // local knot vector for current dim in parameter space
+            vector<vector<T>>       B(mfa_data.dom_dim);                                        // 1-d basis functions
             for (auto k = 0; k < mfa_data.dom_dim; k++)
             {
                 local_knot_idxs[k].resize(mfa_data.p(k) + 2);
                 local_knots[k].resize(mfa_data.p(k) + 2);
             }
 
-            // iterator over free control points
-            VolIterator free_iter(t.nctrl_pts);
+            VectorXi ijk(mfa_data.dom_dim);                                                     // ijk of current control point
             while (!free_iter.done())
             {
-                VectorXi ijk(mfa_data.dom_dim);                                                 // ijk of current control point
                 free_iter.idx_ijk(free_iter.cur_iter(), ijk);
 
                 // anchor of control point
@@ -748,100 +760,76 @@ namespace mfa
                     for (auto n = 0; n < local_knot_idxs[k].size(); n++)
                         local_knots[k][n] = mfa_data.tmesh.all_knots[k][local_knot_idxs[k][n]];
 
-                // iterator over input points
-                VolIterator dom_iter(ndom_pts, dom_starts, input.ndom_pts);
-                while (!dom_iter.done())
-                {
-                    T v;                                                                        // basis function value
-                    for (auto k = 0; k < mfa_data.dom_dim; k++)                                 // for all dims
-                    {
-                        int p = mfa_data.p(k);                                                  // degree of current dim.
-                        T u = input.params->param_grid[k][dom_iter.idx_dim(k)];                             // parameter of current input point
-                        T B = mfa_data.OneBasisFun(k, u, local_knots[k]);                       // basis function
-                        v = (k == 0 ? B : v * B);
-                    }       // for all dims
-
-                    coeffs.push_back(Triplet(dom_iter.cur_iter(), free_iter.cur_iter(), v));
-                    dom_iter.incr_iter();
-                }       // domain point iterator
+                SupportTriplets(local_knots, free_iter.cur_iter(), ndom_pts, dom_starts, B, coeffs, row_sums);
 
                 free_iter.incr_iter();
             }       // free control point iterator
 
-            Nfree_sparse.setFromTriplets(coeffs.begin(), coeffs.end());
+#endif          // TBB or serial
         }
 
         // constraint control points matrix of basis functions
         // helper function for EncodeTensorLocalLinear
-        // Ncons needs to be sized correctly by caller
-        void ConsCtrlPtMat(VectorXi&                ndom_pts,           // number of relevant input points in each dim
-                           VectorXi&                dom_starts,         // starting offsets of relevant input points in each dim
-                           vector<vector<KnotIdx>>& anchors,            // anchors of constraint control points                                                    // corresponding anchors
-                           vector<TensorIdx>&       t_idx_anchors,      // tensors containing corresponding anchors
-                           MatrixX<T>&              Ncons)              // (output) matrix of constraint control points basis functions
+        // fills nonzero triplets directly, skipping any dense matrix
+        void ConsCtrlPtMat(const VectorXi&                  ndom_pts,           // number of relevant input points in each dim
+                           const VectorXi&                  dom_starts,         // starting offsets of relevant input points in each dim
+                           const vector<vector<KnotIdx>>&   anchors,            // anchors of constraint control points
+                           const vector<TensorIdx>&         t_idx_anchors,      // tensors containing corresponding anchors
+                           vector<SpMatTriplet<T>>&         coeffs,             // (output) nonzero basis functions
+                           VectorX<T>&                      row_sums)           // (output) row sums of basis functions, accumulated
         {
-            Ncons = MatrixX<T>::Constant(ndom_pts.prod(), Ncons.cols(), -1);         // basis functions, -1 means unassigned so far
-
-            // debug
-            fmt::print(stderr, "Ncons has {} rows and {} columns\n", Ncons.rows(), Ncons.cols());
-
-            // local knot vector
-            vector<vector<KnotIdx>> local_knot_idxs(mfa_data.dom_dim);                          // local knot indices
-            vector<vector<T>> local_knots(mfa_data.dom_dim);                                    // local knot vector for current dim in parameter space
-            for (auto k = 0; k < mfa_data.dom_dim; k++)
-            {
-                local_knot_idxs[k].resize(mfa_data.p(k) + 2);
-                local_knots[k].resize(mfa_data.p(k) + 2);
-            }
-
 #ifdef MFA_TBB  // TBB
 
-            VolIterator dom_iter(ndom_pts, dom_starts, input.ndom_pts);                         // iterator over input points
-
-            enumerable_thread_specific<vector<vector<KnotIdx>>> thread_local_knot_idxs(mfa_data.dom_dim);   // local knot idices
-            enumerable_thread_specific<vector<vector<T>>>       thread_local_knots(mfa_data.dom_dim);       // local knot idices
-            enumerable_thread_specific<VectorXi>                thread_dom_ijk(mfa_data.dom_dim);   // multidim index of domain point
-            static affinity_partitioner                         ap;
-            parallel_for (blocked_range2d<size_t>(0, Ncons.rows(), 0, Ncons.cols()), [&] (blocked_range2d<size_t>& r)
+            enumerable_thread_specific<vector<vector<KnotIdx>>>     thread_local_knot_idxs(mfa_data.dom_dim);   // local knot idices
+            enumerable_thread_specific<vector<vector<T>>>           thread_local_knots(mfa_data.dom_dim);       // local knot vector
+            enumerable_thread_specific<vector<vector<T>>>           thread_B(mfa_data.dom_dim);                 // 1-d basis functions
+            enumerable_thread_specific<vector<SpMatTriplet<T>>>     thread_coeffs;                              // nonzero basis functions
+            enumerable_thread_specific<VectorX<T>>                  thread_row_sums(VectorX<T>::Zero(row_sums.size())); // row sums
+            static affinity_partitioner                             ap;
+            parallel_for (blocked_range<size_t>(0, anchors.size()), [&] (blocked_range<size_t>& r)
             {
-                for (auto i = r.cols().begin(); i < r.cols().end(); i++)
+                auto& local_knot_idxs   = thread_local_knot_idxs.local();
+                auto& local_knots       = thread_local_knots.local();
+                for (auto k = 0; k < mfa_data.dom_dim; k++)
                 {
-                    if (i == r.cols().begin())
-                    {
-                        for (auto k = 0; k < mfa_data.dom_dim; k++)
-                        {
-                            thread_local_knot_idxs.local()[k].resize(mfa_data.p(k) + 2);
-                            thread_local_knots.local()[k].resize(mfa_data.p(k) + 2);
-                        }
-                    }
+                    local_knot_idxs[k].resize(mfa_data.p(k) + 2);
+                    local_knots[k].resize(mfa_data.p(k) + 2);
+                }
 
+                for (auto i = r.begin(); i < r.end(); i++)
+                {
                     // local knot vector
-                    mfa_data.tmesh.knot_intersections(anchors[i], t_idx_anchors[i], true, thread_local_knot_idxs.local());
+                    mfa_data.tmesh.knot_intersections(anchors[i], t_idx_anchors[i], true, local_knot_idxs);
                     for (auto k = 0; k < mfa_data.dom_dim; k++)
-                    {
-                        for (auto n = 0; n < thread_local_knot_idxs.local()[k].size(); n++)
-                            thread_local_knots.local()[k][n] = mfa_data.tmesh.all_knots[k][thread_local_knot_idxs.local()[k][n]];
-                    }
+                        for (auto n = 0; n < local_knot_idxs[k].size(); n++)
+                            local_knots[k][n] = mfa_data.tmesh.all_knots[k][local_knot_idxs[k][n]];
 
-                    for (auto j = r.rows().begin(); j < r.rows().end(); j++)
-                    {
-                        dom_iter.idx_ijk(j, thread_dom_ijk.local());                        // ijk of domain point
-                        for (auto k = 0; k < mfa_data.dom_dim; k++)
-                        {
-                            T u = input.params->param_grid[k][thread_dom_ijk.local()(k)];   // parameter of current input point
-                            T B = mfa_data.OneBasisFun(k, u, thread_local_knots.local()[k]);// basis function
-                            if (Ncons(j, i) == -1.0)                                        // unassigned so far
-                                Ncons(j, i) = B;
-                            else
-                                Ncons(j, i) *= B;
-                        }
-                    }       // for blocked range rows
-                }       // for blocked range cols
-            }, ap); // parallel for
+                    SupportTriplets(local_knots, i, ndom_pts, dom_starts, thread_B.local(), thread_coeffs.local(), thread_row_sums.local());
+                }
+            }, ap);
+
+            // combine thread-local triplets and row sums
+            thread_coeffs.combine_each([&](const vector<SpMatTriplet<T>>& c)
+            {
+                coeffs.insert(coeffs.end(), c.begin(), c.end());
+            });
+            thread_row_sums.combine_each([&](const VectorX<T>& s)
+            {
+                row_sums += s;
+            });
 
 #else       // serial
 
-            for (auto i = 0; i < Ncons.cols(); i++)                                             // for all constraint control points
+            vector<vector<KnotIdx>> local_knot_idxs(mfa_data.dom_dim);                          // local knot indices
+            vector<vector<T>>       local_knots(mfa_data.dom_dim);                              // local knot vector for current dim in parameter space
+            vector<vector<T>>       B(mfa_data.dom_dim);                                        // 1-d basis functions
+            for (auto k = 0; k < mfa_data.dom_dim; k++)
+            {
+                local_knot_idxs[k].resize(mfa_data.p(k) + 2);
+                local_knots[k].resize(mfa_data.p(k) + 2);
+            }
+
+            for (auto i = 0; i < anchors.size(); i++)                                           // for all constraint control points
             {
                 // local knot vector
                 mfa_data.tmesh.knot_intersections(anchors[i], t_idx_anchors[i], true, local_knot_idxs);
@@ -849,32 +837,10 @@ namespace mfa
                     for (auto n = 0; n < local_knot_idxs[k].size(); n++)
                         local_knots[k][n] = mfa_data.tmesh.all_knots[k][local_knot_idxs[k][n]];
 
-                // iterator over input points
-                VolIterator dom_iter(ndom_pts, dom_starts, input.ndom_pts);
-                while (!dom_iter.done())
-                {
-                    for (auto k = 0; k < mfa_data.dom_dim; k++)                                 // for all dims
-                    {
-                        T u = input.params->param_grid[k][dom_iter.idx_dim(k)];                             // parameter of current input point
-                        T B = mfa_data.OneBasisFun(k, u, local_knots[k]);                       // basis function
-                        if (Ncons(dom_iter.cur_iter(), i) == -1.0)                              // unassigned so far
-                            Ncons(dom_iter.cur_iter(), i) = B;
-                        else
-                            Ncons(dom_iter.cur_iter(), i) *= B;
-                    }           // for all dims
-                    dom_iter.incr_iter();
-                }           // domain points iterator
+                SupportTriplets(local_knots, i, ndom_pts, dom_starts, B, coeffs, row_sums);
             }       // for all constraint control points
 
 #endif      // TBB or serial
-
-            // set any unassigned values in Ncons to 0
-            for (auto i = 0; i < Ncons.rows(); i++)
-            {
-                for (auto j = 0; j < Ncons.cols(); j++)
-                    if (Ncons(i, j) == -1.0)
-                        Ncons(i, j) = 0.0;
-            }
         }
 
         // encodes the control points for one tensor product of a tmesh
@@ -882,6 +848,8 @@ namespace mfa
         // solves all dimensions together (not separably)
         // does not encode weights for now
         // latest linear constrained formulation as proposed by David Lenz (see wiki/notes/linear-constrained-fit.pdf)
+        // Nfree and Ncons are assembled directly in sparse form, the constraints are moved to the right hand side,
+        // and the normal equations are solved with a sparse Cholesky factorization that is cached per tensor
         void EncodeTensorLocalLinear(
                 TensorIdx                 t_idx,                  // index of tensor product being encoded
                 bool                      weighted = true)        // solve for and use weights
@@ -889,11 +857,6 @@ namespace mfa
             // debug
 //             fmt::print(stderr, "EncodeTensorLocalLinear tidx = {}\n", t_idx);
 
-            // debug
-            bool debug = false;
-            if (t_idx == 1)
-                debug = true;
-
             // timing
             double setup_time   = MPI_Wtime();
             double q_time       = MPI_Wtime();
@@ -931,22 +894,7 @@ namespace mfa
 
             // timing
             q_time                  = MPI_Wtime() - q_time;
-            double free_time        = MPI_Wtime();
-
-            // matrix of free control point basis functions
-
-            // a dense matrix copied to a sparse matrix just prior to solving
-            // To fill sparse matrix directly, skipping dense matrix, we would need to use row-major order
-            // to do row-sum normalization efficiently later. However, row-major is 2X slower to fill
-            // and 3-4X slower to solve than column-major. Hence, for now, we fill a dense matrix,
-            // do the row normalization, then copy dense matrix to column-major sparse matrix just before solving.
-
-            MatrixX<T> Nfree;
-            int max_nnz_col = FreeCtrlPtMat(t_idx, ndom_pts, dom_starts, Nfree);                    // returns max num nonzeros in any column
-
-            // timing
-            free_time           = MPI_Wtime() - free_time;
-            double cons_time    = MPI_Wtime();
+            double cons_time        = MPI_Wtime();
 
             // find constraint control points and their anchors
             MatrixX<T>                  Pcons;                                                      // constraint control points
@@ -957,53 +905,44 @@ namespace mfa
             // debug
 //             fmt::print(stderr, "Pcons.rows = {} t_idx_anchors.size() = {}\n", Pcons.rows(), t_idx_anchors.size());
 
-            MatrixX<T> Ncons = MatrixX<T>::Constant(Q.rows(), Pcons.rows(), -1);                    // basis functions, -1 means unassigned so far
-            if (Pcons.rows())
-                ConsCtrlPtMat(ndom_pts, dom_starts, anchors, t_idx_anchors, Ncons);
-
             // timing
-            cons_time           = MPI_Wtime() - cons_time;
-
-            // normalize Nfree and Ncons such that the row sum of Nfree + Ncons = 1.0
-            double norm_time    = MPI_Wtime();              // timing
+            cons_time               = MPI_Wtime() - cons_time;
+            double free_time        = 0.0;
+            double mult_time        = 0.0;
+            double factor_time      = 0.0;
 
-#ifdef MFA_TBB
-
-            static affinity_partitioner ap;
-            parallel_for (blocked_range<size_t>(0, Nfree.rows()), [&] (blocked_range<size_t>& r)
+            // cached factorizations are stale once any knot has been inserted
+            vector<size_t> nknots(mfa_data.dom_dim);
+            for (auto k = 0; k < mfa_data.dom_dim; k++)
+                nknots[k] = mfa_data.tmesh.all_knots[k].size();
+            if (nknots != local_solve_nknots)
             {
-            for (auto i = r.begin(); i < r.end(); i++)
-
-#else
-
-            for (auto i = 0; i < Nfree.rows(); i++)
+                local_solve_cache.clear();
+                local_solve_nknots = nknots;
+            }
 
-#endif
+            LocalSolveCache& cache  = local_solve_cache[t_idx];
+            bool cached             = LocalSolveCacheValid(cache, t, ndom_pts, dom_starts, anchors, t_idx_anchors);
 
+            if (!cached)
             {
-                bool error = false;
-                T sum = Nfree.row(i).sum();
+                // matrices of free and constraint control point basis functions, assembled directly as sparse triplets
+                free_time = MPI_Wtime();                                                            // timing
+                vector<SpMatTriplet<T>> free_coeffs;
+                vector<SpMatTriplet<T>> cons_coeffs;
+                VectorX<T>              row_sums = VectorX<T>::Zero(Q.rows());                      // row sums of Nfree + Ncons
+                free_coeffs.reserve(t.nctrl_pts.prod() * (mfa_data.p + VectorXi::Ones(mfa_data.dom_dim)).prod());
+                FreeCtrlPtMat(t_idx, ndom_pts, dom_starts, free_coeffs, row_sums);
                 if (Pcons.rows())
-                    sum += Ncons.row(i).sum();
+                    ConsCtrlPtMat(ndom_pts, dom_starts, anchors, t_idx_anchors, cons_coeffs, row_sums);
 
-                if (sum > 0.0)
-                {
-                    Nfree.row(i) /= sum;
-                    if (Pcons.rows())
-                        Ncons.row(i) /= sum;
-                }
-                else
-                {
-                    if (Pcons.rows())
-                        fmt::print(stderr, "Warning: EncodeTensorLocalLinear(): row {} Nfree row sum = {} Ncons row sum = {}, Nfree + Ncons row sum = {}. This should not happen.\n",
-                            i, Nfree.row(i).sum(), Ncons.row(i).sum(), sum);
-                    else
-                        fmt::print(stderr, "Warning: EncodeTensorLocalLinear(): row {} Nfree row sum = {}. This should not happen.\n",
-                            i, sum);
-                    error = true;
-                }
-                if (error)
+                // normalize Nfree and Ncons such that the row sum of Nfree + Ncons = 1.0
+                for (auto i = 0; i < row_sums.size(); i++)
                 {
+                    if (row_sums(i) > 0.0)
+                        continue;
+                    fmt::print(stderr, "Warning: EncodeTensorLocalLinear(): row {} Nfree + Ncons row sum = {}. This should not happen.\n",
+                            i, row_sums(i));
                     VectorXi ijk(mfa_data.dom_dim);
                     dom_iter.idx_ijk(i, ijk);
                     cerr << "ijk = " << ijk.transpose() << endl;
@@ -1012,135 +951,108 @@ namespace mfa
                         fmt::print(stderr, "{} ", input.params->param_grid[k][ijk(k)]);
                     fmt::print(stderr, "]\n");
                 }
-            }
+                for (auto& c : free_coeffs)
+                    c = SpMatTriplet<T>(c.row(), c.col(), c.value() / row_sums(c.row()));
+                for (auto& c : cons_coeffs)
+                    c = SpMatTriplet<T>(c.row(), c.col(), c.value() / row_sums(c.row()));
 
-#ifdef MFA_TBB
+                cache.Nfree.resize(Q.rows(), t.nctrl_pts.prod());
+                cache.Nfree.setFromTriplets(free_coeffs.begin(), free_coeffs.end());
+                cache.Ncons.resize(Q.rows(), Pcons.rows());
+                cache.Ncons.setFromTriplets(cons_coeffs.begin(), cons_coeffs.end());
+                free_time = MPI_Wtime() - free_time;                                                // timing
 
-            }, ap);
+                // multiply by transpose to make the matrix square and smaller
+                mult_time = MPI_Wtime();                                                            // timing
+                SparseMatrixX<T> NtNfree(cache.Nfree.cols(), cache.Nfree.cols());
 
-#endif
+#ifdef MFA_TBB  // TBB version
 
-            norm_time = MPI_Wtime() - norm_time;                // timing
+                SparseMatrixX<T> NfreeT = cache.Nfree.transpose();
+                int ntn_sparsity = (2 * mfa_data.p + VectorXi::Ones(mfa_data.dom_dim)).prod();     // nonzeros per column of NtN
+                MatProdThreaded(NfreeT, cache.Nfree, NtNfree, ntn_sparsity);
 
-            // multiply by transpose to make the matrix square and smaller
-            double mult_time    = MPI_Wtime();                  // timing
-            MatrixX<T> NtNfree  = Nfree.transpose() * Nfree;
-            mult_time           = MPI_Wtime() - mult_time;      // timing
+#else
 
-// for comparing sparse with dense solve
-// #define MFA_DENSE
+                NtNfree = cache.Nfree.transpose() * cache.Nfree;
 
-#ifndef MFA_DENSE
+#endif
 
-            // compute max nonzero columns in NtNfree
-            max_nnz_col = 0;
-            for (auto i = 0; i < NtNfree.rows(); i++)
-            {
-                int nnz_col = 0;
-                for (auto j = 0; j < NtNfree.cols(); j++)
-                {
-                    if (NtNfree(i, j) != 0.0)
-                        nnz_col++;
-                }
-                if (nnz_col > max_nnz_col)
-                    max_nnz_col = nnz_col;
-            }
+                mult_time = MPI_Wtime() - mult_time;                                                // timing
 
-            // copy from dense to sparse
-            SparseMatrixX<T> NtNfree_sparse(NtNfree.rows(), NtNfree.cols());
-            NtNfree_sparse.reserve(VectorXi::Constant(NtNfree.cols(), max_nnz_col));
-            for (auto i = 0; i < NtNfree.rows(); i++)
-            {
-                for (auto j = 0; j < NtNfree.cols(); j++)
-                {
-                    if (NtNfree(i, j) != 0.0)
-                        NtNfree_sparse.insert(i, j) = NtNfree(i,j);
-                }
-            }
-            NtNfree_sparse.makeCompressed();
+                // sparse Cholesky factorization of the normal equations
+                factor_time = MPI_Wtime();                                                          // timing
+                cache.solver.compute(NtNfree);
+                factor_time = MPI_Wtime() - factor_time;                                            // timing
 
-#endif
+                cache.knot_mins     = t.knot_mins;
+                cache.knot_maxs     = t.knot_maxs;
+                cache.ndom_pts      = ndom_pts;
+                cache.dom_starts    = dom_starts;
+                cache.anchors       = anchors;
+                cache.t_idx_anchors = t_idx_anchors;
+            }
 
             // timing
             double r_time       = MPI_Wtime();
 
-            // R is the right hand side needed for solving N * P = R
+            // R is the right hand side needed for solving N * P = R, with the constraints moved to the right hand side
             MatrixX<T> R = Q;
             if (Pcons.rows())
-                R -= Ncons * Pcons;
+                R -= cache.Ncons * Pcons;
 
             // timing
             r_time                  = MPI_Wtime() - r_time;
             setup_time              = MPI_Wtime() - setup_time;
 
-            // debug: collect some metrics about N
-//             size_t nonzeros = (Nfree.array() > 0).count();
-//             fmt::print(stderr, "EncodeTensorLocalLinear Nfree matrix: {} rows x {} cols = {} entries of which {} are nonzero ({})\n",
-//                     Nfree.rows(), Nfree.cols(), Nfree.rows() * Nfree.cols(), nonzeros, float(nonzeros) / (float)(Nfree.rows() * Nfree.cols()));
-
             fmt::print(stderr, "Solving...\n");
 
-            // for debugging, compute condition number of NtNfree
-            // unfortunately SVD takes too long when the matrix is ill-conditioned
-            // ref: https://forum.kde.org/viewtopic.php?f=74&t=117430
-//             Eigen::JacobiSVD<Eigen::MatrixXd> svd(NtNfree);
-//             double cond = svd.singularValues()(0) / svd.singularValues()(svd.singularValues().size()-1);
-//             fmt::print(stderr, "NtNfree has condition number {}\n", cond);
-
+// for comparing sparse with dense solve
+// #define MFA_DENSE
 
 #ifdef MFA_DENSE    // dense solve
 
-            double dense_solve_time = MPI_Wtime();                  // timing
-            t.ctrl_pts = (Nfree.transpose() * Nfree).ldlt().solve(Nfree.transpose() * R);
-            dense_solve_time = MPI_Wtime() - dense_solve_time;
+            double solve_time = MPI_Wtime();                        // timing
+            MatrixX<T> Nfree_dense = cache.Nfree;
+            t.ctrl_pts = (Nfree_dense.transpose() * Nfree_dense).ldlt().solve(Nfree_dense.transpose() * R);
+            solve_time = MPI_Wtime() - solve_time;
 
 #else               // sparse solve
 
-            double sparse_solve_time    = MPI_Wtime();              // timing
-
-            Eigen::SparseQR<SparseMatrixX<T>, Eigen::COLAMDOrdering<int>>  solver;
+            double solve_time = MPI_Wtime();                        // timing
 
-            // TODO: iterative least squares conjugate gradient is faster but sometimes fails
-            // NtN not necessarily symmetric positive definite?
-//             Eigen::LeastSquaresConjugateGradient<SparseMatrixX<T>>  solver;
+            if (cache.solver.info() == Eigen::Success)
+                t.ctrl_pts = cache.solver.solve(cache.Nfree.transpose() * R);
 
-            solver.compute(NtNfree_sparse);
-
-            if (solver.info() != Eigen::Success)
-            {
-                cerr << "EncodeTensorLocalLinear(): Error: Matrix decomposition failed" << endl;
-                abort();
-            }
-
-            t.ctrl_pts = solver.solve(Nfree.transpose() * R);
-            if (solver.info() != Eigen::Success)
+            // fall back to iterative least squares on Nfree directly if NtN is not positive definite
+            if (cache.solver.info() != Eigen::Success)
             {
-                cerr << "EncodeTensorLocalLinear(): Error: Least-squares solve failed" << endl;
-                abort();
+                fmt::print(stderr, "EncodeTensorLocalLinear(): Warning: sparse Cholesky failed, falling back to least-squares conjugate gradient\n");
+                Eigen::LeastSquaresConjugateGradient<SparseMatrixX<T>> lscg;
+                lscg.compute(cache.Nfree);
+                t.ctrl_pts = lscg.solve(R);
+                if (lscg.info() != Eigen::Success)
+                {
+                    cerr << "EncodeTensorLocalLinear(): Error: Least-squares solve failed" << endl;
+                    abort();
+                }
             }
 
-            sparse_solve_time = MPI_Wtime() - sparse_solve_time;
+            solve_time = MPI_Wtime() - solve_time;
 
 #endif
 
             // timing
             fmt::print(stderr, "EncodeTensorLocalLinear() timing:\n");
-            fmt::print(stderr, "setup time: {} s.\n", setup_time);
-            fmt::print(stderr, "    = free time {} + cons time {} + mult time {} s.\n",
-                    free_time, cons_time, mult_time);
-//             fmt::print(stderr, "    = q time {} + free time {} + cons time {} + norm time {} + mult time {} r time {} s.\n",
-//                     q_time, free_time, cons_time, norm_time, mult_time, r_time);
-//             fmt::print(stderr, "free_time {} = free_iter_time {} + dom_iter_time {} s.\n",
-//                     free_time, free_iter_time, dom_iter_time);
-
-#ifdef MFA_DENSE
-            fmt::print(stderr, "dense_solve time: {} s.\n", dense_solve_time);
-#else
-            fmt::print(stderr, "sparse_solve time: {} s.\n", sparse_solve_time);
-#endif
+            fmt::print(stderr, "setup time: {} s. {}\n", setup_time, cached ? "(cached factorization)" : "");
+            fmt::print(stderr, "    = cons time {} + free time {} + mult time {} + factor time {} s.\n",
+                    cons_time, free_time, mult_time, factor_time);
+//             fmt::print(stderr, "    = q time {} + free time {} + cons time {} + mult time {} r time {} s.\n",
+//                     q_time, free_time, cons_time, mult_time, r_time);
+            fmt::print(stderr, "solve time: {} s.\n", solve_time);
 
             // debug: check relative error of solution
-            double relative_error = (Nfree * t.ctrl_pts - R).norm() / R.norm(); // norm() is L2 norm
+            double relative_error = (cache.Nfree * t.ctrl_pts - R).norm() / R.norm(); // norm() is L2 norm
             cerr << "EncodeTensorLocalLinar(): The relative error is " << relative_error << endl;
         }
 
@@ -1154,7 +1066,9 @@ namespace mfa
                 T                   err_limit,              // maximum allowable normalized error
                 bool                weighted,               // solve for and use weights
                 const VectorX<T>&   extents,                // extents in each dimension, for normalizing error (size 0 means do not normalize)
-                int                 max_rounds = 0)         // optional maximum number of rounds
+                int                 max_rounds = 0,         // optional maximum number of rounds
+                int                 refit_iters = 0,        // max. iterations of warm-started refit per round (0 = direct solve each round)
+                AdaptiveCheckpoint<T>* checkpoint = NULL)   // optional checkpoint written every few rounds and possibly resumed from
         {
             vector<vector<T>> new_knots;                               // new knots in each dim.
 
@@ -1169,8 +1083,17 @@ namespace mfa
             // TODO: use weights for knot insertion
             // for now, weights are only used for final full encode
 
+            // resume from checkpoint
+            int first_iter = 0;
+            if (checkpoint && checkpoint->resume)
+            {
+                first_iter = checkpoint->iter;
+                if (verbose)
+                    fprintf(stderr, "Resuming from checkpoint at iteration %d\n", first_iter);
+            }
+
             // loop until no change in knots
-            for (int iter = 0; ; iter++)
+            for (int iter = first_iter; ; iter++)
             {
                 if (max_rounds > 0 && iter >= max_rounds)               // optional cap on number of rounds
                 {
@@ -1209,15 +1132,23 @@ namespace mfa
                     break;
                 }
 
+                if (checkpoint)
+                    checkpoint->Round(iter, 0, vector<vector<T>>());
+
                 // debug
 //                 mfa_data.tmesh.print();
             }
 
             // final full encoding needed after last knot insertion above
+            // refit_iters is unused: the rounds above solve only 1-d curves, so there are no previous
+            // full-dimensional control points from which to warm start
             if (verbose)
                 fprintf(stderr, "Encoding in full %ldD\n", mfa_data.p.size());
             TensorProduct<T>&t = mfa_data.tmesh.tensor_prods[0];        // fixed encode assumes the tmesh has only one tensor product
             Encode(t.nctrl_pts, t.ctrl_pts, t.weights, weighted);
+
+            if (checkpoint)
+                checkpoint->Done();
         }
 
 #else       // full-dimensional knot insertion
@@ -1228,7 +1159,9 @@ namespace mfa
                 T                   err_limit,              // maximum allowable normalized error
                 bool                weighted,               // solve for and use weights
                 const VectorX<T>&   extents,                // extents in each dimension, for normalizing error (size 0 means do not normalize)
-                int                 max_rounds = 0)         // optional maximum number of rounds
+                int                 max_rounds = 0,         // optional maximum number of rounds
+                int                 refit_iters = 0,        // max. iterations of warm-started refit per round (0 = direct solve each round)
+                AdaptiveCheckpoint<T>* checkpoint = NULL)   // optional checkpoint written every few rounds and possibly resumed from
         {
             vector<vector<T>> new_knots;                               // new knots in each dim.
             ErrorStats<T> error_stats;
@@ -1240,14 +1173,34 @@ namespace mfa
 
             mfa::NewKnots<T> nk(mfa_data, input);
 
+            // warm-started refit requires unit weights
+#ifndef MFA_NO_WEIGHTS
+            if (weighted)
+                refit_iters = 0;
+#endif
+            vector<vector<T>> old_knots;                                // knots before the latest insertion
+
+            // resume from checkpoint: the tmesh holds the knots and the control points of the last round
+            int first_iter = 0;
+            if (checkpoint && checkpoint->resume)
+            {
+                first_iter  = checkpoint->iter;
+                old_knots   = checkpoint->old_knots;
+                if (verbose)
+                    fprintf(stderr, "Resuming from checkpoint at iteration %d\n", first_iter);
+            }
+
             // loop until no change in knots
-            for (int iter = 0; ; iter++)
+            for (int iter = first_iter; ; iter++)
             {
                 // encode tensor product 0
                 TensorProduct<T>&t = mfa_data.tmesh.tensor_prods[0];
                 for (auto j = 0; j < mfa_data.dom_dim; j++)
                     t.nctrl_pts[j] = mfa_data.tmesh.all_knots[j].size() - mfa_data.p(j) - 1;
-                Encode(t.nctrl_pts, t.ctrl_pts, t.weights, weighted);
+                if (refit_iters > 0 && iter > 0)                        // refine the previous solution and iterate
+                    WarmRefit(old_knots, t, refit_iters);
+                else                                                    // direct solve from scratch
+                    Encode(t.nctrl_pts, t.ctrl_pts, t.weights, weighted);
 
                 if (max_rounds > 0 && iter >= max_rounds)               // optional cap on number of rounds
                 {
@@ -1273,6 +1226,7 @@ namespace mfa
                 vector<vector<T>>           inserted_knots(mfa_data.dom_dim);       // knots to be inserted in each dim.
                 vector<TensorIdx>           parent_tensor_idxs;                     // tensors having knots inserted
                 bool done = nk.AllErrorSpans(
+                        0,                                                  // single tensor at level 0
                         myextents,
                         err_limit,
                         true,
@@ -1302,6 +1256,9 @@ namespace mfa
 
                 vector<bool> inserted(mfa_data.dom_dim);                            // whether the current insertion succeed (in each dim)
 
+                if (refit_iters > 0)
+                    old_knots = mfa_data.tmesh.all_knots;
+
                 for (auto i = 0; i < n_insertions; i++)                             // for all knots to be inserted
                 {
                     // debug
@@ -1336,30 +1293,70 @@ namespace mfa
 
                 if (verbose)
                     PrintAdaptiveStats(error_stats);
+
+                if (checkpoint)
+                    checkpoint->Round(iter, 0, old_knots);
             }   // iterations
+
+            if (checkpoint)
+                checkpoint->Done();
         }
 
 #endif
 
+        // recompute the basis functions at the input points that Encode() leaves in mfa_data.N,
+        // for a model restored from a checkpoint without encoding it again
+        void InputBasisFuns()
+        {
+            if (!input.structured || mfa_data.tmesh.tensor_prods.size() != 1)
+                return;
+            const VectorXi& nctrl_pts = mfa_data.tmesh.tensor_prods[0].nctrl_pts;
+            for (auto k = 0; k < mfa_data.dom_dim; k++)
+            {
+                mfa_data.N[k] = MatrixX<T>::Zero(input.ndom_pts(k), nctrl_pts(k));
+                for (int i = 0; i < mfa_data.N[k].rows(); i++)
+                {
+                    int span = mfa_data.FindSpan(k, input.params->param_grid[k][i], nctrl_pts(k));
+#ifndef MFA_TMESH
+                    mfa_data.OrigBasisFuns(k, input.params->param_grid[k][i], span, mfa_data.N[k], i);
+#else
+                    mfa_data.BasisFuns(k, input.params->param_grid[k][i], span, mfa_data.N[k], i);
+#endif
+                }
+            }
+        }
+
         // adaptive encoding for T-mesh
         void AdaptiveEncode(
                 T                   err_limit,                  // maximum allowable normalized error
                 bool                weighted,                   // solve for and use weights
                 const VectorX<T>&   extents,                    // extents in each dimension, for normalizing error (size 0 means do not normalize)
-                int                 max_rounds = 0)             // optional maximum number of rounds
+                int                 max_rounds = 0,             // optional maximum number of rounds
+                AdaptiveCheckpoint<T>* checkpoint = NULL)       // optional checkpoint written every few rounds and possibly resumed from
         {
             int parent_level = 0;                               // parent level currently being refined
+            int first_iter   = 0;
 
-            // temporary control points and weights for global encode or first round of local encode
-            VectorXi nctrl_pts(mfa_data.dom_dim);
-            for (auto k = 0; k < mfa_data.dom_dim; k++)
-                nctrl_pts(k) = mfa_data.tmesh.all_knots[k].size() - mfa_data.p(k) - 1;
-            MatrixX<T> ctrl_pts(nctrl_pts.prod(), mfa_data.max_dim - mfa_data.min_dim + 1);
-            VectorX<T> weights(ctrl_pts.rows());
+            if (checkpoint && checkpoint->resume)               // resume from checkpoint: the tmesh is already refined
+            {
+                first_iter      = checkpoint->iter;
+                parent_level    = checkpoint->parent_level;
+                if (verbose)
+                    fprintf(stderr, "Resuming from checkpoint at iteration %d\n", first_iter);
+            }
+            else
+            {
+                // temporary control points and weights for global encode or first round of local encode
+                VectorXi nctrl_pts(mfa_data.dom_dim);
+                for (auto k = 0; k < mfa_data.dom_dim; k++)
+                    nctrl_pts(k) = mfa_data.tmesh.all_knots[k].size() - mfa_data.p(k) - 1;
+                MatrixX<T> ctrl_pts(nctrl_pts.prod(), mfa_data.max_dim - mfa_data.min_dim + 1);
+                VectorX<T> weights(ctrl_pts.rows());
 
-            // Initial global encode and scattering of control points to tensors
-            Encode(nctrl_pts, ctrl_pts, weights);
-            mfa_data.tmesh.scatter_ctrl_pts(nctrl_pts, ctrl_pts, weights);
+                // Initial global encode and scattering of control points to tensors
+                Encode(nctrl_pts, ctrl_pts, weights);
+                mfa_data.tmesh.scatter_ctrl_pts(nctrl_pts, ctrl_pts, weights);
+            }
 
             // debug: print tmesh
 //             fprintf(stderr, "\n----- initial T-mesh -----\n\n");
@@ -1368,7 +1365,7 @@ namespace mfa
 
             // loop until all tensors are done
             int iter;
-            for (iter = 0; ; iter++)
+            for (iter = first_iter; ; iter++)
             {
                 if (max_rounds > 0 && iter >= max_rounds)               // optional cap on number of rounds
                     break;
@@ -1396,8 +1393,14 @@ namespace mfa
                     else                                                        // one iteration only is done
                         parent_level++;
                 }
+
+                if (checkpoint)
+                    checkpoint->Round(iter, parent_level, vector<vector<T>>());
             }   // iterations
 
+            if (checkpoint)
+                checkpoint->Done();
+
             fmt::print(stderr, "{} iterations.\n", iter + 1);
             fmt::print(stderr, "{} tensor products.\n", mfa_data.tmesh.tensor_prods.size());
 
@@ -1457,9 +1460,258 @@ namespace mfa
             fprintf(stderr, "estimated RMS error             = %e\n",  rms_abs_err);
             fprintf(stderr, "estimated normalized RMS error  = %e\n",  rms_norm_err);
             fprintf(stderr, "estimated compression ratio     = %.2f\n",  compression);
+#ifdef MFA_ERROR_BOUNDS
+            fprintf(stderr, "error checks skipped by bounds  = %lu of %lu points\n",  error_stats.npts_skipped, input.domain.rows());
+#endif
             fprintf(stderr, "-----------------------------------------------------------\n");
         }
 
+        // multiplies points on a tensor grid by a sparse matrix along one domain dimension
+        // ie, out = (I x ... x A x ... x I) in, with dimension 0 varying fastest
+        // npts(k) is updated to A.rows()
+        void ApplyDim(
+                const SparseMatrixX<T>&     A,                  // matrix to apply, A.cols() == npts(k)
+                int                         k,                  // domain dimension
+                VectorXi&                   npts,               // number of points in each dim. of in, (output) of out
+                const MatrixX<T>&           in,                 // input points
+                MatrixX<T>&                 out)                // (output) result points
+        {
+            size_t inner = 1, outer = 1;                        // number of points below, above dimension k
+            for (auto j = 0; j < k; j++)
+                inner *= npts(j);
+            for (auto j = k + 1; j < npts.size(); j++)
+                outer *= npts(j);
+            size_t nin  = npts(k);
+            size_t nout = A.rows();
+
+            out = MatrixX<T>::Zero(inner * nout * outer, in.cols());
+
+#ifdef MFA_TBB      // TBB version
+
+            parallel_for (blocked_range<size_t>(0, outer), [&] (blocked_range<size_t>& r)
+            {
+                for (auto o = r.begin(); o < r.end(); o++)
+                    for (auto c = 0; c < A.outerSize(); c++)
+                        for (typename SparseMatrixX<T>::InnerIterator it(A, c); it; ++it)
+                            out.middleRows((o * nout + it.row()) * inner, inner) +=
+                                it.value() * in.middleRows((o * nin + c) * inner, inner);
+            });
+
+#else               // serial version
+
+            for (auto o = 0; o < outer; o++)
+                for (auto c = 0; c < A.outerSize(); c++)
+                    for (typename SparseMatrixX<T>::InnerIterator it(A, c); it; ++it)
+                        out.middleRows((o * nout + it.row()) * inner, inner) +=
+                            it.value() * in.middleRows((o * nin + c) * inner, inner);
+
+#endif
+
+            npts(k) = nout;
+        }
+
+        // knot insertion matrix in one dimension, mapping control points on the old knots to
+        // the same curve on the current (refined) knots, using the Oslo algorithm
+        // also flags the new control points whose basis functions differ from the old ones
+        void KnotInsertionMatrix(
+                int                         k,                  // domain dimension
+                const vector<T>&            old_knots,          // knots before insertion, a subset of all_knots[k]
+                SparseMatrixX<T>&           A,                  // (output) new_nctrl_pts x old_nctrl_pts refinement matrix
+                vector<bool>&               changed)            // (output) whether each new control point changed
+        {
+            const vector<T>&    new_knots   = mfa_data.tmesh.all_knots[k];
+            int                 p           = mfa_data.p(k);
+            long                nold        = old_knots.size() - p - 1;
+            long                nnew        = new_knots.size() - p - 1;
+
+            vector<T>           b(p + 1);                       // discrete B-spline values
+            vector<T>           left(p + 1), right(p + 1);
+            vector<SpMatTriplet<T>> triplets;
+            triplets.reserve(nnew * (p + 1));
+
+            for (auto j = 0; j < nnew; j++)
+            {
+                // old span containing new knot j
+                long mu = upper_bound(old_knots.begin(), old_knots.end(), new_knots[j]) - old_knots.begin() - 1;
+                mu = max(mu, (long)p);
+                mu = min(mu, nold - 1);
+
+                // same triangular scheme as basis functions, except level r is evaluated at new_knots[j + r]
+                b[0] = 1.0;
+                for (auto r = 1; r <= p; r++)
+                {
+                    T x = new_knots[j + r];
+                    for (auto l = 1; l <= r; l++)
+                    {
+                        left[l]  = x - old_knots[mu + 1 - l];
+                        right[l] = old_knots[mu + l] - x;
+                    }
+                    T saved = 0.0;
+                    for (auto l = 0; l < r; l++)
+                    {
+                        T temp  = b[l] / (right[l + 1] + left[r - l]);
+                        b[l]    = saved + right[l + 1] * temp;
+                        saved   = left[r - l] * temp;
+                    }
+                    b[r] = saved;
+                }
+                for (auto l = 0; l <= p; l++)
+                    if (b[l] != 0.0)
+                        triplets.push_back(SpMatTriplet<T>(j, mu - p + l, b[l]));
+            }
+            A.resize(nnew, nold);
+            A.setFromTriplets(triplets.begin(), triplets.end());
+
+            // a new basis function changed unless its knots match those of an old one
+            // also flag the p neighbors on either side, whose coupling to the changed ones differs
+            changed.assign(nnew, true);
+            vector<bool> inserted(new_knots.size(), false);
+            for (auto i = 0, l = 0; i < new_knots.size(); i++)
+            {
+                if (l < old_knots.size() && old_knots[l] == new_knots[i])
+                    l++;
+                else
+                    inserted[i] = true;
+            }
+            for (long j = 0; j < nnew; j++)
+            {
+                bool same = true;
+                for (long l = max(j - p, 0L); l <= min(j + 2 * p + 1, (long)new_knots.size() - 1); l++)
+                    if (inserted[l])
+                        same = false;
+                changed[j] = !same;
+            }
+        }
+
+        // warm-started refit of the control points of one tensor product after knot insertion
+        // previous control points are refined exactly onto the current knots, and then a few iterations
+        // of Jacobi-preconditioned conjugate gradient on the normal equations (N^T N) P = N^T Q update
+        // only the control points whose basis functions changed, ie, curves crossing the new knots
+        // assumes structured input and unit weights
+        // returns number of iterations
+        int WarmRefit(
+                const vector<vector<T>>&    old_knots,          // knots in each dim. before insertion
+                TensorProduct<T>&           t,                  // tensor product with previous control points, (output) refit
+                int                         max_iters)          // maximum number of iterations
+        {
+            int         dom_dim     = mfa_data.dom_dim;
+            int         pt_dim      = mfa_data.max_dim - mfa_data.min_dim + 1;
+            VectorXi    old_nctrl_pts(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+                old_nctrl_pts(k) = old_knots[k].size() - mfa_data.p(k) - 1;
+
+            // refine previous control points onto current knots
+            vector<vector<bool>> changed(dom_dim);              // changed control points in each dim.
+            VectorXi npts = old_nctrl_pts;
+            MatrixX<T> P = t.ctrl_pts, temp;
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                SparseMatrixX<T> A;
+                KnotInsertionMatrix(k, old_knots[k], A, changed[k]);
+                ApplyDim(A, k, npts, P, temp);
+                P.swap(temp);
+            }
+
+            // basis functions and normal equations matrices in each dim.
+            vector<SparseMatrixX<T>> Nt(dom_dim);
+            vector<SparseMatrixX<T>> NtN(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                mfa_data.N[k] = MatrixX<T>::Zero(input.ndom_pts(k), t.nctrl_pts(k));
+                for (int i = 0; i < mfa_data.N[k].rows(); i++)
+                {
+                    int span = mfa_data.FindSpan(k, input.params->param_grid[k][i], t.nctrl_pts(k));
+#ifndef MFA_TMESH
+                    mfa_data.OrigBasisFuns(k, input.params->param_grid[k][i], span, mfa_data.N[k], i);
+#else
+                    mfa_data.BasisFuns(k, input.params->param_grid[k][i], span, mfa_data.N[k], i);
+#endif
+                }
+                Nt[k]   = mfa_data.N[k].transpose().sparseView();
+                NtN[k]  = (Nt[k] * Nt[k].transpose()).pruned();
+            }
+
+            // right hand side N^T Q
+            MatrixX<T> B = input.domain.middleCols(mfa_data.min_dim, pt_dim);
+            npts = input.ndom_pts;
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                ApplyDim(Nt[k], k, npts, B, temp);
+                B.swap(temp);
+            }
+
+            // active control points and Jacobi preconditioner
+            size_t      tot_nctrl_pts = t.nctrl_pts.prod();
+            VectorX<T>  active(tot_nctrl_pts);                  // 1 for updated control points, 0 for fixed ones
+            VectorX<T>  diag(tot_nctrl_pts);                    // inverse diagonal of N^T N
+            size_t      nactive = 0;
+            VolIterator vol_iter(t.nctrl_pts);
+            while (!vol_iter.done())
+            {
+                size_t  i   = vol_iter.cur_iter();
+                bool    a   = false;
+                T       d   = 1.0;
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    int ijk = vol_iter.idx_dim(k);
+                    a |= changed[k][ijk];
+                    d *= NtN[k].coeff(ijk, ijk);
+                }
+                active(i)   = a ? 1.0 : 0.0;
+                diag(i)     = (a && d > 0.0) ? 1.0 / d : 0.0;
+                nactive    += a;
+                vol_iter.incr_iter();
+            }
+
+            // (N^T N) X, masked to active control points
+            auto apply = [&](const MatrixX<T>& X, MatrixX<T>& Y)
+            {
+                VectorXi n = t.nctrl_pts;
+                Y = X;
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    ApplyDim(NtN[k], k, n, Y, temp);
+                    Y.swap(temp);
+                }
+                Y = active.asDiagonal() * Y;
+            };
+
+            // preconditioned conjugate gradient, each column of control points independently
+            MatrixX<T> R, Z, D, AD;
+            apply(P, AD);
+            R = active.asDiagonal() * B - AD;
+            Z = diag.asDiagonal() * R;
+            D = Z;
+            Eigen::Array<T, 1, Eigen::Dynamic> rz       = (R.array() * Z.array()).colwise().sum();
+            Eigen::Array<T, 1, Eigen::Dynamic> b_norm   = (active.asDiagonal() * B).colwise().norm().array();
+            T tol = numeric_limits<T>::epsilon() * 100;
+            int iter;
+            for (iter = 0; iter < max_iters; iter++)
+            {
+                if ((R.colwise().norm().array() <= tol * b_norm).all())
+                    break;
+                apply(D, AD);
+                Eigen::Array<T, 1, Eigen::Dynamic> dad = (D.array() * AD.array()).colwise().sum();
+                Eigen::Array<T, 1, Eigen::Dynamic> alpha = (dad > 0.0).select(rz / dad, 0.0);
+                P += D * alpha.matrix().asDiagonal();
+                R -= AD * alpha.matrix().asDiagonal();
+                Z = diag.asDiagonal() * R;
+                Eigen::Array<T, 1, Eigen::Dynamic> rz_new   = (R.array() * Z.array()).colwise().sum();
+                Eigen::Array<T, 1, Eigen::Dynamic> beta     = (rz > 0.0).select(rz_new / rz, 0.0);
+                D = Z + D * beta.matrix().asDiagonal();
+                rz = rz_new;
+            }
+
+            if (verbose)
+                fprintf(stderr, "WarmRefit(): %lu of %lu control points updated, %d iterations, max. relative residual %e\n",
+                        nactive, tot_nctrl_pts, iter,
+                        (R.colwise().norm().array() / b_norm.max(numeric_limits<T>::min())).maxCoeff());
+
+            t.ctrl_pts.swap(P);
+            t.weights = VectorX<T>::Ones(tot_nctrl_pts);
+            return iter;
+        }
+
 #ifndef      MFA_NO_WEIGHTS
 
         bool Weights(
@@ -2154,7 +2406,8 @@ namespace mfa
                 const VectorX<T>&       weights,    // weights associated with control points
                 VectorX<T>              extents,    // extents in each dimension, for normalizing error (size 0 means do not normalize)
                 set<int>&               err_spans,  // (output) spans with error greater than err_limit
-                T                       err_limit)  // max allowable error
+                T                       err_limit,  // max allowable error
+                size_t&                 nskipped)   // (output) number of points not decoded because their error was bounded, incremented
         {
             mfa::Decoder<T> decoder(mfa_data, verbose);
             int pt_dim = tensor.ctrl_pts.cols();            // control point dimensonality
@@ -2164,11 +2417,35 @@ namespace mfa
             if (!extents.size())
                 extents = VectorX<T>::Ones(input.domain.cols());
 
+#ifdef MFA_ERROR_BOUNDS
+            const vector<T>& knots      = mfa_data.tmesh.all_knots[k];
+            const vector<T>& params     = input.params->param_grid[k];
+            bool    bounds              = (weights.array() == 1.0).all();   // derivative bounds hold for nonrational curves only
+            int     bounded_span        = -1;                               // last span for which bounds were tried
+#endif
+
             for (auto i = 0; i < input.ndom_pts[k]; i++)      // all domain points in the curve
             {
                 while (mfa_data.tmesh.all_knots[k][span + 1] < 1.0 && mfa_data.tmesh.all_knots[k][span + 1] <= input.params->param_grid[k][i])
                     span++;
 
+#ifdef MFA_ERROR_BOUNDS
+                // first point of a new span: try to prove the whole span is within the error limit
+                if (bounds && span != bounded_span)
+                {
+                    bounded_span = span;
+                    size_t last = i + 1;                            // one past the last point in the span
+                    while (last < input.ndom_pts[k] && !(knots[span + 1] < 1.0 && knots[span + 1] <= params[last]))
+                        last++;
+                    if (CurveSpanWithinErrLimit(k, span, co, i, last, ctrl_pts, weights, tensor, extents, err_limit, decoder))
+                    {
+                        nskipped    += last - i;
+                        i           = last - 1;
+                        continue;
+                    }
+                }
+#endif
+
                 decoder.CurvePt(k, input.params->param_grid[k][i], ctrl_pts, weights, tensor, cpt);
 
 
@@ -2222,6 +2499,75 @@ namespace mfa
             return nerr;
         }
 
+        // proves that all input points in one knot span of a curve are within err_limit without decoding all of them
+        // the curve is decoded at the first and last input points of the span, and between them differs from the
+        // line through those two points by at most the bounds on the second derivative in the span times (x - a)(b - x) / 2,
+        // where the second derivative is bounded by the convex hull of its control points, ie, scaled second differences
+        // of the control points
+        // valid for nonrational curves (unit weights)
+        bool CurveSpanWithinErrLimit(
+                size_t                  k,          // current dimension
+                int                     span,       // knot span
+                size_t                  co,         // starting ofst for reading domain pts
+                size_t                  first,      // index along the curve of first input point in the span
+                size_t                  last,       // index along the curve of one past the last input point in the span
+                const MatrixX<T>&       ctrl_pts,   // control points
+                const VectorX<T>&       weights,    // weights associated with control points
+                const TensorProduct<T>& tensor,     // current tensor product
+                const VectorX<T>&       extents,    // extents in each dimension, for normalizing error
+                T                       err_limit,  // max allowable error
+                mfa::Decoder<T>&        decoder)    // decoder for the end points
+        {
+            int                 p       = mfa_data.p(k);
+            int                 pt_dim  = mfa_data.max_dim - mfa_data.min_dim + 1;
+            const vector<T>&    knots   = mfa_data.tmesh.all_knots[k];
+            const vector<T>&    params  = input.params->param_grid[k];
+            if (last - first < 3)                           // nothing to save
+                return false;
+
+            // bounds on the second derivative in the span, zero for p < 2
+            VectorX<T> d2min = VectorX<T>::Zero(pt_dim);
+            VectorX<T> d2max = VectorX<T>::Zero(pt_dim);
+            if (p >= 2)
+            {
+                d2min.setConstant(numeric_limits<T>::max());
+                d2max.setConstant(-numeric_limits<T>::max());
+                for (auto l = span - p; l < span - 1; l++)
+                {
+                    VectorX<T> d0   = p * (ctrl_pts.row(l + 1) - ctrl_pts.row(l)).transpose() / (knots[l + p + 1] - knots[l + 1]);
+                    VectorX<T> d1   = p * (ctrl_pts.row(l + 2) - ctrl_pts.row(l + 1)).transpose() / (knots[l + p + 2] - knots[l + 2]);
+                    VectorX<T> d2   = (p - 1) * (d1 - d0) / (knots[l + p + 1] - knots[l + 2]);
+                    d2min           = d2min.cwiseMin(d2.head(pt_dim));
+                    d2max           = d2max.cwiseMax(d2.head(pt_dim));
+                }
+            }
+
+            // curve at the end points
+            VectorX<T> fa(ctrl_pts.cols()), fb(ctrl_pts.cols());
+            T a = params[first];
+            T b = params[last - 1];
+            decoder.CurvePt(k, a, ctrl_pts, weights, tensor, fa);
+            decoder.CurvePt(k, b, ctrl_pts, weights, tensor, fb);
+
+            // small safety margin for roundoff in the bounds
+            T limit = err_limit * (1.0 - 1.0e-6);
+            for (auto i = first; i < last; i++)
+            {
+                T u = params[i];
+                T s = (u - a) / (b - a);                    // position of the point between the ends
+                T w = (u - a) * (b - u) / 2.0;
+                for (auto j = 0; j < pt_dim; j++)
+                {
+                    T lq = (1.0 - s) * fa(j) + s * fb(j) - input.domain(co + i * input.g.ds[k], mfa_data.min_dim + j);
+                    T lo = lq - d2max(j) * w;
+                    T hi = lq - d2min(j) * w;
+                    if (max(fabs(lo), fabs(hi)) / extents(mfa_data.min_dim + j) > limit)
+                        return false;
+                }
+            }
+            return true;
+        }
+
 #ifdef MFA_TMESH
 
         // refines a T-mesh at a given parent level
@@ -2606,7 +2952,7 @@ namespace mfa
         }
 
         // constraint control points and corresponding anchors for local solve
-        // this version checks all tensors, slower than looking at prev/next, but reliably finds all constraints
+        // this version checks all tensors near tc found in the tmesh spatial index, reliably finding all constraints
         void LocalSolveAllConstraints(
                 const TensorProduct<T>&     tc,                 // current tensor product being solved
                 MatrixX<T>&                 ctrl_pts,           // (output) constraining control points
@@ -2627,12 +2973,23 @@ namespace mfa
             vector<KnotIdx> intersect_mins(mfa_data.dom_dim);
             vector<KnotIdx> intersect_maxs(mfa_data.dom_dim);
 
+            // candidate tensors: padding within any tensor reaches at most p level-0 knots, which belong to all tensors
+            vector<KnotIdx>     cand_mins(mfa_data.dom_dim);
+            vector<KnotIdx>     cand_maxs(mfa_data.dom_dim);
+            vector<TensorIdx>   cands;
+            for (auto i = 0; i < mfa_data.dom_dim; i++)
+            {
+                cand_mins[i] = tmesh.level0_knot_ofst(tc.knot_mins[i], -mfa_data.p(i), i);
+                cand_maxs[i] = tmesh.level0_knot_ofst(tc.knot_maxs[i], mfa_data.p(i), i);
+            }
+            tmesh.tensor_candidates(cand_mins, cand_maxs, cands);
+
             // get required sizes
 
             int rows = 0;                                       // number of rows required in ctrl_pts
             VectorXi npts(mfa_data.dom_dim);
 
-            for (auto k = 0; k < tmesh.tensor_prods.size(); k++)
+            for (auto k : cands)
             {
                 const TensorProduct<T>& t = tmesh.tensor_prods[k];
                 if (&t == &tc)
@@ -2659,10 +3016,9 @@ namespace mfa
                         else                                // even degree
                             npts(i) = tmesh.knot_idx_dist(t, intersect_mins[i], intersect_maxs[i], i, false);
                     }
+                    rows += npts.prod();
                 }
-
-                rows += npts.prod();
-            }       // for all tensor products
+            }       // for all candidate tensor products
 
             ctrl_pts.resize(rows, cols);
             anchors.resize(rows);
@@ -2675,7 +3031,7 @@ namespace mfa
             VectorXi sub_npts(mfa_data.dom_dim);
             VectorXi all_npts(mfa_data.dom_dim);
             vector<KnotIdx> anchor(mfa_data.dom_dim);           // one anchor
-            for (auto k = 0; k < tmesh.tensor_prods.size(); k++)
+            for (auto k : cands)
             {
                 const TensorProduct<T>& t = tmesh.tensor_prods[k];
                 if (&t == &tc)
@@ -2754,6 +3110,8 @@ namespace mfa
         {
             int     pt_dim          = mfa_data.tmesh.tensor_prods[0].ctrl_pts.cols();    // control point dimensonality
             size_t  tot_nnew_knots  = 0;                                            // total number of new knots found
+            size_t  nchecked        = 0;                                            // number of curve points checked for error
+            size_t  nskipped        = 0;                                            // number of those not decoded because of error bounds
             new_knots.resize(mfa_data.dom_dim);
             vector<vector<int>> new_levels(mfa_data.dom_dim);
 
@@ -2863,7 +3221,8 @@ namespace mfa
 #endif
 
                                 // compute the error on the curve (number of input points with error > err_limit)
-                                size_t nerr = ErrorCurve(k, t, input.g.co[k][j], P, weights, extents, err_spans, err_limit);
+                                size_t nerr = ErrorCurve(k, t, input.g.co[k][j], P, weights, extents, err_spans, err_limit, nskipped);
+                                nchecked += input.ndom_pts(k);
 
                                 // debug
 //                                 fmt::print(stderr, "OrigNewKnots_curve(): nerr {}\n", nerr);
@@ -2913,6 +3272,11 @@ namespace mfa
                 for (auto i = 0; i < mfa_data.dom_dim; i++)
                     fmt::print(stderr, "new_knots in dim {}: [{}]\n", i, fmt::join(new_knots[i], ","));
 
+#ifdef MFA_ERROR_BOUNDS
+                if (verbose)
+                    fmt::print(stderr, "error checks skipped by bounds: {} of {} curve points\n", nskipped, nchecked);
+#endif
+
                 // insert the new knots
                 mfa::NewKnots<T> nk(mfa_data, input);
                 vector<vector<KnotIdx>> unused(mfa_data.dom_dim);
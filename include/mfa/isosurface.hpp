@@ -0,0 +1,341 @@
+//--------------------------------------------------------------
+// isosurface extraction directly from an mfa
+//
+// marching tetrahedra over a regular grid in parameter space, where only
+// the grid cells overlapping knot spans whose control point bounds contain
+// the isovalue are decoded, and vertices are refined onto the surface by
+// Newton steps along the gradient of the model
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _ISOSURFACE_HPP
+#define _ISOSURFACE_HPP
+
+#include    <vector>
+#include    <unordered_map>
+#include    <algorithm>
+
+using namespace std;
+
+namespace mfa
+{
+    template <typename T>                               // float or double
+    struct TriangleMesh
+    {
+        MatrixX<T>          verts;                      // vertex coordinates, one row per vertex
+        vector<int>         tris;                       // vertex indices, three per triangle, oriented with normals toward increasing value
+
+        size_t ntris() const                            { return tris.size() / 3; }
+    };
+
+    template <typename T>                               // float or double
+    class Isosurface
+    {
+        const MFA_Data<T>&  mfa_data;                   // the mfa data model
+        int                 col;                        // column of the control points to contour
+
+        // 6 tetrahedra sharing the cube diagonal 0-7, corners numbered dx + 2 dy + 4 dz
+        // neighboring cubes split their shared faces along the same diagonal, so the mesh is watertight
+        static const int    tets[6][4];
+
+    public:
+
+        Isosurface(
+                const MFA_Data<T>&  mfa_data_,          // MFA data model, 3-d domain
+                int                 col_ = -1) :        // column of control points to contour (-1 = last, ie, the science variable)
+            mfa_data(mfa_data_),
+            col(col_ < 0 ? mfa_data_.tmesh.tensor_prods[0].ctrl_pts.cols() - 1 : col_)
+        {
+            if (mfa_data.dom_dim != 3)
+            {
+                fprintf(stderr, "Error: Isosurface only implemented for 3-d domains\n");
+                exit(1);
+            }
+        }
+
+        // extracts the isosurface on a regular grid of ndom_pts points over [par_min, par_max] in parameter space
+        // mesh vertices are in parameter space
+        // returns the number of grid points decoded
+        size_t Extract(
+                T                   iso,                // isovalue
+                const VectorX<T>&   par_min,            // lower corner of grid in param space
+                const VectorX<T>&   par_max,            // upper corner of grid in param space
+                const VectorXi&     ndom_pts,           // number of grid points in each dim.
+                TriangleMesh<T>&    mesh,               // (output) triangle mesh
+                int                 newton_iters = 2,   // max. Newton steps to move each vertex onto the surface
+                int                 verbose = 0)        // debug level
+        {
+            const int               dom_dim = 3;
+            const TensorProduct<T>& t       = mfa_data.tmesh.tensor_prods[0];
+            VectorX<T>              h(dom_dim);         // grid spacing
+            size_t                  npts    = 1;
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                h(k)    = ndom_pts(k) > 1 ? (par_max(k) - par_min(k)) / (ndom_pts(k) - 1) : 0.0;
+                npts   *= ndom_pts(k);
+            }
+            VectorXi ncells = ndom_pts - VectorXi::Ones(dom_dim);
+            mesh.verts.resize(0, dom_dim);
+            mesh.tris.clear();
+            if (ncells.minCoeff() < 1)
+                return 0;
+
+            // cells overlapping the knot spans that may contain the isovalue
+            SpanBoundsIndex<T>  index(mfa_data, col);
+            vector<VectorX<T>>  span_mins, span_maxs;
+            index.RangeSpans(iso, iso, span_mins, span_maxs);
+            vector<size_t>      cells;
+            for (auto s = 0; s < span_mins.size(); s++)
+            {
+                VectorXi lo(dom_dim), n(dom_dim);
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    int i0  = std::max(0, (int)floor((span_mins[s](k) - par_min(k)) / h(k)));
+                    int i1  = std::min(ncells(k), (int)ceil((span_maxs[s](k) - par_min(k)) / h(k)));
+                    lo(k)   = i0;
+                    n(k)    = std::max(0, i1 - i0);
+                }
+                if (n.prod() == 0)
+                    continue;
+                VolIterator vol_iter(n);
+                while (!vol_iter.done())
+                {
+                    cells.push_back(lo(0) + vol_iter.idx_dim(0) +
+                            ncells(0) * (lo(1) + vol_iter.idx_dim(1) + ncells(1) * (lo(2) + vol_iter.idx_dim(2))));
+                    vol_iter.incr_iter();
+                }
+            }
+            sort(cells.begin(), cells.end());
+            cells.erase(unique(cells.begin(), cells.end()), cells.end());
+
+            // grid point index of corner c of a cell
+            auto corner = [&](size_t cell, int c)
+            {
+                size_t i = cell % ncells(0);
+                size_t j = (cell / ncells(0)) % ncells(1);
+                size_t k = cell / ((size_t)ncells(0) * ncells(1));
+                i += c & 1;
+                j += (c >> 1) & 1;
+                k += (c >> 2) & 1;
+                return i + ndom_pts(0) * (j + (size_t)ndom_pts(1) * k);
+            };
+            auto grid_param = [&](size_t idx, VectorX<T>& param)
+            {
+                param(0) = par_min(0) + (idx % ndom_pts(0)) * h(0);
+                param(1) = par_min(1) + ((idx / ndom_pts(0)) % ndom_pts(1)) * h(1);
+                param(2) = par_min(2) + (idx / ((size_t)ndom_pts(0) * ndom_pts(1))) * h(2);
+            };
+
+            // decode the corners of the candidate cells
+            vector<size_t> pts;
+            pts.reserve(cells.size() * 2);
+            for (auto cell : cells)
+                for (auto c = 0; c < 8; c++)
+                    pts.push_back(corner(cell, c));
+            sort(pts.begin(), pts.end());
+            pts.erase(unique(pts.begin(), pts.end()), pts.end());
+            vector<T>   vals(pts.size());
+            Decoder<T>  decoder(mfa_data, verbose);
+            VectorXi    no_derivs;
+
+#ifdef MFA_TBB
+            enumerable_thread_specific<DecodeInfo<T>> thread_decode_info([&]()
+                    { return DecodeInfo<T>(mfa_data, no_derivs); });
+            parallel_for (blocked_range<size_t>(0, pts.size()), [&](blocked_range<size_t>& r)
+            {
+                VectorX<T>      param(dom_dim), cpt(t.ctrl_pts.cols());
+                DecodeInfo<T>&  di = thread_decode_info.local();
+                for (auto i = r.begin(); i < r.end(); i++)
+                {
+                    grid_param(pts[i], param);
+                    decoder.VolPt(param, cpt, di, t, no_derivs);
+                    vals[i] = cpt(col);
+                }
+            });
+#endif
+#ifdef MFA_SERIAL
+            {
+                VectorX<T>      param(dom_dim), cpt(t.ctrl_pts.cols());
+                DecodeInfo<T>   di(mfa_data, no_derivs);
+                for (auto i = 0; i < pts.size(); i++)
+                {
+                    grid_param(pts[i], param);
+                    decoder.VolPt(param, cpt, di, t, no_derivs);
+                    vals[i] = cpt(col);
+                }
+            }
+#endif
+            auto value = [&](size_t idx)
+            {
+                return vals[lower_bound(pts.begin(), pts.end(), idx) - pts.begin()];
+            };
+
+            // marching tetrahedra, with one vertex per crossed grid edge shared by all incident triangles
+            unordered_map<size_t, int>  edge_verts;                 // key = lower grid point * npts + upper grid point
+            vector<T>                   verts;                      // flattened vertex coordinates
+            VectorX<T>                  pa(dom_dim), pb(dom_dim);
+            auto edge_vert = [&](size_t a, size_t b)
+            {
+                if (a > b)
+                    std::swap(a, b);
+                auto it = edge_verts.find(a * npts + b);
+                if (it != edge_verts.end())
+                    return it->second;
+                T va = value(a), vb = value(b);
+                T s  = (iso - va) / (vb - va);
+                grid_param(a, pa);
+                grid_param(b, pb);
+                int v = verts.size() / dom_dim;
+                for (auto k = 0; k < dom_dim; k++)
+                    verts.push_back(pa(k) + s * (pb(k) - pa(k)));
+                edge_verts[a * npts + b] = v;
+                return v;
+            };
+            auto add_tri = [&](int v0, int v1, int v2, const VectorX<T>& up)    // up points toward increasing value
+            {
+                Eigen::Map<VectorX<T>> x0(&verts[v0 * dom_dim], dom_dim);
+                Eigen::Map<VectorX<T>> x1(&verts[v1 * dom_dim], dom_dim);
+                Eigen::Map<VectorX<T>> x2(&verts[v2 * dom_dim], dom_dim);
+                Eigen::Matrix<T, 3, 1> e1 = x1 - x0, e2 = x2 - x0;
+                if (e1.cross(e2).dot(up) < 0.0)
+                    std::swap(v1, v2);
+                mesh.tris.push_back(v0);
+                mesh.tris.push_back(v1);
+                mesh.tris.push_back(v2);
+            };
+
+            VectorX<T> up(dom_dim), pin(dom_dim), pout(dom_dim);
+            for (auto cell : cells)
+            {
+                size_t  c[8];
+                bool    any_in = false, any_out = false;
+                for (auto i = 0; i < 8; i++)
+                {
+                    c[i] = corner(cell, i);
+                    (value(c[i]) >= iso ? any_in : any_out) = true;
+                }
+                if (!any_in || !any_out)
+                    continue;
+
+                for (auto tt = 0; tt < 6; tt++)
+                {
+                    size_t  v[4];
+                    int     in[4], out[4];
+                    int     nin = 0, nout = 0;
+                    for (auto i = 0; i < 4; i++)
+                    {
+                        v[i] = c[tets[tt][i]];
+                        if (value(v[i]) >= iso)
+                            in[nin++] = i;
+                        else
+                            out[nout++] = i;
+                    }
+                    if (nin == 0 || nout == 0)
+                        continue;
+
+                    // direction of increasing value: from the centroid of the outside corners to the inside ones
+                    pin.setZero();
+                    pout.setZero();
+                    for (auto i = 0; i < nin; i++)
+                    {
+                        grid_param(v[in[i]], pa);
+                        pin += pa / nin;
+                    }
+                    for (auto i = 0; i < nout; i++)
+                    {
+                        grid_param(v[out[i]], pa);
+                        pout += pa / nout;
+                    }
+                    up = pin - pout;
+
+                    if (nin == 1 || nout == 1)                  // one triangle around the lone corner
+                    {
+                        int  lone   = nin == 1 ? in[0] : out[0];
+                        int* others = nin == 1 ? out : in;
+                        add_tri(edge_vert(v[lone], v[others[0]]),
+                                edge_vert(v[lone], v[others[1]]),
+                                edge_vert(v[lone], v[others[2]]), up);
+                    }
+                    else                                        // quad between two inside and two outside corners
+                    {
+                        int q0 = edge_vert(v[in[0]], v[out[0]]);
+                        int q1 = edge_vert(v[in[0]], v[out[1]]);
+                        int q2 = edge_vert(v[in[1]], v[out[1]]);
+                        int q3 = edge_vert(v[in[1]], v[out[0]]);
+                        add_tri(q0, q1, q2, up);
+                        add_tri(q0, q2, q3, up);
+                    }
+                }
+            }
+
+            // Newton steps along the gradient to move the vertices from the linear interpolant onto the surface
+            mesh.verts = Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>
+                (verts.data(), verts.size() / dom_dim, dom_dim);
+            if (newton_iters > 0)
+            {
+                T max_step = h.norm();                          // vertices should not leave the neighborhood of their cell
+                auto refine = [&](size_t i, DersDecodeInfo<T>& di, MatrixX<T>& out)
+                {
+                    VectorX<T> x = mesh.verts.row(i).transpose();
+                    VectorX<T> x0 = x;
+                    for (auto it = 0; it < newton_iters; it++)
+                    {
+                        decoder.VolPtDers(x, di, t, out);
+                        VectorX<T> g    = out.col(col).segment(1, dom_dim);
+                        T          gg   = g.squaredNorm();
+                        if (gg == 0.0)
+                            break;
+                        VectorX<T> step = (out(0, col) - iso) / gg * g;
+                        x -= step;
+                        x = x.cwiseMax(par_min).cwiseMin(par_max);
+                        if ((x - x0).norm() > max_step)
+                        {
+                            x = x0;                             // diverged, keep the interpolated position
+                            break;
+                        }
+                        if (step.norm() < 1e-6 * max_step)
+                            break;
+                    }
+                    mesh.verts.row(i) = x.transpose();
+                };
+#ifdef MFA_TBB
+                enumerable_thread_specific<DersDecodeInfo<T>> thread_ders_info([&]()
+                        { return DersDecodeInfo<T>(mfa_data, 1); });
+                parallel_for (blocked_range<size_t>(0, mesh.verts.rows()), [&](blocked_range<size_t>& r)
+                {
+                    MatrixX<T> out;
+                    for (auto i = r.begin(); i < r.end(); i++)
+                        refine(i, thread_ders_info.local(), out);
+                });
+#endif
+#ifdef MFA_SERIAL
+                DersDecodeInfo<T>   di(mfa_data, 1);
+                MatrixX<T>          out;
+                for (auto i = 0; i < mesh.verts.rows(); i++)
+                    refine(i, di, out);
+#endif
+            }
+
+            if (verbose)
+                fprintf(stderr, "Isosurface: %lu of %lu cells are candidates, %lu of %lu grid points decoded, %ld vertices, %lu triangles\n",
+                        cells.size(), (size_t)ncells.prod(), pts.size(), npts, mesh.verts.rows(), mesh.ntris());
+
+            return pts.size();
+        }
+    };
+
+    template <typename T>
+    const int Isosurface<T>::tets[6][4] =
+    {
+        {0, 1, 3, 7},
+        {0, 3, 2, 7},
+        {0, 2, 6, 7},
+        {0, 6, 4, 7},
+        {0, 4, 5, 7},
+        {0, 5, 1, 7},
+    };
+}
+
+#endif
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------
+// read-only memory map of a raw grid file
+//
+// the file holds the points of a regular grid in row-major order (first
+// dimension varying fastest), each point ncomps values of type P, with no
+// header; pages are read by the OS only when touched, so a block selecting a
+// subvolume or a strided lattice of the grid reads only the pages it covers
+//
+// Line() views the values of a line of points in the first dimension in place,
+// as a strided Eigen map with one row per point and one column per component
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _MAPPED_GRID_HPP
+#define _MAPPED_GRID_HPP
+
+#include    <Eigen/Dense>
+
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <fcntl.h>
+#include    <unistd.h>
+#include    <cstdio>
+#include    <string>
+#include    <vector>
+
+using namespace std;
+
+namespace mfa
+{
+    template <typename P>                           // precision of the values in the file (e.g., float or double)
+    class MappedGrid
+    {
+        void*               addr;                   // start of the mapping
+        size_t              nbytes;                 // size of the mapping
+
+        MappedGrid(const MappedGrid&);              // not copyable, owns the mapping
+        MappedGrid& operator=(const MappedGrid&);
+
+    public:
+
+        typedef Eigen::Matrix<P, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>       LineMatrix;
+        typedef Eigen::Map<const LineMatrix, 0, Eigen::Stride<Eigen::Dynamic, 1>>       LineMap;
+
+        VectorXi            dims;                   // number of grid points in each dimension
+        int                 ncomps;                 // number of values per point
+        const P*            vals;                   // values of the grid, in place
+
+        MappedGrid(
+                const string&       filename,
+                const VectorXi&     dims_,          // number of grid points in each dimension
+                int                 ncomps_) :      // number of values per point
+            addr(MAP_FAILED),
+            nbytes(sizeof(P) * ncomps_),
+            dims(dims_),
+            ncomps(ncomps_),
+            vals(NULL)
+        {
+            for (auto i = 0; i < dims.size(); i++)
+                nbytes *= dims(i);
+
+            int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                fprintf(stderr, "Error: MappedGrid: unable to open %s\n", filename.c_str());
+                exit(1);
+            }
+            struct stat st;
+            if (fstat(fd, &st) || (size_t)st.st_size < nbytes)
+            {
+                fprintf(stderr, "Error: MappedGrid: %s is smaller than a grid of %lu bytes\n", filename.c_str(), nbytes);
+                exit(1);
+            }
+            addr = mmap(NULL, nbytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);                              // the mapping keeps the file open
+            if (addr == MAP_FAILED)
+            {
+                fprintf(stderr, "Error: MappedGrid: unable to map %s\n", filename.c_str());
+                exit(1);
+            }
+            madvise(addr, nbytes, MADV_SEQUENTIAL); // points are visited in file order
+            vals = static_cast<const P*>(addr);
+        }
+
+        ~MappedGrid()
+        {
+            if (addr != MAP_FAILED)
+                munmap(addr, nbytes);
+        }
+
+        // index of a grid point in the file
+        size_t Index(const VectorXi& ijk) const
+        {
+            size_t idx = 0;
+            for (auto i = dims.size() - 1; i >= 0; i--)
+                idx = idx * dims(i) + ijk(i);
+            return idx;
+        }
+
+        // values of npts points starting at grid point ijk, every stride points in the first dimension
+        LineMap Line(
+                const VectorXi&     ijk,
+                int                 npts,
+                int                 stride = 1) const
+        {
+            return LineMap(vals + Index(ijk) * ncomps, npts, ncomps, Eigen::Stride<Eigen::Dynamic, 1>(stride * ncomps, 1));
+        }
+    };
+}
+
+#endif
@@ -26,6 +26,11 @@
 // default is to sample fewer curves
 // #define MFA_CHECK_ALL_CURVES
 
+// skip error checks of knot spans whose error is proven to be below the limit by bounds on the derivatives
+// (from control point differences) and the input values in the span, instead of decoding every input point
+// comment out the following line to decode all input points
+#define MFA_ERROR_BOUNDS
+
 // comment out the following line for applying weights to only the range dimension
 // weighing the range coordinate only is the default if no method is specified
 // #define WEIGH_ALL_DIMS
@@ -44,6 +49,8 @@
 #include    <vector>
 #include    <list>
 #include    <iostream>
+#include    <random>
+#include    <algorithm>
 
 #ifdef MFA_TBB
 #define     TBB_SUPPRESS_DEPRECATED_MESSAGES    1
@@ -79,10 +86,19 @@ using SpMatTriplet = Eigen::Triplet<T>;
 #include    "util.hpp"
 #include    "param.hpp"
 #include    "pointset.hpp"
+#include    "tensor_index.hpp"
 #include    "tmesh.hpp"
+#include    "compact_tmesh.hpp"
 #include    "mfa_data.hpp"
 #include    "decode.hpp"
+#include    "isosurface.hpp"
+#include    "streamline.hpp"
+#include    "raycast.hpp"
+#include    "compress.hpp"
+#include    "sequence.hpp"
+#include    "checkpoint.hpp"
 #include    "encode.hpp"
+#include    "pyramid.hpp"
 
 // TODO: Move Model's from BlockBase to MFA
 //       Want MFA object to manage construction-destruction of MFA_Data
@@ -158,17 +174,42 @@ namespace mfa
                 int                 verbose,                // debug level
                 bool                weighted,               // solve for and use weights (default = true)
                 const VectorX<T>&   extents,                // extents in each dimension, for normalizing error (size 0 means do not normalize)
-                int                 max_rounds) const       // optional maximum number of rounds
+                int                 max_rounds,             // optional maximum number of rounds
+                int                 refit_iters = 0,        // max. iterations of warm-started refit per round (0 = direct solve, single tensor only)
+                AdaptiveCheckpoint<T>* checkpoint = NULL) const // optional checkpoint written every checkpoint->interval rounds
         {
             Encoder<T> encoder(*this, mfa_data, input, verbose);
 
 #ifndef MFA_TMESH           // original adaptive encode for one tensor product
-            encoder.OrigAdaptiveEncode(err_limit, weighted, extents, max_rounds);
+            encoder.OrigAdaptiveEncode(err_limit, weighted, extents, max_rounds, refit_iters, checkpoint);
 #else                       // adaptive encode for tmesh
-            encoder.AdaptiveEncode(err_limit, weighted, extents, max_rounds);
+            encoder.AdaptiveEncode(err_limit, weighted, extents, max_rounds, checkpoint);
 #endif
         }
 
+        // adaptive encode continuing from a checkpoint, if any, and writing new ones
+        // mfa_data is set up as for a new AdaptiveEncode; models are passed in the same order as when checkpointed
+        // does nothing if the model was complete in the checkpoint
+        void ResumeAdaptiveEncode(
+                MFA_Data<T>&            mfa_data,           // mfa data model
+                const PointSet<T>&      input,              // input points
+                T                       err_limit,          // maximum allowable normalized error
+                int                     verbose,            // debug level
+                bool                    weighted,           // solve for and use weights (default = true)
+                const VectorX<T>&       extents,            // extents in each dimension, for normalizing error (size 0 means do not normalize)
+                int                     max_rounds,         // optional maximum number of rounds
+                int                     refit_iters,        // max. iterations of warm-started refit per round (0 = direct solve, single tensor only)
+                AdaptiveCheckpoint<T>&  checkpoint) const   // checkpoint, after checkpoint.Read() to resume
+        {
+            if (checkpoint.Restore(mfa_data))
+            {
+                Encoder<T> encoder(*this, mfa_data, input, verbose);
+                encoder.InputBasisFuns();
+                return;
+            }
+            AdaptiveEncode(mfa_data, input, err_limit, verbose, weighted, extents, max_rounds, refit_iters, &checkpoint);
+        }
+
         // decode values at all input points
         void DecodePointSet(
                 const MFA_Data<T>&  mfa_data,               // mfa data model
@@ -198,6 +239,33 @@ namespace mfa
             decoder.DecodePointSet(output, min_dim, max_dim, derivs);
         }
 
+        // decode value and all partial derivatives up to total order nders at all points of a point set
+        // result columns are ordered by derivative (DersDecodeInfo::ders) and then by coordinate
+        void DecodePointSetDers(
+                const MFA_Data<T>&  mfa_data,               // mfa data model
+                const PointSet<T>&  ps,                     // point set containing parameters to decode at
+                int                 nders,                  // max. total order of derivatives (2 = value, gradient, Hessian)
+                MatrixX<T>&         result,                 // (output) values and derivatives, one row per point
+                int                 verbose) const          // debug level
+        {
+            Decoder<T> decoder(mfa_data, verbose);
+            decoder.DecodePointSetDers(ps, nders, result);
+        }
+
+        // decode value and all partial derivatives up to total order nders on a regular grid in parameter space
+        void DecodeGridDers(
+                const MFA_Data<T>&  mfa_data,               // mfa data model
+                const VectorX<T>&   par_min,                // lower corner of domain in param space
+                const VectorX<T>&   par_max,                // upper corner of domain in param space
+                const VectorXi&     ndom_pts,               // number of points per direction
+                int                 nders,                  // max. total order of derivatives (2 = value, gradient, Hessian)
+                MatrixX<T>&         result,                 // (output) values and derivatives, one row per grid point
+                int                 verbose) const          // debug level
+        {
+            Decoder<T> decoder(mfa_data, verbose);
+            decoder.DecodeGridDers(par_min, par_max, ndom_pts, nders, result);
+        }
+
         // decode value of single point at the given parameter location
         void DecodePt(
                 const MFA_Data<T>&  mfa_data,               // mfa data model
@@ -239,6 +307,47 @@ namespace mfa
             decoder.DecodeGrid(result, min_dim, max_dim, par_min, par_max, ndom_pts);
         }
 
+        // decode points on grid in parameter space in tiles of at most max_bytes of values,
+        // handing each tile to sink(size_t first, const MatrixX<T>& values) instead of keeping the grid
+        // see Decoder::DecodeGridTiled
+        template <typename Sink>
+        void DecodeAtGridTiled( const MFA_Data<T>&      mfa_data,               // mfa_data
+                                const VectorX<T>&       par_min,                // lower corner of domain in param space
+                                const VectorX<T>&       par_max,                // upper corner of domain in param space
+                                const VectorXi&         ndom_pts,               // number of points per direction
+                                size_t                  max_bytes,              // memory budget for the values of one tile
+                                Sink&                   sink)                   // consumer of decoded tiles
+        {
+            int verbose = 0;
+            Decoder<T> decoder(mfa_data, verbose);
+            decoder.DecodeGridTiled(par_min, par_max, ndom_pts, max_bytes, sink);
+        }
+
+        // exact integral of the model over a box in parameter space, without decoding any points
+        // optionally also the integral of the square, for second moments (variance = sq_integral / vol - mean^2)
+        // integrals are with respect to the parameters; multiply by the product of the domain extents for domain coordinates
+        void Integrate(
+                const MFA_Data<T>&  mfa_data,               // mfa data model
+                const VectorX<T>&   box_min,                // lower corner of box in param space
+                const VectorX<T>&   box_max,                // upper corner of box in param space
+                VectorX<T>&         integral,               // (output) integral of each coordinate of the model
+                VectorX<T>*         sq_integral = NULL,     // (output, optional) integral of the square of each coordinate
+                int                 verbose = 0) const      // debug level
+        {
+            Decoder<T> decoder(mfa_data, verbose);
+            decoder.Integrate(box_min, box_max, integral, sq_integral);
+        }
+
+        // critical points (zero gradient) of the last coordinate of the model, located and classified in parameter space
+        void CriticalPoints(
+                const MFA_Data<T>&          mfa_data,       // mfa data model
+                vector<CriticalPoint<T>>&   cps,            // (output) critical points
+                int                         verbose = 0) const  // debug level
+        {
+            Decoder<T> decoder(mfa_data, verbose);
+            decoder.CriticalPoints(cps);
+        }
+
         // compute the error (absolute value of coordinate-wise difference) of the mfa at a domain point
         // error is not normalized by the data range (absolute, not relative error)
         void AbsCoordError(
@@ -311,56 +420,482 @@ namespace mfa
                 exit(1);
             }
 
-#ifdef MFA_SERIAL
+            vector<ErrorStats<T>>   stats;
+            VectorX<T>              no_extents;         // size 0 means do not normalize
+            PointSetErrorStats(base, vars, stats, no_extents, nullptr, nullptr, &error, false, verbose);
+        }
+
+        // decodes the models at every input point, subtracts the input, and accumulates error statistics
+        // in a single streaming pass with thread-local reductions
+        // decoded points and errors are stored only if requested, otherwise memory is not allocated for them
+        void PointSetErrorStats(
+            const   mfa::PointSet<T>&       base,           // input points
+                    vector<Model<T>>&       vars,           // science variable models
+                    vector<ErrorStats<T>>&  stats,          // (output) error statistics for each science coordinate (pt_dim - dom_dim)
+            const   VectorX<T>&             extents,        // extent of each science coordinate for normalizing error (size 0 means do not normalize)
+            const   Model<T>*               geometry,       // geometry model, decoded only when approx is requested (nullptr = copy input geometry)
+                    mfa::PointSet<T>*       approx,         // (output, optional) decoded points, nullptr to skip
+                    mfa::PointSet<T>*       error,          // (output, optional) absolute errors, nullptr to skip
+                    bool                    saved_basis,    // whether basis functions were saved and can be reused
+                    int                     verbose)        // debug level
+        {
+            if ((approx && !base.is_same_layout(*approx)) || (error && !base.is_same_layout(*error)))
+            {
+                cerr << "ERROR: Incompatible PointSets in PointSetErrorStats" << endl;
+                exit(1);
+            }
+#ifdef MFA_TMESH
+            saved_basis = false;
+#endif
+            if (saved_basis && !base.structured)
+                saved_basis = false;
+
+            int nsci = base.pt_dim - dom_dim;
+            stats.assign(nsci, ErrorStats<T>());
+            if (!vars.size())
+                return;
+
+            // one decoder per model, shared by all threads; model 0 is the geometry if decoded
+            vector<const Model<T>*>         models;
+            if (approx && geometry)
+                models.push_back(geometry);
+            for (auto k = 0; k < vars.size(); k++)
+                models.push_back(&vars[k]);
+            vector<Decoder<T>>              decoders;
+            decoders.reserve(models.size());
+            for (auto k = 0; k < models.size(); k++)
+                decoders.emplace_back(*models[k]->mfa_data, verbose, saved_basis);
+            VectorXi                        no_derivs;
+
             // copy geometric point coordinates
-            for (size_t i = 0; i < error.npts; i++)
-            {   
-                for (auto j = 0; j < dom_dim; j++)
+            if (error)
+                error->domain.leftCols(dom_dim) = base.domain.leftCols(dom_dim);
+            if (approx && !geometry)
+                approx->domain.leftCols(dom_dim) = base.domain.leftCols(dom_dim);
+
+            // decodes one point of all models and accumulates its errors into local statistics
+            auto decode_pt = [&](typename PointSet<T>::PtIterator&       pt_it,
+                                 vector<DecodeInfo<T>>&                  decode_info,
+                                 vector<ErrorStats<T>>&                  local_stats,
+                                 VectorX<T>&                             param,
+                                 VectorXi&                               ijk,
+                                 VectorX<T>&                             cpt)
+            {
+                size_t i = pt_it.idx();
+                pt_it.params(param);
+                if (saved_basis)
+                    pt_it.ijk(ijk);
+                for (auto k = 0; k < models.size(); k++)
                 {
-                    error.domain(i,j) = base.domain(i,j); // copy the geometric location of each point
-                } 
+                    const Model<T>& m = *models[k];
+                    cpt.resize(m.max_dim - m.min_dim + 1);
+#ifndef MFA_TMESH
+                    if (saved_basis)
+                        decoders[k].VolPt_saved_basis(ijk, param, cpt, decode_info[k], m.mfa_data->tmesh.tensor_prods[0]);
+                    else
+                        decoders[k].VolPt(param, cpt, decode_info[k], m.mfa_data->tmesh.tensor_prods[0], no_derivs);
+#else
+                    decoders[k].VolPt_tmesh(param, cpt);
+#endif
+                    if (approx)
+                        approx->domain.block(i, m.min_dim, 1, cpt.size()) = cpt.transpose();
+                    if (m.min_dim < dom_dim)                // geometry
+                        continue;
+                    for (auto j = 0; j < cpt.size(); j++)
+                    {
+                        int c   = m.min_dim + j;
+                        T   err = fabs(cpt(j) - base.domain(i, c));
+                        if (error)
+                            error->domain(i, c) = err;
+                        ErrorStats<T>& s = local_stats[c - dom_dim];
+                        T norm_err = extents.size() ? err / extents(c - dom_dim) : err;
+                        s.max_abs_err       = std::max(s.max_abs_err, err);
+                        s.max_norm_err      = std::max(s.max_norm_err, norm_err);
+                        s.sum_sq_abs_errs   += err * err;
+                        s.sum_sq_norm_errs  += norm_err * norm_err;
+                    }
+                }
+            };
+
+#ifdef MFA_TBB
+            enumerable_thread_specific<vector<DecodeInfo<T>>> thread_decode_info([&]()
+                    {
+                        vector<DecodeInfo<T>> di;
+                        for (auto k = 0; k < models.size(); k++)
+                            di.emplace_back(*models[k]->mfa_data, no_derivs);
+                        return di;
+                    });
+            enumerable_thread_specific<vector<ErrorStats<T>>> thread_stats(nsci, ErrorStats<T>());
+
+            parallel_for (blocked_range<size_t>(0, base.npts), [&](blocked_range<size_t>& r)
+            {
+                VectorX<T>  param(dom_dim);
+                VectorXi    ijk(dom_dim);
+                VectorX<T>  cpt;
+                vector<DecodeInfo<T>>&  decode_info = thread_decode_info.local();
+                vector<ErrorStats<T>>&  local_stats = thread_stats.local();
+                auto pt_end = base.iterator(r.end());
+                for (auto pt_it = base.iterator(r.begin()); pt_it != pt_end; ++pt_it)
+                    decode_pt(pt_it, decode_info, local_stats, param, ijk, cpt);
+            });
+
+            // combine thread-local statistics
+            for (auto& local_stats : thread_stats)
+                for (auto j = 0; j < nsci; j++)
+                {
+                    stats[j].max_abs_err        = std::max(stats[j].max_abs_err, local_stats[j].max_abs_err);
+                    stats[j].max_norm_err       = std::max(stats[j].max_norm_err, local_stats[j].max_norm_err);
+                    stats[j].sum_sq_abs_errs    += local_stats[j].sum_sq_abs_errs;
+                    stats[j].sum_sq_norm_errs   += local_stats[j].sum_sq_norm_errs;
+                }
+#endif // MFA_TBB
+#ifdef MFA_SERIAL
+            vector<DecodeInfo<T>> decode_info;
+            for (auto k = 0; k < models.size(); k++)
+                decode_info.emplace_back(*models[k]->mfa_data, no_derivs);
+            VectorX<T>  param(dom_dim);
+            VectorXi    ijk(dom_dim);
+            VectorX<T>  cpt;
+            auto pt_end = base.end();
+            for (auto pt_it = base.begin(); pt_it != pt_end; ++pt_it)
+                decode_pt(pt_it, decode_info, stats, param, ijk, cpt);
+#endif // MFA_SERIAL
+        }
+
+        // estimates error statistics from a stratified random sample of the input points, without decoding all of them
+        // strata are boxes of knot spans of the first science variable, coarsened so that the first round
+        // can sample each stratum at least twice
+        // the sample is doubled each round, allocated to strata in proportion to their sizes, until the relative
+        // half-width of the (normal approximation) confidence interval on the RMS error of every science coordinate
+        // is below rel_tol or the sample budget is spent
+        // allocation does not follow the observed deviations because squared errors are heavy-tailed: strata whose
+        // few samples missed rare large errors would stop being sampled, biasing the estimate low
+        // a stratum that would receive at least as many samples as it has points is evaluated exactly
+        // returns the number of points decoded
+        size_t SampledPointSetError(
+            const   mfa::PointSet<T>&       base,           // input points
+                    vector<Model<T>>&       vars,           // science variable models
+                    vector<ErrorStats<T>>&  stats,          // (output) estimated statistics per science coordinate: max errors are
+                                                            // the max. over the sample (lower bounds), sums of squared errors are
+                                                            // estimates of the totals over all input points
+                    vector<T>&              rms_lo,         // (output) lower end of confidence interval on RMS error per science coordinate
+                    vector<T>&              rms_hi,         // (output) upper end of confidence interval on RMS error per science coordinate
+            const   VectorX<T>&             extents,        // extent of each science coordinate for normalizing error (size 0 means do not normalize)
+                    size_t                  budget,         // max. number of points to decode
+                    T                       rel_tol,        // target relative half-width of the confidence interval on RMS error
+                    T                       z,              // standard normal quantile of the confidence level, eg 1.96 for 95%
+                    unsigned                seed,           // random seed
+                    int                     verbose)        // debug level
+        {
+            int     nsci = base.pt_dim - dom_dim;
+            size_t  N    = base.npts;
+            stats.assign(nsci, ErrorStats<T>());
+            rms_lo.assign(nsci, 0.0);
+            rms_hi.assign(nsci, 0.0);
+            if (!vars.size() || !N)
+                return 0;
+            budget = std::max(budget, (size_t)2);
+
+            // stratum boundaries in each dimension: parameter index for structured input, parameter value otherwise
+            const MFA_Data<T>& mfa_data = *vars[0].mfa_data;
+            vector<vector<size_t>>  ibnds(dom_dim);
+            vector<vector<T>>       pbnds(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                const vector<T>& knots = mfa_data.tmesh.all_knots[k];
+                if (base.structured)
+                {
+                    const vector<T>& grid = base.params->param_grid[k];
+                    ibnds[k].push_back(0);
+                    for (auto i = 0; i < knots.size(); i++)
+                    {
+                        size_t idx = lower_bound(grid.begin(), grid.end(), knots[i]) - grid.begin();
+                        if (idx > ibnds[k].back() && idx < grid.size())
+                            ibnds[k].push_back(idx);
+                    }
+                    ibnds[k].push_back(grid.size());
+                }
+                else
+                {
+                    pbnds[k].push_back(knots.front());
+                    for (auto i = 0; i < knots.size(); i++)
+                        if (knots[i] > pbnds[k].back() && knots[i] < knots.back())
+                            pbnds[k].push_back(knots[i]);
+                    pbnds[k].push_back(knots.back());
+                }
             }
 
-            // compute errors for each point and model
-            for (size_t i = 0; i < error.npts; i++)
+            // coarsen the dimension with the most strata until the first round (1/8 of the budget) samples each stratum twice
+            size_t max_strata = std::max(budget / 16, (size_t)1);
+            while (true)
             {
-                VectorX<T> err_vec;                          // errors for all coordinates in current model
-                for (auto k = 0; k < vars.size(); k++)      // for all science models
+                size_t  nstrata = 1;
+                int     kmax    = 0;
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    size_t n    = base.structured ? ibnds[k].size() - 1 : pbnds[k].size() - 1;
+                    size_t nmax = base.structured ? ibnds[kmax].size() - 1 : pbnds[kmax].size() - 1;
+                    nstrata *= n;
+                    if (n > nmax)
+                        kmax = k;
+                }
+                if (nstrata <= max_strata)
+                    break;
+                // keep every other interior boundary
+                if (base.structured)
+                {
+                    vector<size_t>& b = ibnds[kmax];
+                    vector<size_t>  c;
+                    for (auto i = 0; i < b.size(); i += 2)
+                        c.push_back(b[i]);
+                    if (c.back() != b.back())
+                        c.push_back(b.back());
+                    b.swap(c);
+                }
+                else
                 {
-                    err_vec.resize(vars[k].max_dim - vars[k].min_dim);
-                    AbsCoordError(*(vars[k].mfa_data), base, i, err_vec, verbose);
+                    vector<T>& b = pbnds[kmax];
+                    vector<T>  c;
+                    for (auto i = 0; i < b.size(); i += 2)
+                        c.push_back(b[i]);
+                    if (c.back() != b.back())
+                        c.push_back(b.back());
+                    b.swap(c);
+                }
+            }
 
-                    for (auto j = 0; j < err_vec.size(); j++)
+            // strata, numbered with dimension 0 fastest
+            VectorXi nstrata_dim(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+                nstrata_dim(k) = base.structured ? ibnds[k].size() - 1 : pbnds[k].size() - 1;
+            size_t nstrata = nstrata_dim.prod();
+            VolIterator strata_iter(nstrata_dim);
+
+            vector<size_t>  strata_npts(nstrata);               // number of input points in each stratum
+            vector<size_t>  members;                            // unstructured only: input points sorted by stratum
+            vector<size_t>  members_ofst;                       // unstructured only: offset of each stratum in members
+            VectorXi        ijk(dom_dim);
+            if (base.structured)
+            {
+                for (auto h = 0; h < nstrata; h++)
+                {
+                    strata_iter.idx_ijk(h, ijk);
+                    strata_npts[h] = 1;
+                    for (auto k = 0; k < dom_dim; k++)
+                        strata_npts[h] *= ibnds[k][ijk(k) + 1] - ibnds[k][ijk(k)];
+                }
+            }
+            else
+            {
+                // counting sort of the input points by stratum
+                vector<size_t>  pt_stratum(N);
+                VectorX<T>      param(dom_dim);
+                for (auto i = 0; i < N; i++)
+                {
+                    base.pt_params(i, param);
+                    for (auto k = 0; k < dom_dim; k++)
                     {
-                        error.domain(i, vars[k].min_dim + j) = err_vec(j);      // error for each science variable
+                        ijk(k) = upper_bound(pbnds[k].begin(), pbnds[k].end(), param(k)) - pbnds[k].begin() - 1;
+                        ijk(k) = std::min(std::max(ijk(k), 0), nstrata_dim(k) - 1);
                     }
+                    pt_stratum[i] = strata_iter.ijk_idx(ijk);
+                    strata_npts[pt_stratum[i]]++;
                 }
+                members_ofst.resize(nstrata + 1, 0);
+                for (auto h = 0; h < nstrata; h++)
+                    members_ofst[h + 1] = members_ofst[h] + strata_npts[h];
+                members.resize(N);
+                vector<size_t> fill(members_ofst.begin(), members_ofst.end() - 1);
+                for (auto i = 0; i < N; i++)
+                    members[fill[pt_stratum[i]]++] = i;
             }
-#endif // MFA_SERIAL
-#ifdef MFA_TBB
-            parallel_for (size_t(0), (size_t)error.npts, [&] (size_t i)
+
+            // per stratum and science coordinate: sums of squared errors and of their squares
+            vector<size_t>  nsampled(nstrata, 0);
+            vector<bool>    exact(nstrata, false);
+            MatrixX<T>      sum_sq  = MatrixX<T>::Zero(nstrata, nsci);
+            MatrixX<T>      sum_sq2 = MatrixX<T>::Zero(nstrata, nsci);
+            vector<T>       max_err(nsci, 0.0);
+
+            // one decoder per model, shared by all threads
+            vector<Decoder<T>>  decoders;
+            decoders.reserve(vars.size());
+            for (auto k = 0; k < vars.size(); k++)
+                decoders.emplace_back(*vars[k].mfa_data, verbose);
+            VectorXi            no_derivs;
+
+            // stratum and input point index of each sample in the current round
+            vector<size_t>      sample_strata;
+            vector<size_t>      sample_idxs;
+            MatrixX<T>          sample_errs;
+            std::mt19937_64     rng(seed);
+            VolIterator         dom_iter(base.structured ? base.ndom_pts : VectorXi::Ones(dom_dim));
+            size_t              tot_sampled = 0;
+            size_t              round_size = std::max(budget / 8, 2 * nstrata);
+            int                 round = 0;
+
+            while (true)
+            {
+                // allocate the samples of this round to the strata
+                sample_strata.clear();
+                sample_idxs.clear();
+                size_t npts_left = 0;                           // number of input points in strata not yet evaluated exactly
+                for (auto h = 0; h < nstrata; h++)
+                    if (!exact[h])
+                        npts_left += strata_npts[h];
+                for (auto h = 0; h < nstrata; h++)
                 {
-                    for (auto j = 0; j < dom_dim; j++)
+                    if (exact[h] || !strata_npts[h])
+                        continue;
+                    size_t n = ceil(T(round_size) * strata_npts[h] / npts_left);
+                    if (round == 0)
+                        n = std::max(n, (size_t)2);
+                    strata_iter.idx_ijk(h, ijk);
+                    if (nsampled[h] + n >= strata_npts[h])
                     {
-                        error.domain(i,j) = base.domain(i,j); // copy the geometric location of each point
+                        // evaluate the whole stratum
+                        exact[h]            = true;
+                        nsampled[h]         = 0;
+                        sum_sq.row(h).setZero();
+                        sum_sq2.row(h).setZero();
+                        n = strata_npts[h];
                     }
-                });
+                    for (auto s = 0; s < n; s++)
+                    {
+                        size_t idx;
+                        if (base.structured)
+                        {
+                            VectorXi pt_ijk(dom_dim);
+                            size_t   r = exact[h] ? s : 0;
+                            for (auto k = 0; k < dom_dim; k++)
+                            {
+                                size_t npts_k = ibnds[k][ijk(k) + 1] - ibnds[k][ijk(k)];
+                                size_t ofst   = exact[h] ? r % npts_k : std::uniform_int_distribution<size_t>(0, npts_k - 1)(rng);
+                                r /= npts_k;
+                                pt_ijk(k) = ibnds[k][ijk(k)] + ofst;
+                            }
+                            idx = dom_iter.ijk_idx(pt_ijk);
+                        }
+                        else
+                        {
+                            size_t ofst = exact[h] ? s : std::uniform_int_distribution<size_t>(0, strata_npts[h] - 1)(rng);
+                            idx = members[members_ofst[h] + ofst];
+                        }
+                        sample_strata.push_back(h);
+                        sample_idxs.push_back(idx);
+                    }
+                }
 
-            parallel_for (size_t(0), (size_t)error.npts, [&] (size_t i)
+                // decode the samples
+                sample_errs.resize(sample_idxs.size(), nsci);
+                auto decode_pt = [&](size_t s, DecodeInfo<T>& decode_info, size_t k, VectorX<T>& param, VectorX<T>& cpt)
                 {
-                VectorX<T> err_vec;                                 // errors for all coordinates in current model
-                for (auto k = 0; k < vars.size() + 1; k++)      // for all models, geometry + science
+                    size_t i = sample_idxs[s];
+                    const Model<T>& m = vars[k];
+                    base.pt_params(i, param);
+                    cpt.resize(m.max_dim - m.min_dim + 1);
+#ifndef MFA_TMESH
+                    decoders[k].VolPt(param, cpt, decode_info, m.mfa_data->tmesh.tensor_prods[0], no_derivs);
+#else
+                    decoders[k].VolPt_tmesh(param, cpt);
+#endif
+                    for (auto j = 0; j < cpt.size(); j++)
+                        sample_errs(s, m.min_dim + j - dom_dim) = fabs(cpt(j) - base.domain(i, m.min_dim + j));
+                };
+
+#ifdef MFA_TBB
+                enumerable_thread_specific<vector<DecodeInfo<T>>> thread_decode_info([&]()
+                        {
+                            vector<DecodeInfo<T>> di;
+                            for (auto k = 0; k < vars.size(); k++)
+                                di.emplace_back(*vars[k].mfa_data, no_derivs);
+                            return di;
+                        });
+                parallel_for (blocked_range<size_t>(0, sample_idxs.size()), [&](blocked_range<size_t>& r)
                 {
-                    err_vec.resize(vars[k - 1].max_dim - vars[k - 1].min_dim);
-                    AbsCoordError(*(vars[k - 1].mfa_data), base, i, err_vec, verbose);
+                    VectorX<T> param(dom_dim);
+                    VectorX<T> cpt;
+                    vector<DecodeInfo<T>>& decode_info = thread_decode_info.local();
+                    for (auto s = r.begin(); s < r.end(); s++)
+                        for (auto k = 0; k < vars.size(); k++)
+                            decode_pt(s, decode_info[k], k, param, cpt);
+                });
+#endif // MFA_TBB
+#ifdef MFA_SERIAL
+                vector<DecodeInfo<T>> decode_info;
+                for (auto k = 0; k < vars.size(); k++)
+                    decode_info.emplace_back(*vars[k].mfa_data, no_derivs);
+                VectorX<T> param(dom_dim);
+                VectorX<T> cpt;
+                for (auto s = 0; s < sample_idxs.size(); s++)
+                    for (auto k = 0; k < vars.size(); k++)
+                        decode_pt(s, decode_info[k], k, param, cpt);
+#endif // MFA_SERIAL
 
-                    for (auto j = 0; j < err_vec.size(); j++)
+                // accumulate
+                for (auto s = 0; s < sample_idxs.size(); s++)
+                {
+                    size_t h = sample_strata[s];
+                    nsampled[h]++;
+                    for (auto j = 0; j < nsci; j++)
                     {
-                        error.domain(i, vars[k - 1].min_dim + j) = err_vec(j); // error for each science variable
+                        T e2 = sample_errs(s, j) * sample_errs(s, j);
+                        sum_sq(h, j)    += e2;
+                        sum_sq2(h, j)   += e2 * e2;
+                        max_err[j]      = std::max(max_err[j], sample_errs(s, j));
                     }
                 }
-                });
-#endif // MFA_TBB
+                tot_sampled += sample_idxs.size();
+
+                // stratified estimate of the mean squared error and its variance
+                bool converged = true;
+                for (auto j = 0; j < nsci; j++)
+                {
+                    T mean = 0.0, var = 0.0;
+                    for (auto h = 0; h < nstrata; h++)
+                    {
+                        if (!nsampled[h])
+                            continue;
+                        T W     = T(strata_npts[h]) / N;
+                        T m     = sum_sq(h, j) / nsampled[h];
+                        mean    += W * m;
+                        if (!exact[h] && nsampled[h] > 1)
+                        {
+                            T s2    = std::max(sum_sq2(h, j) - nsampled[h] * m * m, T(0.0)) / (nsampled[h] - 1);
+                            var     += W * W * s2 / nsampled[h];
+                        }
+                    }
+                    T half          = z * sqrt(var);
+                    T rms           = sqrt(mean);
+                    rms_lo[j]       = sqrt(std::max(mean - half, T(0.0)));
+                    rms_hi[j]       = sqrt(mean + half);
+                    stats[j].sum_sq_abs_errs = mean * N;
+                    stats[j].max_abs_err     = max_err[j];
+                    if (rms > 0.0 && (rms_hi[j] - rms_lo[j]) / (2.0 * rms) > rel_tol)
+                        converged = false;
+                }
+
+                if (verbose)
+                    fprintf(stderr, "sampled error round %d: %lu points decoded, %lu strata\n", round, tot_sampled, nstrata);
+
+                bool all_exact = true;
+                for (auto h = 0; h < nstrata; h++)
+                    if (!exact[h] && strata_npts[h])
+                        all_exact = false;
+                if (converged || all_exact || tot_sampled >= budget)
+                    break;
+
+                round_size = std::min(tot_sampled, budget - tot_sampled);
+                round++;
+            }
+
+            for (auto j = 0; j < nsci; j++)
+            {
+                T extent = extents.size() ? extents(j) : 1.0;
+                stats[j].max_norm_err       = stats[j].max_abs_err / extent;
+                stats[j].sum_sq_norm_errs   = stats[j].sum_sq_abs_errs / (extent * extent);
+            }
+            return tot_sampled;
         }
     };
 }                                           // namespace
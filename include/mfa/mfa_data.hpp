@@ -126,6 +126,105 @@ namespace mfa
                 max_dim = tmesh_.tensor_prods[0].ctrl_pts.cols() - 1;
         }
 
+        // constructor for the derivative of a solved mfa in one dimension
+        // the derivative of a B-spline is a B-spline of degree p - 1 on the knots without the first and last one, whose
+        // control points are scaled differences of the original control points (P&T eq. 3.8), applied order times
+        // requires a single tensor product with unit weights (the derivative of a rational model is not a B-spline)
+        MFA_Data(
+                const MFA_Data<T>&  src,            // solved mfa to differentiate
+                int                 dim,            // domain dimension of the derivative
+                int                 order) :        // order of the derivative, <= degree in dim
+            dom_dim(src.dom_dim),
+            min_dim(src.min_dim),
+            max_dim(src.max_dim),
+            p(src.p),
+            tmesh(src.dom_dim, src.p, src.min_dim, src.max_dim),
+            max_err(0.0)
+        {
+            if (src.tmesh.tensor_prods.size() != 1)
+            {
+                fprintf(stderr, "Error: MFA_Data derivative constructor only implemented for a single tensor product\n");
+                exit(1);
+            }
+            const TensorProduct<T>& src_t = src.tmesh.tensor_prods[0];
+            if (src_t.weights.size() && (src_t.weights.array() != 1.0).any())
+            {
+                fprintf(stderr, "Error: MFA_Data derivative constructor requires unit weights\n");
+                exit(1);
+            }
+            if (order < 0 || order > src.p(dim))
+            {
+                fprintf(stderr, "Error: MFA_Data derivative constructor: order %d must be between 0 and the degree %d\n",
+                        order, src.p(dim));
+                exit(1);
+            }
+
+            vector<T>   knots       = src.tmesh.all_knots[dim];
+            VectorXi    nctrl_pts   = src_t.nctrl_pts;
+            MatrixX<T>  ctrl_pts    = src_t.ctrl_pts;
+            int         stride      = 1;                // stride of control points in dim
+            for (auto k = 0; k < dim; k++)
+                stride *= nctrl_pts(k);
+
+            for (auto r = 0; r < order; r++)
+            {
+                int         deg = p(dim);
+                VectorXi    new_nctrl_pts = nctrl_pts;
+                new_nctrl_pts(dim)--;
+                MatrixX<T>  diffs(new_nctrl_pts.prod(), ctrl_pts.cols());
+                VolIterator vol_iter(new_nctrl_pts);
+                VectorXi    ijk(dom_dim);
+                while (!vol_iter.done())
+                {
+                    vol_iter.idx_ijk(vol_iter.cur_iter(), ijk);
+                    size_t  src_idx = 0;                // index of ijk in the old control points
+                    size_t  s       = 1;
+                    for (auto k = 0; k < dom_dim; k++)
+                    {
+                        src_idx += ijk(k) * s;
+                        s       *= nctrl_pts(k);
+                    }
+                    int i   = ijk(dim);
+                    T   du  = knots[i + deg + 1] - knots[i + 1];
+                    if (du > 0.0)
+                        diffs.row(vol_iter.cur_iter()) = deg / du * (ctrl_pts.row(src_idx + stride) - ctrl_pts.row(src_idx));
+                    else
+                        diffs.row(vol_iter.cur_iter()).setZero();
+                    vol_iter.incr_iter();
+                }
+                ctrl_pts.swap(diffs);
+                nctrl_pts = new_nctrl_pts;
+                knots.erase(knots.begin());
+                knots.pop_back();
+                p(dim)--;
+            }
+
+            // tmesh with the trimmed knots and one tensor product
+            tmesh.p_ = p;
+            tmesh.all_knots             = src.tmesh.all_knots;
+            tmesh.all_knot_levels       = src.tmesh.all_knot_levels;
+            tmesh.all_knot_param_idxs   = src.tmesh.all_knot_param_idxs;
+            tmesh.all_knots[dim]        = knots;
+            tmesh.all_knot_levels[dim].erase(tmesh.all_knot_levels[dim].begin(), tmesh.all_knot_levels[dim].begin() + order);
+            tmesh.all_knot_levels[dim].resize(knots.size());
+            if (tmesh.all_knot_param_idxs[dim].size())
+            {
+                tmesh.all_knot_param_idxs[dim].erase(tmesh.all_knot_param_idxs[dim].begin(),
+                        tmesh.all_knot_param_idxs[dim].begin() + order);
+                tmesh.all_knot_param_idxs[dim].resize(knots.size());
+            }
+            vector<KnotIdx> knot_mins(dom_dim, 0);
+            vector<KnotIdx> knot_maxs(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+                knot_maxs[k] = tmesh.all_knots[k].size() - 1;
+            tmesh.append_tensor(knot_mins, knot_maxs, 0);
+
+            TensorProduct<T>& t = tmesh.tensor_prods[0];
+            t.nctrl_pts = nctrl_pts;
+            t.ctrl_pts  = ctrl_pts;
+            t.weights   = VectorX<T>::Ones(ctrl_pts.rows());
+        }
+
         // constructor when reading mfa in and knowing nothing about it yet except its degree and dimensionality
         MFA_Data(
                 const VectorXi&     p_,             // polynomial degree in each dimension
@@ -385,15 +484,15 @@ namespace mfa
             // nb. we do not need to zero out the entirety of N, since the existing entries of N 
             //     are never accessed (they are always overwritten first)
             N[0] = 1;   
-			std::cout << "-N size: " << N.size() << std::endl;
-			std::cout << "-p(cur_dim): " << p(cur_dim) << std::endl;
-			std::cout << "-N[0]: " << N[0] << std::endl;
-			std::cout << "-N[1]: " << N[1] << std::endl;
-			std::cout << "-N[2]: " << N[2] << std::endl;
+//			std::cout << "-N size: " << N.size() << std::endl;
+//			std::cout << "-p(cur_dim): " << p(cur_dim) << std::endl;
+//			std::cout << "-N[0]: " << N[0] << std::endl;
+//			std::cout << "-N[1]: " << N[1] << std::endl;
+//			std::cout << "-N[2]: " << N[2] << std::endl;
 
-			std::cout << "-bfi.right.at(0): " << bfi.right.at(0) << std::endl;
-			std::cout << "-bfi.right.at(1): " << bfi.right.at(1) << std::endl;
-			std::cout << "-bfi.right.at(2): " << bfi.right.at(2) << std::endl;
+//			std::cout << "-bfi.right.at(0): " << bfi.right.at(0) << std::endl;
+//			std::cout << "-bfi.right.at(1): " << bfi.right.at(1) << std::endl;
+//			std::cout << "-bfi.right.at(2): " << bfi.right.at(2) << std::endl;
 
             for (int j = 1; j <= p(cur_dim); j++) // p(cur_dim) = 2
             {
@@ -412,12 +511,12 @@ namespace mfa
                 N[j] = saved;
             }
 
-			std::cout << "-after N[0]: " << N[0] << std::endl;
-			std::cout << "-after N[1]: " << N[1] << std::endl;
-			std::cout << "-after N[2]: " << N[2] << std::endl;
-			std::cout << "-after bfi.right.at(0): " << bfi.right.at(0) << std::endl;
-			std::cout << "-after bfi.right.at(1): " << bfi.right.at(1) << std::endl;
-			std::cout << "-after bfi.right.at(2): " << bfi.right.at(2) << std::endl;
+//			std::cout << "-after N[0]: " << N[0] << std::endl;
+//			std::cout << "-after N[1]: " << N[1] << std::endl;
+//			std::cout << "-after N[2]: " << N[2] << std::endl;
+//			std::cout << "-after bfi.right.at(0): " << bfi.right.at(0) << std::endl;
+//			std::cout << "-after bfi.right.at(1): " << bfi.right.at(1) << std::endl;
+//			std::cout << "-after bfi.right.at(2): " << bfi.right.at(2) << std::endl;
 
         }
 
@@ -549,13 +648,13 @@ namespace mfa
             // lower triangle is reciprocal of knot differences
             bfi.ndu[0][0] = 1.0;
 
-			std::cout << "span: " << span << std::endl;
+//			std::cout << "span: " << span << std::endl;
             // fill ndu / compute 0th derivatives
             for (int j = 1; j <= deg; j++)
             {
                 bfi.left[j]  = u - tmesh.all_knots[cur_dim][span + 1 - j];
                 bfi.right[j] = tmesh.all_knots[cur_dim][span + j] - u;
-				std::cout << "u: " << u << ";, v: " << tmesh.all_knots[cur_dim][span + 1 - j] << std::endl;
+//				std::cout << "u: " << u << ";, v: " << tmesh.all_knots[cur_dim][span + 1 - j] << std::endl;
 				// std::cout << "left, right: " << bfi.left[j] << ", " << bfi.right[j] << std::endl;
                 T saved = 0.0;
                 for (int r = 0; r < j; r++)
@@ -569,9 +668,9 @@ namespace mfa
                 }
                 bfi.ndu[j][j] = saved;
             }
-		    std::cout << "ndu[0][0/1/2]: " << bfi.ndu[0][0] << ", " << bfi.ndu[0][1] << ", " << bfi.ndu[0][2] << std::endl;   
-            std::cout << "ndu[1][0/1/2]: " << bfi.ndu[1][0] << ", " << bfi.ndu[1][1] << ", " << bfi.ndu[1][2] << std::endl;   
-            std::cout << "ndu[2][0/1/2]: " << bfi.ndu[2][0] << ", " << bfi.ndu[2][1] << ", " << bfi.ndu[2][2] << std::endl;   
+//		    std::cout << "ndu[0][0/1/2]: " << bfi.ndu[0][0] << ", " << bfi.ndu[0][1] << ", " << bfi.ndu[0][2] << std::endl;   
+//             std::cout << "ndu[1][0/1/2]: " << bfi.ndu[1][0] << ", " << bfi.ndu[1][1] << ", " << bfi.ndu[1][2] << std::endl;   
+//             std::cout << "ndu[2][0/1/2]: " << bfi.ndu[2][0] << ", " << bfi.ndu[2][1] << ", " << bfi.ndu[2][2] << std::endl;   
 
             // Copy 0th derivatives
             for (int j = 0; j <= deg; j++)
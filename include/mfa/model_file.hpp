@@ -0,0 +1,497 @@
+//--------------------------------------------------------------
+// indexed model file with selective loading of blocks and variables
+//
+// layout: a fixed-size header, the sections of every block, and an index at
+// the end of the file with the bounds of each block and the byte extents of
+// its sections:
+//
+//   top            dom_dim, pt_dim, bounds, core, and the geometry model
+//   point sets     input, approx, errs, and the blending output
+//   variable       degree, knots, and control nets of a science variable
+//   tensor         control points and weights of one tensor of a variable
+//
+// the file is written collectively with MPI-IO; a reader opens it with POSIX
+// I/O and reads only the index and the sections that are requested with pread
+//
+// include after block_base.hpp, whose block layout and serialization it uses
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _MODEL_FILE_HPP
+#define _MODEL_FILE_HPP
+
+#include    <diy/mpi/io.hpp>
+
+#include    <fcntl.h>
+#include    <unistd.h>
+#include    <cstring>
+#include    <cstdint>
+#include    <string>
+
+using namespace std;
+
+namespace mfa
+{
+    // byte range of one section in the file
+    struct FileExtent
+    {
+        uint64_t    offset;
+        uint64_t    size;
+
+        FileExtent() : offset(0), size(0)               {}
+    };
+
+    // bounds and section extents of one block
+    template <typename T>                               // float or double
+    struct BlockIndex
+    {
+        int                         gid;
+        int                         dom_dim;
+        int                         pt_dim;
+        VectorX<T>                  core_mins;          // block bounds without ghost
+        VectorX<T>                  core_maxs;
+        VectorX<T>                  bounds_mins;        // block bounds with ghost, full point dimensionality
+        VectorX<T>                  bounds_maxs;
+        FileExtent                  top;                // dimensions, bounds, and geometry
+        FileExtent                  point_sets;         // input, approx, errs, and blending output
+        vector<FileExtent>          vars;               // degree, knots, and control nets of each science variable
+        vector<vector<FileExtent>>  tensors;            // control points and weights of each tensor of each variable
+
+        // block core intersects the box [box_mins, box_maxs]
+        bool Intersects(
+                const VectorX<T>&   box_mins,
+                const VectorX<T>&   box_maxs) const
+        {
+            for (auto i = 0; i < dom_dim; i++)
+                if (core_maxs(i) < box_mins(i) || core_mins(i) > box_maxs(i))
+                    return false;
+            return true;
+        }
+    };
+
+    // fixed-size header at the start of the file
+    struct ModelFileHeader
+    {
+        char        magic[8];                           // "MFAINDEX"
+        uint32_t    version;
+        uint32_t    real_size;                          // sizeof(T) of the writer
+        uint64_t    nblocks;
+        uint64_t    index_offset;                       // extent of the serialized index
+        uint64_t    index_size;
+        double      err_bound;                          // error bound of compressed science variable control points (0 = exact)
+    };
+
+    // section writers and readers, same field order as mfa::save and mfa::load
+
+    template <typename B, typename T>                   // B = block object, T = float or double
+        void save_top(diy::BinaryBuffer& bb, const B* b)
+        {
+            diy::save(bb, b->dom_dim);
+            diy::save(bb, b->pt_dim);
+            diy::save(bb, b->bounds_mins);
+            diy::save(bb, b->bounds_maxs);
+            diy::save(bb, b->core_mins);
+            diy::save(bb, b->core_maxs);
+
+            const MFA_Data<T>& g = *b->geometry.mfa_data;
+            diy::save(bb, g.p);
+            diy::save(bb, g.tmesh.tensor_prods.size());
+            for (const TensorProduct<T>& t: g.tmesh.tensor_prods)
+            {
+                diy::save(bb, t.nctrl_pts);
+                diy::save(bb, t.ctrl_pts);
+                diy::save(bb, t.weights);
+                diy::save(bb, t.knot_mins);
+                diy::save(bb, t.knot_maxs);
+                diy::save(bb, t.level);
+            }
+            diy::save(bb, g.tmesh.all_knots);
+            diy::save(bb, g.tmesh.all_knot_levels);
+        }
+
+    template <typename B, typename T>                   // B = block object, T = float or double
+        void load_top(diy::BinaryBuffer& bb, B* b)
+        {
+            diy::load(bb, b->dom_dim);
+            diy::load(bb, b->pt_dim);
+            b->mfa = new mfa::MFA<T>(b->dom_dim);
+            diy::load(bb, b->bounds_mins);
+            diy::load(bb, b->bounds_maxs);
+            diy::load(bb, b->core_mins);
+            diy::load(bb, b->core_maxs);
+
+            VectorXi    p;
+            size_t      ntensor_prods;
+            diy::load(bb, p);
+            diy::load(bb, ntensor_prods);
+            b->geometry.mfa_data = new mfa::MFA_Data<T>(p, ntensor_prods);
+            for (TensorProduct<T>& t: b->geometry.mfa_data->tmesh.tensor_prods)
+            {
+                diy::load(bb, t.nctrl_pts);
+                diy::load(bb, t.ctrl_pts);
+                diy::load(bb, t.weights);
+                diy::load(bb, t.knot_mins);
+                diy::load(bb, t.knot_maxs);
+                diy::load(bb, t.level);
+            }
+            diy::load(bb, b->geometry.mfa_data->tmesh.all_knots);
+            diy::load(bb, b->geometry.mfa_data->tmesh.all_knot_levels);
+        }
+
+    // structure of a science variable, without its control points
+    template <typename T>                               // float or double
+        void save_var(diy::BinaryBuffer& bb, const MFA_Data<T>& v)
+        {
+            diy::save(bb, v.p);
+            diy::save(bb, v.tmesh.tensor_prods.size());
+            for (const TensorProduct<T>& t: v.tmesh.tensor_prods)
+            {
+                diy::save(bb, t.nctrl_pts);
+                diy::save(bb, t.knot_mins);
+                diy::save(bb, t.knot_maxs);
+                diy::save(bb, t.level);
+            }
+            diy::save(bb, v.tmesh.all_knots);
+            diy::save(bb, v.tmesh.all_knot_levels);
+        }
+
+    template <typename T>                               // float or double
+        MFA_Data<T>* load_var(diy::BinaryBuffer& bb)
+        {
+            VectorXi    p;
+            size_t      ntensor_prods;
+            diy::load(bb, p);
+            diy::load(bb, ntensor_prods);
+            MFA_Data<T>* v = new mfa::MFA_Data<T>(p, ntensor_prods);
+            for (TensorProduct<T>& t: v->tmesh.tensor_prods)
+            {
+                diy::load(bb, t.nctrl_pts);
+                diy::load(bb, t.knot_mins);
+                diy::load(bb, t.knot_maxs);
+                diy::load(bb, t.level);
+            }
+            diy::load(bb, v->tmesh.all_knots);
+            diy::load(bb, v->tmesh.all_knot_levels);
+            return v;
+        }
+
+    // appends a serialized section to a byte vector and records its extent
+    inline void append_section(
+            vector<char>&       out,                    // sections of this process
+            diy::MemoryBuffer&  bb,                     // serialized section, cleared on return
+            uint64_t            base,                   // file offset of out
+            FileExtent&         extent)                 // (output) extent of the section in the file
+    {
+        extent.offset   = base + out.size();
+        extent.size     = bb.buffer.size();
+        out.insert(out.end(), bb.buffer.begin(), bb.buffer.end());
+        bb.clear();
+    }
+
+    // writes all blocks of all processes to one indexed file
+    // science variable control points are compressed when the blocks' save_err_bound > 0
+    template <typename B, typename T>                   // B = block object, T = float or double
+        void write_indexed(
+                const string&           filename,
+                diy::Master&            master,
+                diy::mpi::communicator& comm)
+        {
+            // serialize local blocks, with extents relative to the start of this process's data
+            vector<char>            data;
+            vector<BlockIndex<T>>   index(master.size());
+            double                  err_bound = 0.0;
+            diy::MemoryBuffer       bb;
+            for (auto i = 0; i < master.size(); i++)
+            {
+                const B*        b   = master.block<B>(i);
+                BlockIndex<T>&  bi  = index[i];
+                bi.gid          = master.gid(i);
+                bi.dom_dim      = b->dom_dim;
+                bi.pt_dim       = b->pt_dim;
+                bi.core_mins    = b->core_mins;
+                bi.core_maxs    = b->core_maxs;
+                bi.bounds_mins  = b->bounds_mins;
+                bi.bounds_maxs  = b->bounds_maxs;
+                err_bound       = b->save_err_bound;
+
+                save_top<B, T>(bb, b);
+                append_section(data, bb, 0, bi.top);
+
+                if (b->save_model_only || b->mem_budget)        // empty point sets
+                {
+                    diy::save(bb, (mfa::PointSet<T>*) nullptr);
+                    diy::save(bb, (mfa::PointSet<T>*) nullptr);
+                    diy::save(bb, (mfa::PointSet<T>*) nullptr);
+                    diy::save(bb, VectorXi());
+                    diy::save(bb, MatrixX<T>());
+                }
+                else
+                {
+                    diy::save(bb, b->input);
+                    diy::save(bb, b->approx);
+                    diy::save(bb, b->errs);
+                    diy::save(bb, b->ndom_outpts);
+                    diy::save(bb, b->blend);
+                }
+                append_section(data, bb, 0, bi.point_sets);
+
+                bi.vars.resize(b->vars.size());
+                bi.tensors.resize(b->vars.size());
+                for (auto j = 0; j < b->vars.size(); j++)
+                {
+                    const MFA_Data<T>& v = *b->vars[j].mfa_data;
+                    save_var(bb, v);
+                    append_section(data, bb, 0, bi.vars[j]);
+                    bi.tensors[j].resize(v.tmesh.tensor_prods.size());
+                    for (auto k = 0; k < v.tmesh.tensor_prods.size(); k++)
+                    {
+                        save_ctrl_pts(bb, v.tmesh.tensor_prods[k], (T)err_bound);
+                        diy::save(bb, v.tmesh.tensor_prods[k].weights);
+                        append_section(data, bb, 0, bi.tensors[j][k]);
+                    }
+                }
+            }
+
+            // offset of this process's data after the header and the data of lower ranks
+            uint64_t local_size = data.size(), end;
+            uint64_t base;
+            diy::mpi::scan(comm, local_size, end, std::plus<uint64_t>());
+            base = sizeof(ModelFileHeader) + end - local_size;
+            for (auto i = 0; i < index.size(); i++)
+            {
+                index[i].top.offset         += base;
+                index[i].point_sets.offset  += base;
+                for (auto j = 0; j < index[i].vars.size(); j++)
+                {
+                    index[i].vars[j].offset += base;
+                    for (auto k = 0; k < index[i].tensors[j].size(); k++)
+                        index[i].tensors[j][k].offset += base;
+                }
+            }
+
+            diy::mpi::io::file out(comm, filename, diy::mpi::io::file::wronly | diy::mpi::io::file::create);
+            out.resize(0);
+            if (data.size())
+                out.write_at(base, &data[0], data.size());
+
+            // gather the index to rank 0, which writes it after all the data, followed by the header
+            diy::MemoryBuffer ib;
+            diy::save(ib, index);
+            vector<vector<char>> all_index;
+            diy::mpi::gather(comm, ib.buffer, all_index, 0);
+            uint64_t data_end = base + local_size;
+            diy::mpi::all_reduce(comm, data_end, data_end, diy::mpi::maximum<uint64_t>());
+            if (comm.rank() == 0)
+            {
+                vector<BlockIndex<T>> global_index, local_index;
+                for (auto r = 0; r < all_index.size(); r++)
+                {
+                    diy::MemoryBuffer rb;
+                    rb.buffer.swap(all_index[r]);
+                    diy::load(rb, local_index);
+                    global_index.insert(global_index.end(), local_index.begin(), local_index.end());
+                }
+                sort(global_index.begin(), global_index.end(),
+                        [](const BlockIndex<T>& a, const BlockIndex<T>& b) { return a.gid < b.gid; });
+                diy::MemoryBuffer gb;
+                diy::save(gb, global_index);
+
+                ModelFileHeader h;
+                memset(&h, 0, sizeof(h));
+                memcpy(h.magic, "MFAINDEX", 8);
+                h.version       = 1;
+                h.real_size     = sizeof(T);
+                h.nblocks       = global_index.size();
+                h.index_offset  = data_end;
+                h.index_size    = gb.buffer.size();
+                h.err_bound     = err_bound;
+                out.write_at(h.index_offset, &gb.buffer[0], gb.buffer.size());
+                out.write_at(0, (const char*)&h, sizeof(h));
+            }
+        }
+
+    // reads selected blocks and variables of an indexed model file with pread
+    template <typename T>                               // float or double
+    class ModelFileReader
+    {
+        int                     fd;
+        ModelFileHeader         header;
+        vector<BlockIndex<T>>   index_;                 // one entry per block, sorted by gid
+        size_t                  nbytes;                 // bytes read so far, including the index
+
+        void Read(uint64_t offset, uint64_t size, vector<char>& buf)
+        {
+            buf.resize(size);
+            size_t done = 0;
+            while (done < size)
+            {
+                ssize_t n = pread(fd, &buf[done], size - done, offset + done);
+                if (n <= 0)
+                {
+                    fprintf(stderr, "Error: ModelFileReader: failed to read %lu bytes at offset %lu\n",
+                            (unsigned long)size, (unsigned long)offset);
+                    exit(1);
+                }
+                done += n;
+            }
+            nbytes += size;
+        }
+
+        ModelFileReader(const ModelFileReader&);
+        ModelFileReader& operator=(const ModelFileReader&);
+
+    public:
+
+        ModelFileReader(const string& filename) :
+            nbytes(0)
+        {
+            fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                fprintf(stderr, "Error: ModelFileReader: unable to open %s\n", filename.c_str());
+                exit(1);
+            }
+            vector<char> buf;
+            Read(0, sizeof(header), buf);
+            memcpy(&header, &buf[0], sizeof(header));
+            if (memcmp(header.magic, "MFAINDEX", 8) || header.version != 1 || header.real_size != sizeof(T))
+            {
+                fprintf(stderr, "Error: ModelFileReader: %s is not an indexed model file of this precision\n",
+                        filename.c_str());
+                exit(1);
+            }
+
+            diy::MemoryBuffer bb;
+            Read(header.index_offset, header.index_size, bb.buffer);
+            diy::load(bb, index_);
+        }
+
+        ~ModelFileReader()                              { close(fd); }
+
+        int                     nblocks() const         { return index_.size(); }
+        const BlockIndex<T>&    index(int i) const      { return index_[i]; }
+        size_t                  bytes_read() const      { return nbytes; }
+
+        // indices of the blocks whose cores intersect a box in the domain
+        vector<int> Blocks(
+                const VectorX<T>&   box_mins,
+                const VectorX<T>&   box_maxs) const
+        {
+            vector<int> blocks;
+            for (auto i = 0; i < index_.size(); i++)
+                if (index_[i].Intersects(box_mins, box_maxs))
+                    blocks.push_back(i);
+            return blocks;
+        }
+
+        // loads block i into an empty block: dimensions, bounds, geometry, and the requested science variables
+        // b->vars holds the requested variables in the order given
+        template <typename B>                           // B = block object
+        void LoadBlock(
+                int                 i,                  // index of the block in the file (not gid)
+                B*                  b,                  // empty block
+                const vector<int>&  vars,               // science variables to load
+                bool                point_sets = false) // also load input, approx, errs, and blending output
+        {
+            const BlockIndex<T>& bi = index_[i];
+            diy::MemoryBuffer bb;
+
+            Read(bi.top.offset, bi.top.size, bb.buffer);
+            load_top<B, T>(bb, b);
+
+            if (point_sets)
+            {
+                bb.clear();
+                Read(bi.point_sets.offset, bi.point_sets.size, bb.buffer);
+                diy::load(bb, b->input);
+                diy::load(bb, b->approx);
+                diy::load(bb, b->errs);
+                diy::load(bb, b->ndom_outpts);
+                diy::load(bb, b->blend);
+            }
+
+            b->vars.resize(vars.size());
+            for (auto j = 0; j < vars.size(); j++)
+            {
+                if (vars[j] < 0 || vars[j] >= bi.vars.size())
+                {
+                    fprintf(stderr, "Error: ModelFileReader::LoadBlock(): block %d has no science variable %d\n",
+                            bi.gid, vars[j]);
+                    exit(1);
+                }
+
+                // the structure and tensors of a variable are contiguous; read them at once
+                const FileExtent&   v       = bi.vars[vars[j]];
+                const FileExtent&   last    = bi.tensors[vars[j]].back();
+                bb.clear();
+                Read(v.offset, last.offset + last.size - v.offset, bb.buffer);
+                b->vars[j].mfa_data = load_var<T>(bb);
+                for (TensorProduct<T>& t: b->vars[j].mfa_data->tmesh.tensor_prods)
+                {
+                    load_ctrl_pts(bb, t, (T)header.err_bound);
+                    diy::load(bb, t.weights);
+                }
+            }
+            b->save_err_bound = header.err_bound;
+        }
+    };
+}
+
+namespace diy
+{
+    template <>
+        struct Serialization<mfa::FileExtent>
+        {
+            static
+                void save(diy::BinaryBuffer& bb, const mfa::FileExtent& e)
+                {
+                    diy::save(bb, e.offset);
+                    diy::save(bb, e.size);
+                }
+            static
+                void load(diy::BinaryBuffer& bb, mfa::FileExtent& e)
+                {
+                    diy::load(bb, e.offset);
+                    diy::load(bb, e.size);
+                }
+        };
+
+    template <typename T>
+        struct Serialization<mfa::BlockIndex<T>>
+        {
+            static
+                void save(diy::BinaryBuffer& bb, const mfa::BlockIndex<T>& bi)
+                {
+                    diy::save(bb, bi.gid);
+                    diy::save(bb, bi.dom_dim);
+                    diy::save(bb, bi.pt_dim);
+                    diy::save(bb, bi.core_mins);
+                    diy::save(bb, bi.core_maxs);
+                    diy::save(bb, bi.bounds_mins);
+                    diy::save(bb, bi.bounds_maxs);
+                    diy::save(bb, bi.top);
+                    diy::save(bb, bi.point_sets);
+                    diy::save(bb, bi.vars);
+                    diy::save(bb, bi.tensors);
+                }
+            static
+                void load(diy::BinaryBuffer& bb, mfa::BlockIndex<T>& bi)
+                {
+                    diy::load(bb, bi.gid);
+                    diy::load(bb, bi.dom_dim);
+                    diy::load(bb, bi.pt_dim);
+                    diy::load(bb, bi.core_mins);
+                    diy::load(bb, bi.core_maxs);
+                    diy::load(bb, bi.bounds_mins);
+                    diy::load(bb, bi.bounds_maxs);
+                    diy::load(bb, bi.top);
+                    diy::load(bb, bi.point_sets);
+                    diy::load(bb, bi.vars);
+                    diy::load(bb, bi.tensors);
+                }
+        };
+}
+
+#endif
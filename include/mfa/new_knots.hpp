@@ -332,6 +332,7 @@ namespace mfa
             error_stats.max_norm_err        = 0.0;
             error_stats.sum_sq_abs_errs     = 0.0;
             error_stats.sum_sq_norm_errs    = 0.0;
+            error_stats.npts_skipped        = 0;
 
             VectorXi            derivs;                             // size 0 means unused
             DecodeInfo<T>       decode_info(mfa_data, derivs);      // reusable decode point info for calling VolPt repeatedly
@@ -541,6 +542,10 @@ namespace mfa
                 // debug
 //                 fmt::print(stderr, "span_iter.tot_iters() = {}\n", span_iter.tot_iters());
 
+#if defined(MFA_ERROR_BOUNDS) && !defined(MFA_TMESH)
+                bool bounds = (t.weights.array() == 1.0).all();         // derivative bounds hold for nonrational models only
+#endif
+
                 // iterate over knot spans
                 while (!span_iter.done())
                 {
@@ -562,6 +567,19 @@ namespace mfa
                     }
                     VolIterator param_iter(sub_npts, sub_starts, all_npts);
 
+#if defined(MFA_ERROR_BOUNDS) && !defined(MFA_TMESH)
+
+                    // skip the span if all its points are proven to be within the error limit
+                    if (bounds && span_within_err_limit(span_ijk, t, param_iter, dom_iter, extents, err_limit,
+                                saved_basis, decoder, decode_info))
+                    {
+                        error_stats.npts_skipped += param_iter.tot_iters();
+                        span_iter.incr_iter();
+                        continue;
+                    }
+
+#endif
+
                     // iterate over input domain points
                     while (!param_iter.done())
                     {
@@ -650,6 +668,135 @@ namespace mfa
             return retval;
         }
 
+        // proves that all input points in one knot span of a single tensor product are within err_limit without decoding them
+        // the model is decoded at the 2^d corners of the box of input points in the span, and inside the box differs from
+        // the multilinear interpolant of the corners by at most sum_k (bounds on d^2/du_k^2) * (u_k - a_k)(b_k - u_k) / 2,
+        // where the second derivatives are bounded by the convex hulls of their control points, ie, scaled second
+        // differences of the control points
+        // valid for nonrational models (unit weights) without a T-mesh
+        // error statistics do not include the points of a span that is proven to be within the limit
+        bool span_within_err_limit(
+                const VectorXi&         span_ijk,       // local indices of knot span in t.knot_idxs in all dims
+                TensorProduct<T>&       t,              // current tensor
+                const VolIterator&      param_iter,     // iterator over the input points in the span
+                const VolIterator&      dom_iter,       // iterator over all input domain points
+                const VectorX<T>&       extents,        // extents in each dimension, for normalizing error
+                T                       err_limit,      // max. allowed error, assumed to be normalized
+                bool                    saved_basis,    // whether basis functions were saved and can be re-used
+                Decoder<T>&             decoder,        // decoder for the corners
+                DecodeInfo<T>&          decode_info)    // decode info for the corners
+        {
+            const VectorXi& p       = mfa_data.p;
+            int             pt_dim  = mfa_data.max_dim - mfa_data.min_dim + 1;
+            size_t          ncorners = 1 << dom_dim;
+            if (param_iter.tot_iters() <= ncorners)        // nothing to save
+                return false;
+
+            // control points influencing the span
+            VectorXi    box_npts(dom_dim);
+            VectorXi    box_starts(dom_dim);
+            VectorXi    ds = VectorXi::Ones(dom_dim);       // strides of control points
+            for (auto j = 0; j < dom_dim; j++)
+            {
+                box_starts(j)   = t.knot_idxs[j][span_ijk(j)] - p(j);
+                box_npts(j)     = p(j) + 1;
+                if (j > 0)
+                    ds(j) = ds(j - 1) * t.nctrl_pts(j - 1);
+            }
+
+            // bounds on the second partial derivatives in the span, zero in dims where p < 2
+            MatrixX<T> d2min = MatrixX<T>::Zero(dom_dim, pt_dim);
+            MatrixX<T> d2max = MatrixX<T>::Zero(dom_dim, pt_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                if (p(k) < 2)
+                    continue;
+                d2min.row(k).setConstant(numeric_limits<T>::max());
+                d2max.row(k).setConstant(-numeric_limits<T>::max());
+                const vector<T>& knots = mfa_data.tmesh.all_knots[k];
+                VectorXi diff_npts = box_npts;
+                diff_npts(k) -= 2;
+                VolIterator diff_iter(diff_npts, box_starts, t.nctrl_pts);
+                while (!diff_iter.done())
+                {
+                    size_t  idx = diff_iter.cur_iter_full();
+                    int     l   = diff_iter.idx_dim(k);
+                    for (auto j = 0; j < pt_dim; j++)
+                    {
+                        T d0 = p(k) * (t.ctrl_pts(idx + ds(k), j) - t.ctrl_pts(idx, j)) / (knots[l + p(k) + 1] - knots[l + 1]);
+                        T d1 = p(k) * (t.ctrl_pts(idx + 2 * ds(k), j) - t.ctrl_pts(idx + ds(k), j)) / (knots[l + p(k) + 2] - knots[l + 2]);
+                        T d2 = (p(k) - 1) * (d1 - d0) / (knots[l + p(k) + 1] - knots[l + 2]);
+                        d2min(k, j) = std::min(d2min(k, j), d2);
+                        d2max(k, j) = std::max(d2max(k, j), d2);
+                    }
+                    diff_iter.incr_iter();
+                }
+            }
+
+            // model at the corners of the box of input points
+            VectorXi    ijk0(dom_dim), ijk1(dom_dim), ijk(dom_dim);
+            VectorX<T>  a(dom_dim), b(dom_dim), param(dom_dim);
+            VectorX<T>  cpt(t.ctrl_pts.cols());
+            MatrixX<T>  corners(ncorners, pt_dim);
+            param_iter.idx_ijk(0, ijk0);
+            param_iter.idx_ijk(param_iter.tot_iters() - 1, ijk1);
+            for (auto j = 0; j < dom_dim; j++)
+            {
+                a(j) = input.params->param_grid[j][ijk0(j)];
+                b(j) = input.params->param_grid[j][ijk1(j)];
+            }
+            for (auto c = 0; c < ncorners; c++)
+            {
+                for (auto j = 0; j < dom_dim; j++)
+                {
+                    ijk(j)      = (c >> j) & 1 ? ijk1(j) : ijk0(j);
+                    param(j)    = (c >> j) & 1 ? b(j) : a(j);
+                }
+                if (saved_basis)
+                    decoder.VolPt_saved_basis(ijk, param, cpt, decode_info, t);
+                else
+                    decoder.VolPt(param, cpt, decode_info, t);
+                corners.row(c) = cpt.head(pt_dim).transpose();
+            }
+
+            // small safety margin for roundoff in the bounds
+            T           limit = err_limit * (1.0 - 1.0e-6);
+            VectorX<T>  s(dom_dim), w(dom_dim);
+            for (auto i = 0; i < param_iter.tot_iters(); i++)
+            {
+                param_iter.idx_ijk(i, ijk);
+                size_t idx = dom_iter.ijk_idx(ijk);
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    T u     = input.params->param_grid[k][ijk(k)];
+                    s(k)    = b(k) > a(k) ? (u - a(k)) / (b(k) - a(k)) : 0.0;
+                    w(k)    = (u - a(k)) * (b(k) - u) / 2.0;
+                }
+                for (auto j = 0; j < pt_dim; j++)
+                {
+                    // multilinear interpolant of the corners minus input value
+                    T lq = 0.0;
+                    for (auto c = 0; c < ncorners; c++)
+                    {
+                        T wc = 1.0;
+                        for (auto k = 0; k < dom_dim; k++)
+                            wc *= (c >> k) & 1 ? s(k) : 1.0 - s(k);
+                        lq += wc * corners(c, j);
+                    }
+                    lq -= input.domain(idx, mfa_data.min_dim + j);
+                    T lo = lq, hi = lq;
+                    for (auto k = 0; k < dom_dim; k++)
+                    {
+                        lo -= d2max(k, j) * w(k);
+                        hi -= d2min(k, j) * w(k);
+                    }
+                    if (std::max(fabs(lo), fabs(hi)) / extents(mfa_data.min_dim + j) > limit)
+                        return false;
+                }
+            }
+            return true;
+        }
+
         // checks whether splitting a knot span will be empty of input points in all dimensions of splitting
         // knot span is the span in the local tensor knot_idxs, not the global all_knot_idxs
         // if the return value is false (an empty, invalid split in all dims), then new_knot_idx and new_knot_val are invalid
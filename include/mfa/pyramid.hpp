@@ -0,0 +1,263 @@
+//--------------------------------------------------------------
+// multiresolution pyramid of a model for level of detail and progressive transmission
+//
+// each coarser level keeps every other interior knot of the next finer level
+// in each dimension, down to a minimum number of control points, so that the
+// knot vectors are nested; its control points are the least-squares
+// projection of the finer level sampled twice in every nonempty knot span,
+// which equals the projection of the original model up to the sampling
+//
+// level 0 is the coarsest; the last level is the original model; every
+// level records its number in the level of its tensor and of its knots, as
+// the T-mesh does for a tensor and the knots that it spans
+//
+// the stream stores the levels coarse to fine, each one an ordinary model, so
+// that a reader can stop after any level and decode it with the Decoder
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _PYRAMID_HPP
+#define _PYRAMID_HPP
+
+#include    <vector>
+#include    <memory>
+#include    <diy/serialization.hpp>
+
+using namespace std;
+
+namespace mfa
+{
+    template <typename T>                               // float or double
+    class ModelPyramid
+    {
+        ModelPyramid(const ModelPyramid&);              // not copyable, owns the levels
+        ModelPyramid& operator=(const ModelPyramid&);
+
+        // parameters sampling a finer level: the ends of the domain and two points in each nonempty knot span
+        static vector<T> SampleParams(const vector<T>& knots)
+        {
+            vector<T> params(1, knots.front());
+            for (auto i = 0; i + 1 < knots.size(); i++)
+            {
+                T du = knots[i + 1] - knots[i];
+                if (du > 0.0)
+                {
+                    params.push_back(knots[i] + 0.25 * du);
+                    params.push_back(knots[i] + 0.75 * du);
+                }
+            }
+            params.push_back(knots.back());
+            return params;
+        }
+
+        // sets the level of the tensor and of all the knots of a model with a single tensor product
+        static void SetLevel(MFA_Data<T>& m, int level)
+        {
+            for (auto k = 0; k < m.dom_dim; k++)
+                m.tmesh.all_knot_levels[k].assign(m.tmesh.all_knots[k].size(), level);
+            m.tmesh.tensor_prods[0].level   = level;
+            m.tmesh.max_level               = level;
+        }
+
+        // least-squares projection of a finer level onto coarser knots
+        static MFA_Data<T>* Coarsen(
+                const MFA<T>&               mfa,
+                const MFA_Data<T>&          fine,
+                const vector<vector<T>>&    knots,      // knots of the coarse level
+                int                         level)      // level of the coarse model
+        {
+            int         dom_dim = fine.dom_dim;
+            VectorXi    nctrl_pts(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+                nctrl_pts(k) = knots[k].size() - fine.p(k) - 1;
+
+            MFA_Data<T>* coarse = new MFA_Data<T>(fine.p, nctrl_pts, fine.min_dim, fine.max_dim);
+            coarse->tmesh.all_knots = knots;
+            vector<KnotIdx> knot_mins(dom_dim, 0);
+            vector<KnotIdx> knot_maxs(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+                knot_maxs[k] = knots[k].size() - 1;
+            coarse->tmesh.append_tensor(knot_mins, knot_maxs);
+            SetLevel(*coarse, level);
+            coarse->N.resize(dom_dim);
+
+            // sample the finer level on a grid of parameters that resolves all of its knot spans
+            shared_ptr<Param<T>> params = make_shared<Param<T>>();
+            params->dom_dim = dom_dim;
+            params->ndom_pts.resize(dom_dim);
+            params->param_grid.resize(dom_dim);
+            for (auto k = 0; k < dom_dim; k++)
+            {
+                params->param_grid[k]   = SampleParams(fine.tmesh.all_knots[k]);
+                params->ndom_pts(k)     = params->param_grid[k].size();
+            }
+            PointSet<T> samples(params, fine.max_dim + 1);
+            samples.domain.setZero();
+            Decoder<T> decoder(fine, 0);
+            decoder.DecodePointSet(samples, fine.min_dim, fine.max_dim);
+
+            TensorProduct<T>& t = coarse->tmesh.tensor_prods[0];
+            Encoder<T> encoder(mfa, *coarse, samples, 0);
+            encoder.Encode(t.nctrl_pts, t.ctrl_pts, t.weights, false);
+            t.weights = VectorX<T>::Ones(t.ctrl_pts.rows());
+            return coarse;
+        }
+
+    public:
+
+        vector<MFA_Data<T>*>    levels;                 // models, coarse to fine
+
+        ModelPyramid()                                  {}
+
+        ~ModelPyramid()
+        {
+            for (auto i = 0; i < levels.size(); i++)
+                delete levels[i];
+        }
+
+        // builds the pyramid of a model with a single tensor product
+        // min_nctrl_pts: minimum number of control points in each dim of the coarsest level (size 0 means p + 1)
+        void Build(
+                const MFA<T>&       mfa,
+                const MFA_Data<T>&  fine,
+                VectorXi            min_nctrl_pts,
+                int                 verbose)
+        {
+            if (fine.tmesh.tensor_prods.size() != 1)
+            {
+                fprintf(stderr, "Error: ModelPyramid only implemented for a single tensor product\n");
+                exit(1);
+            }
+
+            int dom_dim = fine.dom_dim;
+            if (!min_nctrl_pts.size())
+                min_nctrl_pts = fine.p.array() + 1;
+
+            for (auto i = 0; i < levels.size(); i++)
+                delete levels[i];
+            levels.assign(1, new MFA_Data<T>(fine.p, fine.tmesh, fine.min_dim, fine.max_dim));
+
+            // knots of each level, fine to coarse, until none can be removed
+            vector<vector<vector<T>>> knots(1, fine.tmesh.all_knots);
+            while (1)
+            {
+                const vector<vector<T>>& prev = knots.back();
+                vector<vector<T>> next(dom_dim);
+                bool removed = false;
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    int p           = fine.p(k);
+                    int ninterior   = prev[k].size() - 2 * (p + 1);
+                    if (ninterior > 1 && (ninterior + 1) / 2 + p + 1 >= min_nctrl_pts(k))
+                    {
+                        next[k].assign(prev[k].begin(), prev[k].begin() + p + 1);
+                        for (auto i = 0; i < ninterior; i += 2)
+                            next[k].push_back(prev[k][p + 1 + i]);
+                        next[k].insert(next[k].end(), prev[k].end() - p - 1, prev[k].end());
+                        removed = true;
+                    }
+                    else
+                        next[k] = prev[k];
+                }
+                if (!removed)
+                    break;
+                knots.push_back(next);
+            }
+
+            int nlevels = knots.size();
+            SetLevel(*levels[0], nlevels - 1);
+
+            // project each level onto the next coarser one
+            for (auto l = nlevels - 2; l >= 0; l--)
+            {
+                levels.insert(levels.begin(), Coarsen(mfa, *levels.front(), knots[nlevels - 1 - l], l));
+                if (verbose)
+                    fprintf(stderr, "ModelPyramid: level %d has %ld control points\n",
+                            l, levels.front()->tmesh.tensor_prods[0].ctrl_pts.rows());
+            }
+        }
+
+        // appends one level to a stream
+        static void SaveLevel(diy::BinaryBuffer& bb, const MFA_Data<T>& m)
+        {
+            diy::save(bb, m.dom_dim);
+            diy::save(bb, m.p.data(), m.dom_dim);
+            diy::save(bb, m.min_dim);
+            diy::save(bb, m.max_dim);
+            diy::save(bb, m.tmesh.tensor_prods.size());
+            for (const TensorProduct<T>& t: m.tmesh.tensor_prods)
+            {
+                diy::save(bb, t.nctrl_pts.data(), m.dom_dim);
+                diy::save(bb, t.ctrl_pts.rows());
+                diy::save(bb, t.ctrl_pts.cols());
+                diy::save(bb, t.ctrl_pts.data(), t.ctrl_pts.size());
+                diy::save(bb, t.weights.size());
+                diy::save(bb, t.weights.data(), t.weights.size());
+                diy::save(bb, t.knot_mins);
+                diy::save(bb, t.knot_maxs);
+                diy::save(bb, t.level);
+            }
+            diy::save(bb, m.tmesh.all_knots);
+            diy::save(bb, m.tmesh.all_knot_levels);
+        }
+
+        // reads the next level of a stream
+        static MFA_Data<T>* LoadLevel(diy::BinaryBuffer& bb)
+        {
+            int             dom_dim, min_dim, max_dim;
+            size_t          ntensor_prods;
+            Eigen::Index    rows, cols;
+            diy::load(bb, dom_dim);
+            VectorXi p(dom_dim);
+            diy::load(bb, p.data(), dom_dim);
+            diy::load(bb, min_dim);
+            diy::load(bb, max_dim);
+            diy::load(bb, ntensor_prods);
+            MFA_Data<T>* m = new MFA_Data<T>(p, ntensor_prods, min_dim, max_dim);
+            for (TensorProduct<T>& t: m->tmesh.tensor_prods)
+            {
+                t.nctrl_pts.resize(dom_dim);
+                diy::load(bb, t.nctrl_pts.data(), dom_dim);
+                diy::load(bb, rows);
+                diy::load(bb, cols);
+                t.ctrl_pts.resize(rows, cols);
+                diy::load(bb, t.ctrl_pts.data(), t.ctrl_pts.size());
+                diy::load(bb, rows);
+                t.weights.resize(rows);
+                diy::load(bb, t.weights.data(), rows);
+                diy::load(bb, t.knot_mins);
+                diy::load(bb, t.knot_maxs);
+                diy::load(bb, t.level);
+            }
+            diy::load(bb, m->tmesh.all_knots);
+            diy::load(bb, m->tmesh.all_knot_levels);
+            return m;
+        }
+
+        // writes the number of levels and the levels, coarse to fine
+        void Save(diy::BinaryBuffer& bb) const
+        {
+            diy::save(bb, levels.size());
+            for (auto i = 0; i < levels.size(); i++)
+                SaveLevel(bb, *levels[i]);
+        }
+
+        // reads the first max_levels levels of a stream (all if max_levels < 0)
+        // returns the number of levels in the stream
+        size_t Load(diy::BinaryBuffer& bb, int max_levels = -1)
+        {
+            size_t nlevels;
+            diy::load(bb, nlevels);
+            for (auto i = 0; i < levels.size(); i++)
+                delete levels[i];
+            levels.clear();
+            for (auto i = 0; i < nlevels && (max_levels < 0 || i < max_levels); i++)
+                levels.push_back(LoadLevel(bb));
+            return nlevels;
+        }
+    };
+}
+
+#endif
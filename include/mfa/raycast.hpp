@@ -0,0 +1,342 @@
+//--------------------------------------------------------------
+// volume ray casting directly from an mfa
+//
+// orthographic rays are marched from knot span to knot span; spans whose
+// control point bounds map to zero opacity in the transfer function are
+// skipped without decoding, and the remaining spans are sampled at a fixed
+// spacing with span hints carried along the ray
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _RAYCAST_HPP
+#define _RAYCAST_HPP
+
+#include    <vector>
+#include    <array>
+#include    <cmath>
+#include    <algorithm>
+#include    <fstream>
+
+using namespace std;
+
+namespace mfa
+{
+    // piecewise linear map from values to color and opacity (per unit length)
+    template <typename T>                               // float or double
+    class TransferFunction
+    {
+        vector<T>           vals;                       // sorted values of the control points
+        vector<array<T, 4>> rgba;                       // color and opacity at each value
+
+    public:
+
+        void AddPoint(T val, T r, T g, T b, T a)
+        {
+            auto it = upper_bound(vals.begin(), vals.end(), val);
+            size_t i = it - vals.begin();
+            vals.insert(it, val);
+            array<T, 4> c = {{r, g, b, a}};
+            rgba.insert(rgba.begin() + i, c);
+        }
+
+        bool empty() const                              { return vals.empty(); }
+
+        // color and opacity at a value, clamped to the ends
+        void Lookup(T v, T* out) const
+        {
+            size_t i = upper_bound(vals.begin(), vals.end(), v) - vals.begin();
+            if (i == 0 || i == vals.size())
+            {
+                const array<T, 4>& c = rgba[i == 0 ? 0 : vals.size() - 1];
+                for (auto j = 0; j < 4; j++)
+                    out[j] = c[j];
+                return;
+            }
+            T s = (v - vals[i - 1]) / (vals[i] - vals[i - 1]);
+            for (auto j = 0; j < 4; j++)
+                out[j] = (1.0 - s) * rgba[i - 1][j] + s * rgba[i][j];
+        }
+
+        // max. opacity over the values [lo, hi]
+        T MaxOpacity(T lo, T hi) const
+        {
+            T c[4];
+            Lookup(lo, c);
+            T a = c[3];
+            Lookup(hi, c);
+            a = std::max(a, c[3]);
+            for (auto i = 0; i < vals.size(); i++)
+                if (vals[i] > lo && vals[i] < hi)
+                    a = std::max(a, rgba[i][3]);
+            return a;
+        }
+    };
+
+    // orthographic camera
+    template <typename T>                               // float or double
+    struct Camera
+    {
+        VectorX<T>          center;                     // center of the image plane, domain coordinates
+        VectorX<T>          dir;                        // unit viewing direction, into the scene
+        VectorX<T>          up;                         // unit up direction, orthogonal to dir
+        T                   width;                      // width of the image plane in domain units
+        T                   height;                     // height of the image plane in domain units
+        int                 nx;                         // image width in pixels
+        int                 ny;                         // image height in pixels
+
+        // ray through the center of pixel (i, j), j = 0 at the bottom; origin is on the image plane
+        void Ray(int i, int j, VectorX<T>& o) const
+        {
+            VectorX<T> right(3);
+            right << dir(1) * up(2) - dir(2) * up(1), dir(2) * up(0) - dir(0) * up(2), dir(0) * up(1) - dir(1) * up(0);
+            o = center + ((i + 0.5) / nx - 0.5) * width * right + ((j + 0.5) / ny - 0.5) * height * up;
+        }
+    };
+
+    // rows [y0, y1) of an RGBA image with premultiplied colors
+    template <typename T>                               // float or double
+    struct Image
+    {
+        int                 nx;                         // full image width
+        int                 ny;                         // full image height
+        int                 y0;                         // first row held
+        int                 y1;                         // one past the last row held
+        T                   depth;                      // depth of the rendered region along the view direction, for compositing
+        vector<float>       rgba;                       // 4 values per pixel, row major from row y0
+
+        Image() : nx(0), ny(0), y0(0), y1(0), depth(0.0)    {}
+
+        // clears to a transparent full image
+        void Init(int nx_, int ny_)
+        {
+            nx      = nx_;
+            ny      = ny_;
+            y0      = 0;
+            y1      = ny_;
+            rgba.assign((size_t)nx * ny * 4, 0.0f);
+        }
+
+        float* Pixel(int i, int j)                      { return &rgba[((size_t)(j - y0) * nx + i) * 4]; }
+
+        // composites an image behind this one over the same rows
+        void Over(const vector<float>& behind)
+        {
+            for (size_t i = 0; i < rgba.size(); i += 4)
+            {
+                float t = 1.0f - rgba[i + 3];
+                for (auto j = 0; j < 4; j++)
+                    rgba[i + j] += t * behind[i + j];
+            }
+        }
+
+        // writes a binary PPM over a background color; requires the full image
+        void WritePPM(const string& filename, T bg_r = 0.0, T bg_g = 0.0, T bg_b = 0.0) const
+        {
+            if (y0 != 0 || y1 != ny)
+            {
+                fprintf(stderr, "Error: Image::WritePPM() needs the full image\n");
+                exit(1);
+            }
+            ofstream out(filename.c_str(), ios::binary);
+            if (!out)
+            {
+                fprintf(stderr, "Error: Image::WritePPM() unable to open %s\n", filename.c_str());
+                exit(1);
+            }
+            out << "P6\n" << nx << " " << ny << "\n255\n";
+            T bg[3] = {bg_r, bg_g, bg_b};
+            vector<unsigned char> row(nx * 3);
+            for (auto j = ny - 1; j >= 0; j--)
+            {
+                for (auto i = 0; i < nx; i++)
+                {
+                    const float* p = &rgba[((size_t)j * nx + i) * 4];
+                    for (auto c = 0; c < 3; c++)
+                    {
+                        T v = p[c] + (1.0 - p[3]) * bg[c];
+                        row[i * 3 + c] = (unsigned char)std::min(T(255.0), std::max(T(0.0), T(255.0) * v + T(0.5)));
+                    }
+                }
+                out.write((char*)&row[0], row.size());
+            }
+        }
+    };
+
+    template <typename T>                               // float or double
+    class RayCaster
+    {
+        const MFA_Data<T>&          mfa_data;           // the mfa data model
+        const TransferFunction<T>&  tf;
+        int                         col;                // column of the control points to render
+        VectorX<T>                  dom_mins;           // domain extents of the model
+        VectorX<T>                  dom_maxs;
+        SpanBoundsIndex<T>          index;
+
+    public:
+
+        RayCaster(
+                const MFA_Data<T>&          mfa_data_,  // MFA data model, 3-d domain
+                const TransferFunction<T>&  tf_,        // transfer function
+                const VectorX<T>&           dom_mins_,  // min. corner of the model domain, mapped linearly to parameter space
+                const VectorX<T>&           dom_maxs_,  // max. corner of the model domain
+                int                         col_ = -1) :    // column of control points to render (-1 = last, ie, the science variable)
+            mfa_data(mfa_data_),
+            tf(tf_),
+            col(col_ < 0 ? mfa_data_.tmesh.tensor_prods[0].ctrl_pts.cols() - 1 : col_),
+            dom_mins(dom_mins_),
+            dom_maxs(dom_maxs_),
+            index(mfa_data_, col_)
+        {
+            if (mfa_data.dom_dim != 3)
+            {
+                fprintf(stderr, "Error: RayCaster only implemented for 3-d domains\n");
+                exit(1);
+            }
+        }
+
+        // renders the part of the model inside [box_min, box_max] into img, which is cleared unless it already holds the full image
+        // samples are at multiples of step from the image plane, so that renderings of adjoining boxes composite seamlessly
+        // returns the number of samples decoded
+        size_t Render(
+                const Camera<T>&    cam,                // camera
+                const VectorX<T>&   box_min,            // min. corner of region to render, domain coordinates
+                const VectorX<T>&   box_max,            // max. corner of region to render
+                T                   step,               // sample spacing along rays, domain units
+                Image<T>&           img,                // (output) image
+                int                 tile = 16,          // tile size in pixels, unit of parallel work
+                int                 verbose = 0)        // debug level
+        {
+            if (img.nx != cam.nx || img.ny != cam.ny || img.y0 != 0 || img.y1 != cam.ny)
+                img.Init(cam.nx, cam.ny);
+            VectorX<T> lo = box_min.cwiseMax(dom_mins);
+            VectorX<T> hi = box_max.cwiseMin(dom_maxs);
+            int ntx = (cam.nx + tile - 1) / tile;
+            int nty = (cam.ny + tile - 1) / tile;
+            vector<const MFA_Data<T>*> models(1, &mfa_data);
+            VectorField<T> field(models);
+            vector<size_t> ndecoded(ntx * nty, 0), nskipped(ntx * nty, 0);
+
+            auto render_tile = [&](int t, VectorField<T>& f)
+            {
+                int i0 = (t % ntx) * tile, j0 = (t / ntx) * tile;
+                for (auto j = j0; j < std::min(j0 + tile, cam.ny); j++)
+                    for (auto i = i0; i < std::min(i0 + tile, cam.nx); i++)
+                        CastRay(cam, i, j, lo, hi, step, f, img.Pixel(i, j), ndecoded[t], nskipped[t]);
+            };
+
+#ifdef MFA_TBB
+            enumerable_thread_specific<VectorField<T>> thread_field(field);    // each thread has its own span hints
+            parallel_for (0, ntx * nty, [&] (int t)
+            {
+                render_tile(t, thread_field.local());
+            });
+#endif
+#ifdef MFA_SERIAL
+            for (auto t = 0; t < ntx * nty; t++)
+                render_tile(t, field);
+#endif
+
+            size_t tot_decoded = 0, tot_skipped = 0;
+            for (auto t = 0; t < ndecoded.size(); t++)
+            {
+                tot_decoded += ndecoded[t];
+                tot_skipped += nskipped[t];
+            }
+            if (verbose)
+                fprintf(stderr, "RayCaster: %d x %d rays, %lu samples decoded, %lu transparent spans skipped\n",
+                        cam.nx, cam.ny, tot_decoded, tot_skipped);
+            return tot_decoded;
+        }
+
+    private:
+
+        // marches one ray front to back, accumulating premultiplied color into pix
+        void CastRay(
+                const Camera<T>&    cam,
+                int                 i,                  // pixel column
+                int                 j,                  // pixel row
+                const VectorX<T>&   lo,                 // min. corner of region
+                const VectorX<T>&   hi,                 // max. corner of region
+                T                   step,               // sample spacing
+                VectorField<T>&     field,              // evaluator with span hints
+                float*              pix,                // (output) pixel
+                size_t&             ndecoded,           // (output, accumulated) samples decoded
+                size_t&             nskipped)           // (output, accumulated) spans skipped
+        {
+            VectorX<T> o(3), x(3), u(3), du(3), v;
+            cam.Ray(i, j, o);
+
+            // clip the ray to the region
+            T t0 = -numeric_limits<T>::max(), t1 = numeric_limits<T>::max();
+            for (auto k = 0; k < 3; k++)
+            {
+                du(k) = cam.dir(k) / (dom_maxs(k) - dom_mins(k));
+                if (cam.dir(k) == 0.0)
+                {
+                    if (o(k) < lo(k) || o(k) > hi(k))
+                        return;
+                    continue;
+                }
+                T a = (lo(k) - o(k)) / cam.dir(k);
+                T b = (hi(k) - o(k)) / cam.dir(k);
+                t0 = std::max(t0, std::min(a, b));
+                t1 = std::min(t1, std::max(a, b));
+            }
+            if (t0 >= t1)
+                return;
+
+            T   color[4], acc[4] = {0.0, 0.0, 0.0, 0.0};
+            T   span_min, span_max;
+            long n = ceil(t0 / step);                // sample n is at n * step; samples are half open, [t0, t1)
+            while (n * step < t1 && acc[3] < 0.99)
+            {
+                T t = n * step;
+                x = o + t * cam.dir;
+                u = ((x - dom_mins).array() / (dom_maxs - dom_mins).array()).cwiseMax(0.0).cwiseMin(1.0);
+                const VectorXi& span = field.Spans(u);
+
+                // where the ray leaves the span
+                T t_exit = t1;
+                for (auto k = 0; k < 3; k++)
+                {
+                    const vector<T>& U = mfa_data.tmesh.all_knots[k];
+                    if (du(k) > 0.0)
+                        t_exit = std::min(t_exit, t + (U[span(k) + 1] - u(k)) / du(k));
+                    else if (du(k) < 0.0)
+                        t_exit = std::min(t_exit, t + (U[span(k)] - u(k)) / du(k));
+                }
+
+                // skip transparent spans
+                index.SpanBounds(span, span_min, span_max);
+                if (tf.MaxOpacity(span_min, span_max) <= 0.0)
+                {
+                    nskipped++;
+                    n = std::max((long)ceil(t_exit / step), n + 1);
+                    continue;
+                }
+
+                // sample the span front to back, at least once
+                do
+                {
+                    x = o + n * step * cam.dir;
+                    u = ((x - dom_mins).array() / (dom_maxs - dom_mins).array()).cwiseMax(0.0).cwiseMin(1.0);
+                    field.Eval(u, v);
+                    ndecoded++;
+                    tf.Lookup(v(col), color);
+                    T alpha = 1.0 - exp(-color[3] * step);
+                    T w     = (1.0 - acc[3]) * alpha;
+                    for (auto c = 0; c < 3; c++)
+                        acc[c] += w * color[c];
+                    acc[3] += w;
+                    n++;
+                } while (n * step < t_exit && acc[3] < 0.99);
+            }
+            for (auto c = 0; c < 4; c++)
+                pix[c] = acc[c];
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,315 @@
+//--------------------------------------------------------------
+// compressed sequence of models of a time series sharing the same knots
+//
+// every key_interval steps the control points are stored as a keyframe,
+// compressed on their own; the other steps store the difference from the
+// reconstructed control points of the previous step, so that quantization
+// errors do not accumulate along the sequence; both are error-bounded and
+// entropy coded by CtrlPtCodec
+//
+// a delta step keeps the smallest of three predictions for each tensor:
+// neighbors in the same step only, the previous step only, or the previous
+// step corrected by neighbors (small changes favor the second, smooth
+// changes the third, and large changes the first)
+//
+// decoding step k starts from the nearest keyframe at or before k
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _SEQUENCE_HPP
+#define _SEQUENCE_HPP
+
+#include    <vector>
+#include    <diy/serialization.hpp>
+
+using namespace std;
+
+namespace mfa
+{
+    // prediction of the control points of one tensor in one step
+    enum SequencePredictor
+    {
+        SEQ_SPATIAL,                                    // neighbors in the control net (keyframes)
+        SEQ_TEMPORAL,                                   // same control point in the previous step
+        SEQ_TEMPORAL_SPATIAL,                           // previous step, corrected by the neighbors' differences
+    };
+
+    template <typename T>                               // float or double
+    class ModelSequence
+    {
+        T                               err_bound;      // absolute error bound on every control point (> 0)
+        int                             key_interval;   // number of steps from one keyframe to the next
+        MFA_Data<T>*                    ref;            // degree, knots, and control nets of the first step (no control points)
+        vector<vector<unsigned char>>   frames;         // compressed control points and weights of each step
+        vector<MatrixX<T>>              last;           // reconstructed control points of the last step, per tensor
+
+        ModelSequence(const ModelSequence&);            // not copyable, owns ref
+        ModelSequence& operator=(const ModelSequence&);
+
+        // the structure of a step must match the first one
+        void CheckStructure(const MFA_Data<T>& mfa_data) const
+        {
+            bool same = mfa_data.p.size() == ref->p.size() && mfa_data.p == ref->p &&
+                mfa_data.tmesh.tensor_prods.size() == ref->tmesh.tensor_prods.size() &&
+                mfa_data.tmesh.all_knots == ref->tmesh.all_knots;
+            for (auto i = 0; same && i < ref->tmesh.tensor_prods.size(); i++)
+                same = mfa_data.tmesh.tensor_prods[i].nctrl_pts == ref->tmesh.tensor_prods[i].nctrl_pts;
+            if (!same)
+            {
+                fprintf(stderr, "Error: ModelSequence::Append(): step %lu does not have the degree, knots, and control nets of step 0\n",
+                        frames.size());
+                exit(1);
+            }
+        }
+
+        // decodes one step, using prev as the previous step unless it is a keyframe
+        void DecodeFrame(
+                int                         k,          // step
+                const vector<MatrixX<T>>&   prev,       // reconstructed control points of step k - 1, per tensor
+                vector<MatrixX<T>>&         ctrl_pts,   // (output) control points, per tensor
+                vector<VectorX<T>>*         weights) const  // (output, optional) weights, per tensor
+        {
+            const unsigned char* in     = frames[k].empty() ? NULL : &frames[k][0];
+            const unsigned char* end    = in + frames[k].size();
+
+            ctrl_pts.resize(ref->tmesh.tensor_prods.size());
+            if (weights)
+                weights->resize(ref->tmesh.tensor_prods.size());
+            for (auto i = 0; i < ref->tmesh.tensor_prods.size(); i++)
+            {
+                const TensorProduct<T>& t = ref->tmesh.tensor_prods[i];
+
+                // weights are stored exactly, unless they are all 1
+                size_t  npts    = t.nctrl_pts.prod();
+                int     ncols   = GetVarint(in, end);
+                int     pred    = *in++;
+                bool    unit    = *in++;
+                if (weights)
+                {
+                    if (unit)
+                        (*weights)[i] = VectorX<T>::Ones(npts);
+                    else
+                    {
+                        (*weights)[i].resize(npts);
+                        memcpy((*weights)[i].data(), in, npts * sizeof(T));
+                    }
+                }
+                if (!unit)
+                    in += npts * sizeof(T);
+
+                CtrlPtCodec<T>::Decompress(in, end, t.nctrl_pts, ncols, err_bound, ctrl_pts[i],
+                        pred == SEQ_SPATIAL ? NULL : &prev[i], pred != SEQ_TEMPORAL);
+            }
+        }
+
+    public:
+
+        ModelSequence(
+                T       err_bound_      = 1e-6,         // absolute error bound on every control point (> 0)
+                int     key_interval_   = 16) :         // number of steps from one keyframe to the next
+            err_bound(err_bound_),
+            key_interval(key_interval_),
+            ref(NULL)
+        {
+            if (err_bound <= 0.0 || key_interval < 1)
+            {
+                fprintf(stderr, "Error: ModelSequence needs err_bound > 0 and key_interval >= 1\n");
+                exit(1);
+            }
+        }
+
+        ~ModelSequence()                                { delete ref; }
+
+        int     size() const                            { return frames.size(); }
+        bool    IsKeyframe(int k) const                 { return k % key_interval == 0; }
+
+        // total size of the compressed steps in bytes
+        size_t nbytes() const
+        {
+            size_t n = 0;
+            for (auto i = 0; i < frames.size(); i++)
+                n += frames[i].size();
+            return n;
+        }
+
+        // compresses the next step
+        void Append(const MFA_Data<T>& mfa_data)
+        {
+            if (!ref)                                   // copy the structure of the first step
+            {
+                ref = new MFA_Data<T>(mfa_data.p, mfa_data.tmesh.tensor_prods.size(), mfa_data.min_dim, mfa_data.max_dim);
+                for (auto i = 0; i < mfa_data.tmesh.tensor_prods.size(); i++)
+                {
+                    const TensorProduct<T>& src = mfa_data.tmesh.tensor_prods[i];
+                    TensorProduct<T>&       dst = ref->tmesh.tensor_prods[i];
+                    dst.nctrl_pts   = src.nctrl_pts;
+                    dst.knot_mins   = src.knot_mins;
+                    dst.knot_maxs   = src.knot_maxs;
+                    dst.level       = src.level;
+                }
+                ref->tmesh.all_knots        = mfa_data.tmesh.all_knots;
+                ref->tmesh.all_knot_levels  = mfa_data.tmesh.all_knot_levels;
+            }
+            else
+                CheckStructure(mfa_data);
+
+            int k = frames.size();
+            frames.resize(k + 1);
+            vector<unsigned char>& out = frames[k];
+            for (auto i = 0; i < mfa_data.tmesh.tensor_prods.size(); i++)
+            {
+                const TensorProduct<T>& t = mfa_data.tmesh.tensor_prods[i];
+
+                // try each predictor allowed for this step and keep the smallest
+                vector<unsigned char>   best, bytes;
+                int                     best_pred = SEQ_SPATIAL;
+                CtrlPtCodec<T>::Compress(t.ctrl_pts, t.nctrl_pts, err_bound, best);
+                for (int pred = SEQ_TEMPORAL; !IsKeyframe(k) && pred <= SEQ_TEMPORAL_SPATIAL; pred++)
+                {
+                    bytes.clear();
+                    CtrlPtCodec<T>::Compress(t.ctrl_pts, t.nctrl_pts, err_bound, bytes, &last[i], pred != SEQ_TEMPORAL);
+                    if (bytes.size() < best.size())
+                    {
+                        best.swap(bytes);
+                        best_pred = pred;
+                    }
+                }
+
+                PutVarint(out, t.ctrl_pts.cols());
+                out.push_back(best_pred);
+                bool unit = t.weights.size() == 0 || (t.weights.array() == 1.0).all();
+                out.push_back(unit);
+                if (!unit)
+                {
+                    size_t pos = out.size();
+                    out.resize(pos + t.weights.size() * sizeof(T));
+                    memcpy(&out[pos], t.weights.data(), t.weights.size() * sizeof(T));
+                }
+                out.insert(out.end(), best.begin(), best.end());
+            }
+
+            // the next delta is taken from what the decoder will see, not from the original
+            vector<MatrixX<T>> cur;
+            DecodeFrame(k, last, cur, NULL);
+            last.swap(cur);
+        }
+
+        // reconstructs step k as a new model owned by the caller
+        MFA_Data<T>* Decode(int k) const
+        {
+            if (k < 0 || k >= frames.size())
+            {
+                fprintf(stderr, "Error: ModelSequence::Decode(): step %d out of range [0, %lu)\n", k, frames.size());
+                exit(1);
+            }
+
+            vector<MatrixX<T>> prev, cur;
+            vector<VectorX<T>> weights;
+            for (int s = k - k % key_interval; s <= k; s++)
+            {
+                DecodeFrame(s, prev, cur, s == k ? &weights : NULL);
+                prev.swap(cur);
+            }
+
+            MFA_Data<T>* mfa_data = new MFA_Data<T>(ref->p, ref->tmesh.tensor_prods.size(), ref->min_dim, ref->max_dim);
+            for (auto i = 0; i < ref->tmesh.tensor_prods.size(); i++)
+            {
+                const TensorProduct<T>& src = ref->tmesh.tensor_prods[i];
+                TensorProduct<T>&       dst = mfa_data->tmesh.tensor_prods[i];
+                dst.nctrl_pts   = src.nctrl_pts;
+                dst.knot_mins   = src.knot_mins;
+                dst.knot_maxs   = src.knot_maxs;
+                dst.level       = src.level;
+                dst.ctrl_pts.swap(prev[i]);
+                dst.weights.swap(weights[i]);
+            }
+            mfa_data->tmesh.all_knots       = ref->tmesh.all_knots;
+            mfa_data->tmesh.all_knot_levels = ref->tmesh.all_knot_levels;
+            return mfa_data;
+        }
+
+        void Save(diy::BinaryBuffer& bb) const
+        {
+            diy::save(bb, err_bound);
+            diy::save(bb, key_interval);
+            diy::save(bb, frames);
+            if (frames.empty())
+                return;
+            diy::save(bb, ref->p.size());
+            diy::save(bb, ref->p.data(), ref->p.size());
+            diy::save(bb, ref->min_dim);
+            diy::save(bb, ref->max_dim);
+            diy::save(bb, ref->tmesh.tensor_prods.size());
+            for (auto i = 0; i < ref->tmesh.tensor_prods.size(); i++)
+            {
+                const TensorProduct<T>& t = ref->tmesh.tensor_prods[i];
+                diy::save(bb, t.nctrl_pts.data(), t.nctrl_pts.size());
+                diy::save(bb, t.knot_mins);
+                diy::save(bb, t.knot_maxs);
+                diy::save(bb, t.level);
+            }
+            diy::save(bb, ref->tmesh.all_knots);
+            diy::save(bb, ref->tmesh.all_knot_levels);
+        }
+
+        void Load(diy::BinaryBuffer& bb)
+        {
+            delete ref;
+            ref = NULL;
+            last.clear();
+            diy::load(bb, err_bound);
+            diy::load(bb, key_interval);
+            diy::load(bb, frames);
+            if (frames.empty())
+                return;
+
+            Eigen::Index    dom_dim;
+            int             min_dim, max_dim;
+            size_t          ntensor_prods;
+            diy::load(bb, dom_dim);
+            VectorXi p(dom_dim);
+            diy::load(bb, p.data(), dom_dim);
+            diy::load(bb, min_dim);
+            diy::load(bb, max_dim);
+            diy::load(bb, ntensor_prods);
+            ref = new MFA_Data<T>(p, ntensor_prods, min_dim, max_dim);
+            for (auto i = 0; i < ntensor_prods; i++)
+            {
+                TensorProduct<T>& t = ref->tmesh.tensor_prods[i];
+                t.nctrl_pts.resize(dom_dim);
+                diy::load(bb, t.nctrl_pts.data(), dom_dim);
+                diy::load(bb, t.knot_mins);
+                diy::load(bb, t.knot_maxs);
+                diy::load(bb, t.level);
+            }
+            diy::load(bb, ref->tmesh.all_knots);
+            diy::load(bb, ref->tmesh.all_knot_levels);
+
+            // reconstruct the last step so that more steps can be appended
+            vector<MatrixX<T>> prev;
+            int k = frames.size() - 1;
+            for (int s = k - k % key_interval; s <= k; s++)
+            {
+                DecodeFrame(s, prev, last, NULL);
+                prev.swap(last);
+            }
+            last.swap(prev);
+        }
+    };
+}
+
+namespace diy
+{
+    template <typename T>
+        struct Serialization<mfa::ModelSequence<T>>
+        {
+            static
+                void save(diy::BinaryBuffer& bb, const mfa::ModelSequence<T>& s)   { s.Save(bb); }
+            static
+                void load(diy::BinaryBuffer& bb, mfa::ModelSequence<T>& s)         { s.Load(bb); }
+        };
+}
+
+#endif
@@ -0,0 +1,420 @@
+//--------------------------------------------------------------
+// streamline and pathline tracing directly on vector-valued mfa models
+//
+// the velocity components may be columns of one model or separate science
+// variables; components that share knots and degrees are evaluated with one
+// span search and one set of basis functions, and consecutive queries along
+// a trace reuse the previous spans as hints
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _STREAMLINE_HPP
+#define _STREAMLINE_HPP
+
+#include    <vector>
+#include    <cmath>
+#include    <algorithm>
+
+using namespace std;
+
+namespace mfa
+{
+    enum TraceStatus
+    {
+        TRACE_ACTIVE,                                   // still being traced
+        TRACE_LEFT_BOX,                                 // left the box it was traced in, but not the model domain
+        TRACE_LEFT_DOMAIN,                              // reached the boundary of the model domain
+        TRACE_STAGNANT,                                 // velocity vanished
+        TRACE_MAX_STEPS,                                // took the max. number of steps
+    };
+
+    template <typename T>                               // float or double
+    struct Particle
+    {
+        int                 id;                         // id of the seed
+        VectorX<T>          x;                          // domain coordinates, including time as the last coordinate of unsteady fields
+        T                   h;                          // current step size
+        int                 nsteps;                     // number of steps taken so far
+        int                 status;                     // TraceStatus
+
+        Particle() : id(0), h(0.0), nsteps(0), status(TRACE_ACTIVE)   {}
+    };
+
+    template <typename T>                               // float or double
+    struct TraceParams
+    {
+        T                   tol;                        // local error tolerance of adaptive RK45 steps (0 = fixed RK4 steps)
+        T                   h_min;                      // min. step size
+        T                   h_max;                      // max. step size
+        T                   min_speed;                  // speed below which a particle is stagnant
+        int                 max_steps;                  // max. number of steps per particle
+        bool                pathline;                   // advance time with the particle in an unsteady field
+
+        TraceParams() :
+            tol(0.0), h_min(1e-6), h_max(1e10), min_speed(1e-12), max_steps(1000), pathline(false)  {}
+    };
+
+    // evaluates all components of a vector field at a point
+    // NB: keeps span hints and scratch space, so each thread needs its own copy
+    template <typename T>                               // float or double
+    class VectorField
+    {
+        struct Group                                    // components with identical knots and degrees
+        {
+            const MFA_Data<T>*  mfa_data;
+            MatrixX<T>          ctrl_pts;               // control points of all components in the group, one column per component
+            vector<int>         comps;                  // component number of each column
+            VectorXi            cs;                     // stride of control points in each dim.
+            VectorXi            spans;                  // span hint in each dim.
+            vector<vector<T>>   N;                      // basis functions in each dim.
+            BasisFunInfo<T>     bfi;
+
+            Group(const MFA_Data<T>* mfa_data_) :
+                mfa_data(mfa_data_),
+                bfi(vector<int>(1, mfa_data_->p.maxCoeff() + 1))
+            {
+                int dom_dim = mfa_data->dom_dim;
+                const VectorXi& nctrl_pts = mfa_data->tmesh.tensor_prods[0].nctrl_pts;
+                cs.resize(dom_dim);
+                for (auto k = 0; k < dom_dim; k++)
+                    cs(k) = k == 0 ? 1 : cs(k - 1) * nctrl_pts(k - 1);
+                spans   = mfa_data->p;
+                N.resize(dom_dim);
+                for (auto k = 0; k < dom_dim; k++)
+                    N[k].resize(mfa_data->p(k) + 1);
+            }
+        };
+
+        vector<Group>       groups;
+        int                 dom_dim;
+        int                 ncomps;
+
+    public:
+
+        size_t              nfinds;                     // number of span searches (for statistics)
+        size_t              nhints;                     // number of spans found from the hints
+
+        VectorField(
+                const vector<const MFA_Data<T>*>& models) : // models of the components; all columns of each model are components
+            dom_dim(models[0]->dom_dim),
+            ncomps(0),
+            nfinds(0),
+            nhints(0)
+        {
+            for (auto m : models)
+            {
+                const TensorProduct<T>& t = m->tmesh.tensor_prods[0];
+                if (m->tmesh.tensor_prods.size() != 1 || m->dom_dim != dom_dim)
+                {
+                    fprintf(stderr, "Error: VectorField requires models with a single tensor product and the same domain dimension\n");
+                    exit(1);
+                }
+#ifndef MFA_NO_WEIGHTS
+                if ((t.weights.array() != 1.0).any())
+                {
+                    fprintf(stderr, "Error: VectorField requires unit weights\n");
+                    exit(1);
+                }
+#endif
+
+                // find a group with the same knots and degrees
+                int g = 0;
+                for (; g < groups.size(); g++)
+                    if (groups[g].mfa_data->p == m->p && groups[g].mfa_data->tmesh.all_knots == m->tmesh.all_knots)
+                        break;
+                if (g == groups.size())
+                    groups.push_back(Group(m));
+
+                MatrixX<T>& P = groups[g].ctrl_pts;
+                int ncols = P.cols();
+                P.conservativeResize(t.ctrl_pts.rows(), ncols + t.ctrl_pts.cols());
+                P.rightCols(t.ctrl_pts.cols()) = t.ctrl_pts;
+                for (auto c = 0; c < t.ctrl_pts.cols(); c++)
+                    groups[g].comps.push_back(ncomps++);
+            }
+        }
+
+        int ncomponents() const                         { return ncomps; }
+        int ngroups() const                             { return groups.size(); }
+
+        // knot spans of a group at a parameter value, updating its span hints
+        const VectorXi& Spans(
+                const VectorX<T>&   param,              // parameter value in each dim.
+                int                 group = 0)          // group of components
+        {
+            for (auto k = 0; k < dom_dim; k++)
+                Span(groups[group], k, param(k));
+            return groups[group].spans;
+        }
+
+        // value of all components at a parameter value
+        void Eval(
+                const VectorX<T>&   param,              // parameter value in each dim.
+                VectorX<T>&         v)                  // (output) value of each component
+        {
+            v.resize(ncomps);
+            VectorX<T> sum;
+            for (auto& g : groups)
+            {
+                const MFA_Data<T>& md = *g.mfa_data;
+                int start = 0;
+                int tot_iters = 1;
+                for (auto k = 0; k < dom_dim; k++)
+                {
+                    Span(g, k, param(k));
+                    md.FastBasisFuns(k, param(k), g.spans(k), g.N[k], g.bfi);
+                    start       += (g.spans(k) - md.p(k)) * g.cs(k);
+                    tot_iters   *= md.p(k) + 1;
+                }
+
+                // one pass over the support for all columns of the group, dim. 0 fastest
+                sum = VectorX<T>::Zero(g.ctrl_pts.cols());
+                VectorXi ijk = VectorXi::Zero(dom_dim);
+                for (auto m = 0; m < tot_iters; m++)
+                {
+                    T   w   = 1.0;
+                    int idx = start;
+                    for (auto k = 0; k < dom_dim; k++)
+                    {
+                        w   *= g.N[k][ijk(k)];
+                        idx += ijk(k) * g.cs(k);
+                    }
+                    sum += w * g.ctrl_pts.row(idx).transpose();
+                    for (auto k = 0; k < dom_dim; k++)
+                    {
+                        if (++ijk(k) <= md.p(k))
+                            break;
+                        ijk(k) = 0;
+                    }
+                }
+                for (auto c = 0; c < g.comps.size(); c++)
+                    v(g.comps[c]) = sum(c);
+            }
+        }
+
+    private:
+
+        // span containing u, checking the hint and its neighbors before searching
+        void Span(
+                Group&              g,
+                int                 k,                  // current dimension
+                T                   u)                  // parameter value
+        {
+            const vector<T>&    U       = g.mfa_data->tmesh.all_knots[k];
+            int                 s       = g.spans(k);
+            int                 last    = U.size() - g.mfa_data->p(k) - 2;     // last nonempty span
+            if (u >= U[s] && (u < U[s + 1] || (s == last && u == U[s + 1])))
+            {
+                nhints++;
+                return;
+            }
+            if (s < last && u >= U[s + 1] && u < U[s + 2])
+            {
+                g.spans(k)++;
+                nhints++;
+                return;
+            }
+            if (s > g.mfa_data->p(k) && u >= U[s - 1] && u < U[s])
+            {
+                g.spans(k)--;
+                nhints++;
+                return;
+            }
+            g.spans(k) = g.mfa_data->FindSpan(k, u);
+            nfinds++;
+        }
+    };
+
+    // integrates particles through a vector field whose model spans a box in domain coordinates
+    // the domain is mapped linearly to parameter space, as for models of regular grids;
+    // when the domain has one more dimension than the field has components, the last one is time
+    template <typename T>                               // float or double
+    class Tracer
+    {
+        VectorField<T>&     field;
+        VectorX<T>          dom_mins;                   // domain extents of the model
+        VectorX<T>          dom_maxs;
+        int                 dom_dim;
+        int                 ncomps;                     // spatial dimension
+
+        // Dormand-Prince 5(4) tableau
+        static const T      c[7];
+        static const T      a[7][6];
+        static const T      b[7];                       // 5th order weights
+        static const T      e[7];                       // difference between 5th and 4th order weights
+
+    public:
+
+        Tracer(
+                VectorField<T>&     field_,             // velocity field
+                const VectorX<T>&   dom_mins_,          // min. corner of the model domain
+                const VectorX<T>&   dom_maxs_) :        // max. corner of the model domain
+            field(field_),
+            dom_mins(dom_mins_),
+            dom_maxs(dom_maxs_),
+            dom_dim(dom_mins_.size()),
+            ncomps(field_.ncomponents())
+        {
+            if (ncomps != dom_dim && ncomps + 1 != dom_dim)
+            {
+                fprintf(stderr, "Error: Tracer: a field with %d components needs a %d- or %d-d domain\n", ncomps, ncomps, ncomps + 1);
+                exit(1);
+            }
+        }
+
+        // velocity at a point in domain coordinates, clamped to the model domain
+        void Velocity(
+                const VectorX<T>&   x,                  // domain point, including time for unsteady fields
+                VectorX<T>&         v)                  // (output) velocity
+        {
+            VectorX<T> param = ((x - dom_mins).array() / (dom_maxs - dom_mins).array()).cwiseMax(0.0).cwiseMin(1.0);
+            field.Eval(param, v);
+        }
+
+        // traces a particle until it leaves box_min, box_max or stops for another reason
+        // the last point of a particle that left the box is outside the box but inside the model domain
+        // returns the new status of the particle
+        int Trace(
+                Particle<T>&            p,              // particle, advanced in place
+                const VectorX<T>&       box_min,        // min. corner of box to trace in (eg. block core)
+                const VectorX<T>&       box_max,        // max. corner of box to trace in
+                const TraceParams<T>&   params,         // integration parameters
+                vector<VectorX<T>>*     path = NULL)    // (output, optional) points along the trace, starting with the current one
+        {
+            VectorX<T>          v(ncomps), x1(dom_dim), err(ncomps);
+            vector<VectorX<T>>  k(7, VectorX<T>(ncomps));
+            bool                adaptive    = params.tol > 0.0;
+            int                 nstages     = adaptive ? 7 : 4;
+
+            if (path)
+                path->push_back(p.x);
+            p.status = TRACE_ACTIVE;
+            if (p.h <= 0.0)
+                p.h = params.h_max;
+
+            while (p.status == TRACE_ACTIVE)
+            {
+                if (p.nsteps >= params.max_steps)
+                {
+                    p.status = TRACE_MAX_STEPS;
+                    break;
+                }
+                Velocity(p.x, k[0]);
+                if (k[0].norm() < params.min_speed)
+                {
+                    p.status = TRACE_STAGNANT;
+                    break;
+                }
+
+                T h = std::min(std::max(p.h, params.h_min), params.h_max);
+                if (adaptive)
+                {
+                    Stage(p.x, h, k, 7, params.pathline, x1, b);
+                    err.setZero();
+                    for (auto s = 0; s < 7; s++)
+                        err += h * e[s] * k[s];
+                    T sc    = params.tol * (1.0 + p.x.head(ncomps).cwiseAbs().maxCoeff());
+                    T enorm = err.cwiseAbs().maxCoeff();
+                    T fac   = enorm > 0.0 ? 0.9 * pow(sc / enorm, T(0.2)) : 5.0;
+                    p.h     = h * std::min(T(5.0), std::max(T(0.2), fac));
+                    if (enorm > sc && h > params.h_min)
+                        continue;                       // reject and retry with a smaller step
+                }
+                else
+                {
+                    static const T rk4_b[4] = {1.0 / 6.0, 1.0 / 3.0, 1.0 / 3.0, 1.0 / 6.0};
+                    Stage(p.x, h, k, nstages, params.pathline, x1, rk4_b);
+                }
+
+                // shorten steps that leave the model domain, so that the trace ends on its boundary
+                bool in_domain = ((x1 - dom_mins).array() >= 0.0).all() && ((x1 - dom_maxs).array() <= 0.0).all();
+                if (!in_domain)
+                {
+                    if (h > params.h_min)
+                    {
+                        p.h = std::max(T(0.5) * h, params.h_min);
+                        continue;
+                    }
+                    p.status = TRACE_LEFT_DOMAIN;
+                    break;
+                }
+
+                p.x = x1;
+                p.nsteps++;
+                if (path)
+                    path->push_back(p.x);
+                if (((p.x - box_min).array() < 0.0).any() || ((p.x - box_max).array() > 0.0).any())
+                    p.status = TRACE_LEFT_BOX;
+            }
+            return p.status;
+        }
+
+    private:
+
+        // evaluates the remaining stages of a step starting from k[0] and combines them with weights w
+        void Stage(
+                const VectorX<T>&   x0,                 // start of step
+                T                   h,                  // step size
+                vector<VectorX<T>>& k,                  // (input k[0], output others) stage velocities
+                int                 nstages,            // 4 (classical RK4) or 7 (Dormand-Prince)
+                bool                pathline,           // advance time
+                VectorX<T>&         x1,                 // (output) end of step
+                const T*            w)                  // weights of the stages
+        {
+            static const T  rk4_c[4] = {0.0, 0.5, 0.5, 1.0};
+            VectorX<T>      xs(dom_dim);
+            bool            unsteady = dom_dim > ncomps;
+            for (auto s = 1; s < nstages; s++)
+            {
+                xs = x0;
+                if (nstages == 4)
+                    xs.head(ncomps) += h * rk4_c[s] * k[s - 1];
+                else
+                    for (auto j = 0; j < s; j++)
+                        xs.head(ncomps) += h * a[s][j] * k[j];
+                if (unsteady && pathline)
+                    xs(ncomps) += h * (nstages == 4 ? rk4_c[s] : c[s]);
+                Velocity(xs, k[s]);
+            }
+            x1 = x0;
+            for (auto s = 0; s < nstages; s++)
+                x1.head(ncomps) += h * w[s] * k[s];
+            if (unsteady && pathline)
+                x1(ncomps) += h;
+        }
+    };
+
+    template <typename T>
+    const T Tracer<T>::c[7] = {0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0};
+
+    template <typename T>
+    const T Tracer<T>::a[7][6] =
+    {
+        {0.0,                   0.0,                0.0,                0.0,            0.0,                0.0},
+        {1.0 / 5.0,             0.0,                0.0,                0.0,            0.0,                0.0},
+        {3.0 / 40.0,            9.0 / 40.0,         0.0,                0.0,            0.0,                0.0},
+        {44.0 / 45.0,           -56.0 / 15.0,       32.0 / 9.0,         0.0,            0.0,                0.0},
+        {19372.0 / 6561.0,      -25360.0 / 2187.0,  64448.0 / 6561.0,   -212.0 / 729.0, 0.0,                0.0},
+        {9017.0 / 3168.0,       -355.0 / 33.0,      46732.0 / 5247.0,   49.0 / 176.0,   -5103.0 / 18656.0,  0.0},
+        {35.0 / 384.0,          0.0,                500.0 / 1113.0,     125.0 / 192.0,  -2187.0 / 6784.0,   11.0 / 84.0},
+    };
+
+    template <typename T>
+    const T Tracer<T>::b[7] = {35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0, 0.0};
+
+    template <typename T>
+    const T Tracer<T>::e[7] =
+    {
+        35.0 / 384.0        - 5179.0 / 57600.0,
+        0.0,
+        500.0 / 1113.0      - 7571.0 / 16695.0,
+        125.0 / 192.0       - 393.0 / 640.0,
+        -2187.0 / 6784.0    + 92097.0 / 339200.0,
+        11.0 / 84.0         - 187.0 / 2100.0,
+        -1.0 / 40.0,
+    };
+}
+
+#endif
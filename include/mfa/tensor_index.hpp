@@ -0,0 +1,289 @@
+//--------------------------------------------------------------
+// spatial index over axis-aligned boxes of tensor products in knot index space
+//
+// bulk-loaded bounding volume tree plus a short list of pending
+// insertions and updates that is folded into the tree once it grows
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+#ifndef _TENSOR_INDEX_HPP
+#define _TENSOR_INDEX_HPP
+
+#include    <vector>
+#include    <algorithm>
+
+using namespace std;
+
+namespace mfa
+{
+    template <typename T>                           // coordinate type, KnotIdx for the tmesh
+    struct TensorIndex
+    {
+        private:
+
+        struct Node
+        {
+            size_t          first;                  // first entry of this node in entries_
+            size_t          last;                   // one past the last entry of this node in entries_
+            long            left;                   // index of left child in nodes_, -1 for a leaf
+            long            right;                  // index of right child in nodes_, -1 for a leaf
+        };
+
+        int                 dim_;                   // dimensionality of boxes
+        vector<T>           mins_;                  // current box mins, flattened [id * dim_ + k]
+        vector<T>           maxs_;                  // current box maxs, flattened [id * dim_ + k]
+        vector<char>        alive_;                 // whether the id exists
+        vector<char>        in_tree_;               // whether the current box of the id is the one stored in the tree
+        vector<char>        in_pending_;            // whether the id is in the pending list
+        vector<size_t>      pending_;               // ids inserted or updated since the tree was built
+        size_t              nalive_;                // number of existing ids
+
+        vector<Node>        nodes_;                 // tree nodes, root is nodes_[0]
+        vector<T>           node_mins_;             // node bounds mins, flattened [node * dim_ + k]
+        vector<T>           node_maxs_;             // node bounds maxs, flattened [node * dim_ + k]
+        vector<size_t>      entries_;               // ids in leaf order
+
+        static const size_t leaf_size = 8;          // max entries per leaf
+
+        bool overlaps(const T* a_mins, const T* a_maxs, const T* b_mins, const T* b_maxs) const
+        {
+            for (auto k = 0; k < dim_; k++)
+                if (a_maxs[k] < b_mins[k] || b_maxs[k] < a_mins[k])
+                    return false;
+            return true;
+        }
+
+        // recursively builds the subtree over entries_[first, last), returns node index
+        long build(size_t first, size_t last)
+        {
+            long n = nodes_.size();
+            nodes_.push_back(Node{first, last, -1, -1});
+            node_mins_.resize((n + 1) * dim_);
+            node_maxs_.resize((n + 1) * dim_);
+
+            // bounds of the node
+            for (auto k = 0; k < dim_; k++)
+            {
+                node_mins_[n * dim_ + k] = mins_[entries_[first] * dim_ + k];
+                node_maxs_[n * dim_ + k] = maxs_[entries_[first] * dim_ + k];
+            }
+            for (auto i = first + 1; i < last; i++)
+                for (auto k = 0; k < dim_; k++)
+                {
+                    node_mins_[n * dim_ + k] = min(node_mins_[n * dim_ + k], mins_[entries_[i] * dim_ + k]);
+                    node_maxs_[n * dim_ + k] = max(node_maxs_[n * dim_ + k], maxs_[entries_[i] * dim_ + k]);
+                }
+
+            if (last - first <= leaf_size)
+                return n;
+
+            // split at the median box center along the widest dimension of the node
+            int split_dim = 0;
+            for (auto k = 1; k < dim_; k++)
+                if (node_maxs_[n * dim_ + k] - node_mins_[n * dim_ + k] >
+                        node_maxs_[n * dim_ + split_dim] - node_mins_[n * dim_ + split_dim])
+                    split_dim = k;
+            size_t mid = first + (last - first) / 2;
+            nth_element(entries_.begin() + first, entries_.begin() + mid, entries_.begin() + last,
+                    [&](size_t a, size_t b)
+                    {
+                        return mins_[a * dim_ + split_dim] + maxs_[a * dim_ + split_dim] <
+                               mins_[b * dim_ + split_dim] + maxs_[b * dim_ + split_dim];
+                    });
+
+            long left           = build(first, mid);
+            long right          = build(mid, last);
+            nodes_[n].left      = left;
+            nodes_[n].right     = right;
+            return n;
+        }
+
+        public:
+
+        TensorIndex(int dim = 0) :
+            dim_(dim),
+            nalive_(0)                              {}
+
+        // remove all boxes and set the dimensionality
+        void clear(int dim)
+        {
+            dim_    = dim;
+            nalive_ = 0;
+            mins_.clear();
+            maxs_.clear();
+            alive_.clear();
+            in_tree_.clear();
+            in_pending_.clear();
+            pending_.clear();
+            nodes_.clear();
+            node_mins_.clear();
+            node_maxs_.clear();
+            entries_.clear();
+        }
+
+        // number of boxes in the index
+        size_t size() const                         { return nalive_; }
+
+        // number of id slots, ie, one past the largest id ever inserted and not trimmed
+        size_t nids() const                         { return alive_.size(); }
+
+        // insert a new box or replace the box of an existing id
+        void update(size_t                      id,
+                    const vector<T>&            mins,
+                    const vector<T>&            maxs)
+        {
+            if (id >= alive_.size())
+            {
+                mins_.resize((id + 1) * dim_);
+                maxs_.resize((id + 1) * dim_);
+                alive_.resize(id + 1, 0);
+                in_tree_.resize(id + 1, 0);
+                in_pending_.resize(id + 1, 0);
+            }
+            for (auto k = 0; k < dim_; k++)
+            {
+                mins_[id * dim_ + k] = mins[k];
+                maxs_[id * dim_ + k] = maxs[k];
+            }
+            if (!alive_[id])
+                nalive_++;
+            alive_[id]      = 1;
+            in_tree_[id]    = 0;
+            if (!in_pending_[id])
+            {
+                in_pending_[id] = 1;
+                pending_.push_back(id);
+            }
+
+            // fold pending boxes into the tree once scanning them would cost more than a tree query
+            if (pending_.size() > 32 + nalive_ / 8)
+                rebuild();
+        }
+
+        // remove the box of an id
+        void erase(size_t id)
+        {
+            if (id >= alive_.size() || !alive_[id])
+                return;
+            alive_[id]      = 0;
+            in_tree_[id]    = 0;
+            nalive_--;
+
+            // trim trailing dead ids so that nids() tracks a densely numbered set of ids
+            while (alive_.size() && !alive_.back() && !in_pending_.back())
+            {
+                alive_.pop_back();
+                in_tree_.pop_back();
+                in_pending_.pop_back();
+                mins_.resize(alive_.size() * dim_);
+                maxs_.resize(alive_.size() * dim_);
+            }
+        }
+
+        // shift all coordinates >= pos in one dimension by one, eg, after a knot was inserted at pos
+        // the shift is monotone, so node bounds stay valid and the tree need not be rebuilt
+        void shift(int      dim,
+                   T        pos)
+        {
+            for (auto i = dim; i < mins_.size(); i += dim_)
+            {
+                if (mins_[i] >= pos)
+                    mins_[i]++;
+                if (maxs_[i] >= pos)
+                    maxs_[i]++;
+            }
+            for (auto i = dim; i < node_mins_.size(); i += dim_)
+            {
+                if (node_mins_[i] >= pos)
+                    node_mins_[i]++;
+                if (node_maxs_[i] >= pos)
+                    node_maxs_[i]++;
+            }
+        }
+
+        // rebuild the tree from all existing boxes
+        void rebuild()
+        {
+            nodes_.clear();
+            node_mins_.clear();
+            node_maxs_.clear();
+            entries_.clear();
+            for (auto id : pending_)
+                if (id < in_pending_.size())
+                    in_pending_[id] = 0;
+            pending_.clear();
+
+            for (auto id = 0; id < alive_.size(); id++)
+            {
+                in_tree_[id] = alive_[id];
+                if (alive_[id])
+                    entries_.push_back(id);
+            }
+            if (entries_.size())
+                build(0, entries_.size());
+
+            // trim ids that were erased while still pending
+            while (alive_.size() && !alive_.back())
+            {
+                alive_.pop_back();
+                in_tree_.pop_back();
+                in_pending_.pop_back();
+                mins_.resize(alive_.size() * dim_);
+                maxs_.resize(alive_.size() * dim_);
+            }
+        }
+
+        // ids of all boxes overlapping the query box (touching counts), sorted in increasing order
+        void query(const vector<T>&             mins,
+                   const vector<T>&             maxs,
+                   vector<size_t>&              ids) const
+        {
+            ids.clear();
+
+            // tree
+            if (nodes_.size())
+            {
+                long stack[128];                                    // depth is logarithmic in the number of boxes
+                int  top = 0;
+                stack[top++] = 0;
+                while (top)
+                {
+                    long        n       = stack[--top];
+                    const Node& node    = nodes_[n];
+                    if (!overlaps(&mins[0], &maxs[0], &node_mins_[n * dim_], &node_maxs_[n * dim_]))
+                        continue;
+                    if (node.left < 0)
+                    {
+                        for (auto i = node.first; i < node.last; i++)
+                        {
+                            size_t id = entries_[i];
+                            if (id < alive_.size() && in_tree_[id] &&
+                                    overlaps(&mins[0], &maxs[0], &mins_[id * dim_], &maxs_[id * dim_]))
+                                ids.push_back(id);
+                        }
+                    }
+                    else
+                    {
+                        stack[top++] = node.left;
+                        stack[top++] = node.right;
+                    }
+                }
+            }
+
+            // pending
+            for (auto id : pending_)
+            {
+                if (id < alive_.size() && alive_[id] && !in_tree_[id] &&
+                        overlaps(&mins[0], &maxs[0], &mins_[id * dim_], &maxs_[id * dim_]))
+                    ids.push_back(id);
+            }
+
+            sort(ids.begin(), ids.end());
+            ids.erase(unique(ids.begin(), ids.end()), ids.end());
+        }
+    };
+}
+
+#endif
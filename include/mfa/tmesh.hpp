@@ -79,6 +79,7 @@ namespace mfa
         int                         max_dim_;           // ending coordinate of this model in full-dimensional data
         int                         cur_split_dim;      // current split dimension
         int                         max_level;          // deepest level of refinement
+        TensorIndex<KnotIdx>        tensor_index;       // spatial index over tensor knot_mins, knot_maxs
 
         Tmesh(int               dom_dim,                // number of domain dimension
               const VectorXi&   p,                      // degree in each dimension
@@ -90,7 +91,8 @@ namespace mfa
                 min_dim_(min_dim),
                 max_dim_(max_dim),
                 cur_split_dim(0),
-                max_level(0)
+                max_level(0),
+                tensor_index(dom_dim)
         {
             all_knots.resize(dom_dim_);
             all_knot_levels.resize(dom_dim_);
@@ -210,6 +212,7 @@ namespace mfa
                     t.knot_maxs[dim]++;
                 tensor_knot_idxs(t);
             }
+            tensor_index.shift(dim, pos);
 
             return 2;
         }
@@ -224,9 +227,13 @@ namespace mfa
         {
             bool vec_grew;                          // vector of tensor_prods grew
             bool tensor_inserted = false;           // the desired tensor was already inserted
+            vector<TensorIdx> cands;                // candidate tensors overlapping the new tensor
+
+            sync_tensor_index();
 
             // check if the tensor to be added matches any existing ones
-            for (auto k = 0; k < tensor_prods.size(); k++)
+            tensor_candidates(knot_mins, knot_maxs, cands);
+            for (auto k : cands)
             {
                 auto& t = tensor_prods[k];
 
@@ -320,8 +327,12 @@ namespace mfa
                 vec_grew = false;           // tensor_prods grew and iterator is invalid
                 bool knots_match;           // intersect resulted in a tensor with same knot mins, maxs as tensor to be added
 
-                for (auto j = 0; j < tensor_prods.size(); j++)      // for all tensor products
+                // only tensors overlapping the new tensor can be covered by it or intersect it
+                tensor_candidates(new_tensor.knot_mins, new_tensor.knot_maxs, cands);
+                for (auto c = 0; c < cands.size(); c++)             // for all candidate tensor products
                 {
+                    TensorIdx j = cands[c];
+
 //                     if (debug)
 //                         fmt::print(stderr, "checking for intersection between new tensor and existing tensor idx={}\n", j);
 
@@ -347,6 +358,13 @@ namespace mfa
                         tensor_prods[j] = tensor_prods.back();
                         tensor_prods.resize(tensor_prods.size() - 1);
 
+                        // the last tensor now lives at j and is checked below; don't visit it again under its old index
+                        tensor_index.erase(tensor_prods.size());
+                        if (j < tensor_prods.size())
+                            index_tensor(j);
+                        if (cands.back() == tensor_prods.size())
+                            cands.pop_back();
+
                         // renumber the pointers of the moved tensor's neighbors
                         for (auto i = 0; i < dom_dim_; i++)
                         {
@@ -409,10 +427,15 @@ namespace mfa
             }
 
             // adjust next and prev pointers for new tensor
+            // only tensors overlapping the new tensor can be adjacent to it
+            tensor_candidates(new_tensor_ref.knot_mins, new_tensor_ref.knot_maxs, cands);
             for (int j = 0; j < dom_dim_; j++)
             {
-                for (auto k = 0; k < new_tensor_idx; k++)
+                for (auto k : cands)
                 {
+                    if (k >= new_tensor_idx)
+                        break;
+
 //                     if (debug)
 //                         fprintf(stderr, "final add: cur_dim=%d new_tensor_idx=%lu checking existing_tensor_idx=%lu\n", j, new_tensor_idx, k);
 
@@ -439,7 +462,10 @@ namespace mfa
 
             // add the tensor
             if (!tensor_inserted)
+            {
                 tensor_prods.push_back(new_tensor);
+                index_tensor(new_tensor_idx);
+            }
 
             return new_tensor_idx;
         }
@@ -457,6 +483,9 @@ namespace mfa
         {
             bool vec_grew;                          // vector of tensor_prods grew
             bool tensor_inserted = false;           // the desired tensor was already inserted
+            vector<TensorIdx> cands;                // candidate tensors overlapping the new tensor
+
+            sync_tensor_index();
 
             // create a new tensor product
             TensorProduct<T> new_tensor(dom_dim_);
@@ -481,7 +510,9 @@ namespace mfa
                 vec_grew = false;           // tensor_prods grew and iterator is invalid
                 bool knots_match;           // intersect resulted in a tensor with same knot mins, maxs as tensor to be added
 
-                for (auto j = 0; j < tensor_prods.size(); j++)
+                // only tensors overlapping the new tensor can intersect it
+                tensor_candidates(new_tensor.knot_mins, new_tensor.knot_maxs, cands);
+                for (auto j : cands)
                 {
                     // debug
 //                     fprintf(stderr, "checking for intersection between new tensor and existing tensor idx=%lu\n", j);
@@ -527,10 +558,15 @@ namespace mfa
             }
 
             // adjust next and prev pointers for new tensor
+            // only tensors overlapping the new tensor can be adjacent to it
+            tensor_candidates(new_tensor_ref.knot_mins, new_tensor_ref.knot_maxs, cands);
             for (int j = 0; j < dom_dim_; j++)
             {
-                for (auto k = 0; k < new_tensor_idx; k++)
+                for (auto k : cands)
                 {
+                    if (k >= new_tensor_idx)
+                        break;
+
                     // debug
 //                     fprintf(stderr, "final add: cur_dim=%d new_tensor_idx=%lu checking existing_tensor_idx=%lu\n", j, new_tensor_idx, k);
 
@@ -552,7 +588,10 @@ namespace mfa
 
             // add the tensor
             if (!tensor_inserted)
+            {
                 tensor_prods.push_back(new_tensor);
+                index_tensor(new_tensor_idx);
+            }
 
             // copy the control points
             // TODO: deal with the case that the tensor was already inserted, check if it's possible to not be at the end
@@ -815,6 +854,8 @@ namespace mfa
 
                 // add the new max side tensor
                 tensor_prods.push_back(side_tensor);
+                index_tensor(exist_tensor_idx);
+                index_tensor(side_tensor_idx);
 
                 // reset the reference, which could be invalid after the push_back
                 TensorProduct<T>& et  = tensor_prods[exist_tensor_idx];
@@ -844,6 +885,7 @@ namespace mfa
 
                 // update tensor knot indices
                 tensor_knot_idxs(tensor_prods[exist_tensor_idx]);
+                index_tensor(exist_tensor_idx);
 
                 // delete next and prev pointers of existing tensor that are no longer valid as a result of adding new max side
                 delete_old_pointers(exist_tensor_idx);
@@ -1407,6 +1449,8 @@ namespace mfa
                         knot_idx_dist(parent, t.knot_maxs[j], parent.knot_maxs[j], j, false) < ofst)
                     t.knot_maxs[j] = parent.knot_maxs[j];
             }
+
+            reindex_tensor(t);
         }
 
         // merges two tensor product knot mins, maxs, optionally constrained by parent of resulting tensor
@@ -1424,6 +1468,8 @@ namespace mfa
             // don't overshoot the parent or leave it with a small remainder
             if (pad >= 0)
                 constrain_to_parent(inout, pad);
+
+            reindex_tensor(inout);
         }
 
         // checks if a point in index space is in a tensor product
@@ -1718,7 +1764,9 @@ namespace mfa
                                  TensorIdx&             cur_tensor,         // (input / output) highest level neighbor tensor containing the target
                                  int&                   cur_level) const    // (input / output) level of current tensor
         {
-            for (auto k = 0; k < tensor_prods.size(); k++)
+            vector<TensorIdx> cands;
+            tensor_candidates(target, target, cands);
+            for (auto k : cands)
             {
                 if (in(target, tensor_prods[k], ctrl_pt_anchor, -1) && tensor_prods[k].level > cur_level)
                 {
@@ -1766,7 +1814,9 @@ namespace mfa
             bool found = false;
             TensorIdx t_idx = 0;
             int max_level   = -1;
-            for (auto j = 0; j < tensor_prods.size(); j++)
+            vector<TensorIdx> cands;
+            tensor_candidates(target, target, cands);
+            for (auto j : cands)
             {
                 if (in(target, tensor_prods[j], true, -1))
                 {
@@ -2118,13 +2168,84 @@ namespace mfa
             return tensor_prods.size();
         }
 
+        // adds or updates one tensor in the spatial index
+        void index_tensor(TensorIdx t_idx)
+        {
+            tensor_index.update(t_idx, tensor_prods[t_idx].knot_mins, tensor_prods[t_idx].knot_maxs);
+        }
+
+        // updates a tensor in the spatial index if it is one of tensor_prods (and not, eg, a candidate for refinement)
+        void reindex_tensor(const TensorProduct<T>& t)
+        {
+            if (tensor_prods.size() && &t >= &tensor_prods.front() && &t <= &tensor_prods.back())
+                index_tensor(&t - &tensor_prods.front());
+        }
+
+        // whether the spatial index covers exactly the current tensors
+        bool tensor_index_valid() const
+        {
+            return tensor_index.size() == tensor_prods.size() && tensor_index.nids() == tensor_prods.size();
+        }
+
+        // rebuilds the spatial index if it does not cover the current tensors, eg, after tensors were read in directly
+        void sync_tensor_index()
+        {
+            if (tensor_index_valid())
+                return;
+            tensor_index.clear(dom_dim_);
+            for (auto i = 0; i < tensor_prods.size(); i++)
+                index_tensor(i);
+            tensor_index.rebuild();
+        }
+
+        // tensors whose knot_mins, knot_maxs overlap or touch the box [mins, maxs] in index space, in increasing order
+        // all tensors are candidates if the spatial index is not up to date
+        void tensor_candidates(const vector<KnotIdx>&   mins,
+                               const vector<KnotIdx>&   maxs,
+                               vector<TensorIdx>&       cands) const
+        {
+            if (tensor_index_valid())
+                tensor_index.query(mins, maxs, cands);
+            else
+            {
+                cands.resize(tensor_prods.size());
+                for (auto i = 0; i < tensor_prods.size(); i++)
+                    cands[i] = i;
+            }
+        }
+
+        // offsets a knot index by up to ofst knots at level 0, which belong to every tensor
+        // bounds from above the reach of knot_idx_ofst() within any tensor
+        KnotIdx level0_knot_ofst(
+                KnotIdx                 orig_idx,                   // starting knot idx
+                int                     ofst,                       // offset amount, can be positive or negative
+                int                     cur_dim) const              // current dimension
+        {
+            long idx    = orig_idx;
+            long last   = all_knots[cur_dim].size() - 1;
+            int  sgn    = (0 < ofst) - (ofst < 0);
+            for (auto i = 0; i < abs(ofst); i++)
+            {
+                idx += sgn;
+                while (idx > 0 && idx < last && all_knot_levels[cur_dim][idx] > 0)
+                    idx += sgn;
+                if (idx <= 0)
+                    return 0;
+                if (idx >= last)
+                    return last;
+            }
+            return idx;
+        }
+
         // search for tensor containing point in index space
         // returns index of tensor containing the point, or size of tensors (end) if not found
         TensorIdx search_tensors(
                 const vector<KnotIdx>&   pt,                                // target point in index space
                 const VectorXi&          pad)                               // padding in each dim. between target and extents of tensor, zero size -> unused
         {
-            for (auto i = 0; i < tensor_prods.size(); i++)                  // for all existing tensors
+            vector<TensorIdx> cands;                                        // tensors containing the point, without the pad
+            tensor_candidates(pt, pt, cands);
+            for (auto i : cands)
             {
                 TensorProduct<T>& t = tensor_prods[i];
 
@@ -18,6 +18,7 @@ namespace mfa
             T max_norm_err;         // max of normalized errors (absolute value)
             T sum_sq_abs_errs;      // sum of squared absolute errors
             T sum_sq_norm_errs;     // sum of squared normalized errors
+            size_t npts_skipped;    // number of points not decoded because their error was bounded below the limit
 
             ErrorStats()
             {
@@ -25,12 +26,14 @@ namespace mfa
                 max_norm_err        = 0.0;
                 sum_sq_abs_errs     = 0.0;
                 sum_sq_norm_errs    = 0.0;
+                npts_skipped        = 0;
             }
             ErrorStats(T max_abs_err_, T max_norm_err_, T sum_sq_abs_errs_, T sum_sq_norm_errs_) :
                 max_abs_err(max_abs_err_),
                 max_norm_err(max_norm_err_),
                 sum_sq_abs_errs(sum_sq_abs_errs_),
-                sum_sq_norm_errs(sum_sq_norm_errs_)
+                sum_sq_norm_errs(sum_sq_norm_errs_),
+                npts_skipped(0)
             {}
         };
 
@@ -0,0 +1,137 @@
+//--------------------------------------------------------------
+// example of converting a T-mesh to and from compact storage
+//
+// Tom Peterka
+// Argonne National Laboratory
+// tpeterka@mcs.anl.gov
+//--------------------------------------------------------------
+
+#include <mfa/mfa.hpp>
+#include <iostream>
+
+// compares two tensor products, aborts if they differ
+void check(const TensorProduct<double>& a, const TensorProduct<double>& b, size_t i)
+{
+    if (a.knot_mins != b.knot_mins || a.knot_maxs != b.knot_maxs || a.nctrl_pts != b.nctrl_pts ||
+            a.next != b.next || a.prev != b.prev || a.knot_idxs != b.knot_idxs ||
+            a.level != b.level || a.done != b.done ||
+            a.ctrl_pts != b.ctrl_pts || a.weights != b.weights)
+    {
+        fprintf(stderr, "Error: tensor %lu differs after conversion to and from compact storage\n", i);
+        abort();
+    }
+}
+
+int main()
+{
+    // 2d tmesh with uniform knots, degree 2, 6 x 6 control points
+    int         dom_dim = 2;
+    VectorXi    p       = VectorXi::Constant(dom_dim, 2);
+    VectorXi    nctrl   = VectorXi::Constant(dom_dim, 6);
+    mfa::Tmesh<double> tmesh(dom_dim, p, 0, dom_dim);
+    tmesh.init_knots(nctrl);
+    vector<vector<double>> params(dom_dim);
+    for (auto k = 0; k < dom_dim; k++)
+    {
+        int nknots = tmesh.all_knots[k].size();
+        for (auto i = 0; i < nknots; i++)
+        {
+            tmesh.all_knots[k][i]           = i <= p(k) ? 0.0 : (i >= nknots - p(k) - 1 ? 1.0 : double(i - p(k)) / (nknots - 2 * p(k) - 1));
+            tmesh.all_knot_levels[k][i]     = 0;
+            tmesh.all_knot_param_idxs[k][i] = 0;
+        }
+    }
+    vector<KnotIdx> mins(dom_dim, 0);
+    vector<KnotIdx> maxs(dom_dim);
+    for (auto k = 0; k < dom_dim; k++)
+        maxs[k] = tmesh.all_knots[k].size() - 1;
+    tmesh.append_tensor(mins, maxs, 0);
+
+    // refine the middle of the domain by one level, creating neighboring tensors
+    for (auto k = 0; k < dom_dim; k++)
+    {
+        tmesh.insert_knot_at_pos(k, 4, 1, 0.375, params);
+        tmesh.insert_knot_at_pos(k, 6, 1, 0.625, params);
+    }
+    for (auto k = 0; k < dom_dim; k++)
+    {
+        mins[k] = 3;
+        maxs[k] = 7;
+    }
+    tmesh.append_tensor(mins, maxs, 1);
+
+    // fill control points and weights with known values
+    double v = 0.0;
+    for (auto& t : tmesh.tensor_prods)
+    {
+        t.ctrl_pts.resize(t.nctrl_pts.prod(), 3);
+        t.weights.resize(t.nctrl_pts.prod());
+        for (auto i = 0; i < t.ctrl_pts.size(); i++)
+            t.ctrl_pts(i) = v++;
+        for (auto i = 0; i < t.weights.size(); i++)
+            t.weights(i) = 1.0 + v++;
+    }
+    fprintf(stderr, "T-mesh with %lu tensors\n", tmesh.tensor_prods.size());
+    if (tmesh.tensor_prods.size() < 2)
+    {
+        fprintf(stderr, "Error: refinement did not produce multiple tensors\n");
+        abort();
+    }
+
+    // convert to compact storage
+    mfa::CompactTmesh<double> ctmesh(tmesh);
+    size_t tot_nctrl_pts = 0;
+    for (auto i = 0; i < tmesh.tensor_prods.size(); i++)
+    {
+        const TensorProduct<double>& t = tmesh.tensor_prods[i];
+        tot_nctrl_pts += t.ctrl_pts.rows();
+        if (ctmesh.tensor_ctrl_pts(i) != t.ctrl_pts || ctmesh.tensor_weights(i) != t.weights ||
+                ctmesh.levels[i] != t.level)
+        {
+            fprintf(stderr, "Error: compact tensor %d differs from original\n", i);
+            abort();
+        }
+        for (auto k = 0; k < dom_dim; k++)
+        {
+            vector<TensorIdx> next(ctmesh.next_begin(i, k), ctmesh.next_end(i, k));
+            vector<TensorIdx> prev(ctmesh.prev_begin(i, k), ctmesh.prev_end(i, k));
+            if (next != t.next[k] || prev != t.prev[k] || ctmesh.knot_mins[i * dom_dim + k] != t.knot_mins[k])
+            {
+                fprintf(stderr, "Error: compact tensor %d neighbors or extents differ from original\n", i);
+                abort();
+            }
+        }
+    }
+    if (ctmesh.tot_nctrl_pts() != tot_nctrl_pts || ctmesh.ntensors != tmesh.tensor_prods.size())
+    {
+        fprintf(stderr, "Error: compact tmesh sizes differ from original\n");
+        abort();
+    }
+    fprintf(stderr, "compact tmesh: %lu tensors, %lu control points\n", ctmesh.ntensors, ctmesh.tot_nctrl_pts());
+
+    // point search agrees with the original tmesh
+    vector<KnotIdx> pt(dom_dim, 5);
+    if (!ctmesh.in(pt, ctmesh.search(pt, 1)) || ctmesh.levels[ctmesh.search(pt, 0)] != 0)
+    {
+        fprintf(stderr, "Error: compact tmesh search failed\n");
+        abort();
+    }
+
+    // convert back
+    mfa::Tmesh<double> tmesh1(dom_dim, p, 0, dom_dim);
+    ctmesh.expand(tmesh1);
+    for (auto i = 0; i < tmesh.tensor_prods.size(); i++)
+        check(tmesh.tensor_prods[i], tmesh1.tensor_prods[i], i);
+
+    // append tensors one by one, growing the arena
+    mfa::CompactTmesh<double> ctmesh1(dom_dim);
+    for (auto& t : tmesh.tensor_prods)
+        ctmesh1.append(t);
+    ctmesh1.shrink();
+    vector<TensorProduct<double>> tensor_prods;
+    ctmesh1.expand(tensor_prods);
+    for (auto i = 0; i < tmesh.tensor_prods.size(); i++)
+        check(tmesh.tensor_prods[i], tensor_prods[i], i);
+
+    fprintf(stderr, "compact tmesh test passed\n");
+}